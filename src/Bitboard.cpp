@@ -0,0 +1,46 @@
+#include "Bitboard.hpp"
+
+#include <iostream>
+
+using namespace std;
+
+/**
+ * Attack set of a single piece
+ * @param pt Type of the attacking piece
+ * @param tc Team of the attacking piece. Only used for pawns.
+ * @param sq Index of the attacking piece
+ * @param occupied All occupied squares. Blocks sliding pieces.
+ * @returns All squares attacked by the piece
+*/
+Bitboard Bitboards::attacks(PieceType pt, TeamColor tc, int sq, Bitboard occupied){
+    switch(pt){
+        case(King):
+            return kingAttacks(sq);
+        case(Queen):
+            return queenAttacks(sq, occupied);
+        case(Rook):
+            return rookAttacks(sq, occupied);
+        case(Bishop):
+            return bishopAttacks(sq, occupied);
+        case(Knight):
+            return knightAttacks(sq);
+        case(Pawn):
+            return pawnAttacks(tc, sq);
+        default:
+            return EMPTY_BB;
+    }
+}
+
+/*
+    Print a bitboard as an 8x8 grid. Rank 8 is printed first to match Board::display.
+*/
+void Bitboards::print(Bitboard b){
+    for(int j=0; j<8; j++){
+        cout << "           " << 8 - j << " ";
+        for(int i=0; i<8; i++){
+            cout << ((b & squareBB(j*8 + i)) ? "X " : ". ");
+        }
+        cout << endl;
+    }
+    cout << "             A B C D E F G H" << endl;
+}
@@ -0,0 +1,138 @@
+#ifndef Bitboard_H
+#define Bitboard_H
+
+#include "Piece.hpp"
+
+#include <cstdint>
+
+using namespace std;
+
+/*
+    A Bitboard is a set of squares stored in a 64 bit integer. Bit 'i' is the square at index 'i'
+     of the Board's internal board, so bit 0 is A8 and bit 63 is H1.
+    Rows are numbered the same way as the internal board: row 0 is rank 8, row 7 is rank 1.
+*/
+typedef uint64_t Bitboard;
+
+const Bitboard EMPTY_BB = 0ULL;
+const Bitboard FILE_A_BB = 0x0101010101010101ULL;
+const Bitboard FILE_H_BB = FILE_A_BB << 7;
+const Bitboard ROW_0_BB = 0xFFULL;          // rank 8
+const Bitboard ROW_7_BB = ROW_0_BB << 56;   // rank 1
+
+/*
+    Ray directions used for sliding pieces. Positive directions move to increasing indices.
+*/
+enum Direction {
+    North,      // -8
+    South,      // +8
+    East,       // +1
+    West,       // -1
+    NorthEast,  // -7
+    NorthWest,  // -9
+    SouthEast,  // +9
+    SouthWest   // +7
+};
+
+const int directionStep[8] = { -8, 8, 1, -1, -7, -9, 9, 7 };
+
+/*
+    Precomputed attack sets for every square. Built at compile time by buildAttackTables().
+*/
+struct AttackTables {
+    Bitboard knight[64];
+    Bitboard king[64];
+    Bitboard pawn[3][64];   // [TeamColor][square], NoColor row is empty
+    Bitboard rays[8][64];   // [Direction][square], excludes the origin square
+};
+
+constexpr AttackTables buildAttackTables(){
+    AttackTables t = {};
+    const int knightSteps[8][2] = { {-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1} };
+    const int kingSteps[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1} };
+    // {row, col} step for each Direction
+    const int raySteps[8][2] = { {-1, 0}, {1, 0}, {0, 1}, {0, -1}, {-1, 1}, {-1, -1}, {1, 1}, {1, -1} };
+
+    for(int sq=0; sq < 64; sq++){
+        int row = sq / 8;
+        int col = sq % 8;
+        for(int i=0; i < 8; i++){
+            int r = row + knightSteps[i][0];
+            int c = col + knightSteps[i][1];
+            if(r >= 0 && r < 8 && c >= 0 && c < 8){ t.knight[sq] |= 1ULL << (r*8 + c); }
+            r = row + kingSteps[i][0];
+            c = col + kingSteps[i][1];
+            if(r >= 0 && r < 8 && c >= 0 && c < 8){ t.king[sq] |= 1ULL << (r*8 + c); }
+            r = row + raySteps[i][0];
+            c = col + raySteps[i][1];
+            while(r >= 0 && r < 8 && c >= 0 && c < 8){
+                t.rays[i][sq] |= 1ULL << (r*8 + c);
+                r += raySteps[i][0];
+                c += raySteps[i][1];
+            }
+        }
+        // Red pawns move to decreasing indices, Black pawns move to increasing indices
+        if(row > 0){
+            if(col > 0){ t.pawn[Red][sq] |= 1ULL << (sq - 9); }
+            if(col < 7){ t.pawn[Red][sq] |= 1ULL << (sq - 7); }
+        }
+        if(row < 7){
+            if(col > 0){ t.pawn[Black][sq] |= 1ULL << (sq + 7); }
+            if(col < 7){ t.pawn[Black][sq] |= 1ULL << (sq + 9); }
+        }
+    }
+    return t;
+}
+
+inline constexpr AttackTables ATTACK_TABLES = buildAttackTables();
+
+
+/*
+    All methods are static in Bitboards. They are defined in the header so they can be inlined
+     into move generation and evaluation loops.
+*/
+class Bitboards {
+    public:
+        static Bitboard squareBB(int sq){ return 1ULL << sq; }
+        static int popCount(Bitboard b){ return __builtin_popcountll(b); }
+        static int lsb(Bitboard b){ return __builtin_ctzll(b); }
+        static int msb(Bitboard b){ return 63 - __builtin_clzll(b); }
+        // Remove the lowest square from the set and return its index
+        static int popLsb(Bitboard& b){
+            int sq = lsb(b);
+            b &= b - 1;
+            return sq;
+        }
+        static Bitboard knightAttacks(int sq){ return ATTACK_TABLES.knight[sq]; }
+        static Bitboard kingAttacks(int sq){ return ATTACK_TABLES.king[sq]; }
+        static Bitboard pawnAttacks(TeamColor tc, int sq){ return ATTACK_TABLES.pawn[tc][sq]; }
+        static Bitboard ray(Direction d, int sq){ return ATTACK_TABLES.rays[d][sq]; }
+
+        /*
+            Attacks along one ray, stopping at (and including) the first occupied square.
+        */
+        static Bitboard rayAttacks(Direction d, int sq, Bitboard occupied){
+            Bitboard attacks = ATTACK_TABLES.rays[d][sq];
+            Bitboard blockers = attacks & occupied;
+            if(blockers){
+                int first = (directionStep[d] > 0) ? lsb(blockers) : msb(blockers);
+                attacks ^= ATTACK_TABLES.rays[d][first];
+            }
+            return attacks;
+        }
+        static Bitboard rookAttacks(int sq, Bitboard occupied){
+            return rayAttacks(North, sq, occupied) | rayAttacks(South, sq, occupied)
+                 | rayAttacks(East, sq, occupied) | rayAttacks(West, sq, occupied);
+        }
+        static Bitboard bishopAttacks(int sq, Bitboard occupied){
+            return rayAttacks(NorthEast, sq, occupied) | rayAttacks(NorthWest, sq, occupied)
+                 | rayAttacks(SouthEast, sq, occupied) | rayAttacks(SouthWest, sq, occupied);
+        }
+        static Bitboard queenAttacks(int sq, Bitboard occupied){
+            return rookAttacks(sq, occupied) | bishopAttacks(sq, occupied);
+        }
+        static Bitboard attacks(PieceType pt, TeamColor tc, int sq, Bitboard occupied);
+        static void print(Bitboard);
+};
+
+#endif
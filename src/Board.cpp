@@ -3,11 +3,13 @@
 #include "Util.hpp"
 #include "ChessException.hpp"
 #include "Debug.hpp"
+#include "Stats.hpp"
 
 #include <iostream>
 #include <stdlib.h>
 #include <algorithm>
 #include <vector>
+#include <unistd.h>
 
 using namespace std;
 
@@ -15,6 +17,23 @@ const int NUM_COL_ROWS = 8; // number of columns and rows in the chessboard
 const int SQUARE_WIDTH = 5; // Width of the board squares in chars
 const int SQUARE_HEIGHT = 3; // Number of lines each board square occupies
 
+/*
+    List the squares in a mask for debug output, lowest index first
+    @param squares Squares to list
+    @param withLocation Print each square as "(A8, 0)" instead of just its index
+*/
+static string maskString(Bitboard squares, bool withLocation){
+    string out;
+    while(squares){
+        int index = Bitboards::popLsb(squares);
+        out += withLocation ? "(" + Util::reverseParseIndex(index) + ", " + to_string(index) + ")" : to_string(index);
+        if(squares){
+            out += ", ";
+        }
+    }
+    return out;
+}
+
 /*
     Stores the board.
 */
@@ -33,12 +52,6 @@ Board::Board(Board* example){
 Board::~Board(){
     delete[] this->internalboard;
     delete[] this->displayboard;
-    this->moveHighlightIndices.clear();
-    this->checkingPieceIndices.clear();
-    this->threatenedKingIndices.clear();
-    this->checkmatingIndices.clear();
-    this->potentialCheckingIndices.clear();
-    this->specialHighlightIndices.clear();
     promotablePawn.clear();
 }
 
@@ -51,14 +64,13 @@ void Board::clear(){
 }
 
 void Board::clearAllHighlightedIndices(){
-    // vectors
-    this->moveHighlightIndices.clear();
-    this->checkingPieceIndices.clear();
-    this->threatenedKingIndices.clear();
-    this->checkmatingIndices.clear();
-    this->potentialCheckingIndices.clear();
-    // map
-    this->specialHighlightIndices.clear();
+    // masks
+    this->moveHighlightMask = EMPTY_BB;
+    this->checkingPieceMask = EMPTY_BB;
+    this->threatenedKingMask = EMPTY_BB;
+    this->checkmatingMask = EMPTY_BB;
+    this->potentialCheckingMask = EMPTY_BB;
+    this->specialHighlightMask = EMPTY_BB;
     // member
     this->selectedIndex = -1;
 }
@@ -71,32 +83,28 @@ void Board::clearPromotablePawn(){
     Clones a Board*. Sets all values for 'this' to mirror the values of 'example'.
 */
 void Board::clone(Board* example){
+    StatTimer timer(CloneStat);
     // Board* cloned = new Board();
     this->initMembers();
     // copy Pieces on board
     for(int i=0; i < 64; i++){ // internal board is 8*8
         this->internalboard[i].clone(example->internalboard[i]);
     }
-    // copy highlighted indices
-    for(int i=0; i < moveHighlightIndices.size(); i++){
-        this->moveHighlightIndices.push_back(example->moveHighlightIndices.at(i));
-    }
+    // copy highlighted squares
+    this->moveHighlightMask = example->moveHighlightMask;
     // copy display board
     for(int i=0; i < this->rowSize*this->colSize; i++){ // display board size is same as in initMembers() method
         this->displayboard[i] = example->displayboard[i];
     }
-    //Copy specialHighlightIndices
-    for(auto const& [key, val] : example->specialHighlightIndices){
-        this->specialHighlightIndices.insert( {key, val} );
-    }
+    //Copy specialHighlightMask
+    this->specialHighlightMask = example->specialHighlightMask;
     // copy promotable pawns (there should only be a max of 1)
     this->promotablePawn = example->promotablePawn;
     
     /** NOTE: If any issues arise involving missing cloned values: clone the following 
-     * this->checkingPieceIndices
-     * this->threatenedKingIndices
-     * this->checkmatingIndices
-     * this->specialHighlightIndices
+     * this->checkingPieceMask
+     * this->threatenedKingMask
+     * this->checkmatingMask
      * 
      * This most likely won't be a problem since all of these values are not 
      * neccessary for move computating and only serve to highlight squares on 
@@ -122,15 +130,21 @@ void Board::load(Piece* internal, int count){
     If it finds an enemy piece with a matching moveset, then the king is in check.
     @param team Determine if the king of this team is under threat
     @param printNotif Print notification for debugging
-    @returns true if king is checked. Updates this->threatenedKingIndices, this->potentialCheckingIndices, and this->checkingPieceIndices
+    @returns true if king is checked. Updates this->threatenedKingMask, this->potentialCheckingMask, and this->checkingPieceMask
 */
 bool Board::isCheck(TeamColor team){
+    StatTimer timer(CheckStat);
     bool check = false; // true if at least 1 piece threatens the king
     TeamColor opponentTeam = (team == Red) ? Black : Red;
     // get this king's index and create a move where the king is selected
     int kingIndex = this->getKingIndex(team);
     // find all locations where an opponent piece is
-    vector<int> opponentIndices = this->getTeamPieceIndices(opponentTeam);
+    Bitboard opponentMask = EMPTY_BB;
+    for(int i=0; i < 64; i++){
+        if(this->internalboard[i].getTeam() == opponentTeam){
+            opponentMask |= Bitboards::squareBB(i);
+        }
+    }
 
     /** DEBUG: Show all the move the moves the king is examining */
     if(DEBUG_MODE && CHECK_DEBUG) cout << "Board.cpp: CODE ORANGE: Orange highlights courtesy of Board::isKingInCheck()" << endl;
@@ -148,12 +162,10 @@ bool Board::isCheck(TeamColor team){
             
             /** DEBUG: Show all the move the moves the king is examining */
             if(DEBUG_MODE && CHECK_DEBUG){
-                if( !count(begin(this->threatenedKingIndices), end(this->threatenedKingIndices), threatIndex)){
-                    this->threatenedKingIndices.push_back(threatIndex);
-                }
+                this->threatenedKingMask |= Bitboards::squareBB(threatIndex);
             }
             // Opponent piece exists at j index
-            if(count(opponentIndices.begin(), opponentIndices.end(), threatIndex)){
+            if(opponentMask & Bitboards::squareBB(threatIndex)){
                 bool checkFound = false; // True if this specific move causes a check.
                 // determine the moveset checked and what opponent piece was found
                 if(KING_THREAT_DETECTION.at(i) == KING_STD[0] && this->getPiece(threatIndex).getType() == King){
@@ -195,16 +207,9 @@ bool Board::isCheck(TeamColor team){
                 // save checking piece
                 if(checkFound){
                     check = true;
-                    // don't add dupes
-                    if( !count(begin(this->checkingPieceIndices), end(this->checkingPieceIndices), threatIndex)){
-                        this->checkingPieceIndices.push_back(threatIndex);
-                    }
-                    if( !count(begin(this->potentialCheckingIndices), end(this->potentialCheckingIndices), threatIndex)){
-                        this->potentialCheckingIndices.push_back(threatIndex);
-                    } 
-                    if( !count(begin(this->threatenedKingIndices), end(this->threatenedKingIndices), kingIndex)){
-                        this->threatenedKingIndices.push_back(kingIndex);
-                    }                      
+                    this->checkingPieceMask |= Bitboards::squareBB(threatIndex);
+                    this->potentialCheckingMask |= Bitboards::squareBB(threatIndex);
+                    this->threatenedKingMask |= Bitboards::squareBB(kingIndex);
                 }
             }
         }
@@ -216,40 +221,16 @@ bool Board::isCheck(TeamColor team){
     /** DEBUG: */
     if(DEBUG_MODE && CHECK_DEBUG){
         cout << "Board.cpp: Check Logic DEBUG:" << endl;
-        cout << "   Size of potentialCheckingIndices: " << this->potentialCheckingIndices.size();
-        cout << " | values: [ ";
-        for(int i=0; i< this->potentialCheckingIndices.size(); i++){
-            cout << this->potentialCheckingIndices.at(i);
-            if(i < this->potentialCheckingIndices.size() - 1){
-                cout << ", ";
-            }
-        }
-        cout << " ]" << endl;
-        cout << "   Size of threatenedKingIndices: " << this->threatenedKingIndices.size();
-        cout << " | values: [ ";
-        for(int i=0; i< this->threatenedKingIndices.size(); i++){
-            cout << this->threatenedKingIndices.at(i);
-            if(i < this->threatenedKingIndices.size() - 1){
-                cout << ", ";
-            }
-        }
-        cout << " ]" << endl;
+        cout << "   Size of potentialCheckingMask: " << Bitboards::popCount(this->potentialCheckingMask);
+        cout << " | values: [ " << maskString(this->potentialCheckingMask, false) << " ]" << endl;
+        cout << "   Size of threatenedKingMask: " << Bitboards::popCount(this->threatenedKingMask);
+        cout << " | values: [ " << maskString(this->threatenedKingMask, false) << " ]" << endl;
         cout << "   The " << teamString[team] << "'s King index: " << kingIndex << endl;
         cout << "   Opponent's team: " << teamString[opponentTeam] << endl;
-        cout << "   Opponent Indices: [ ";
-        for(int i=0; i< opponentIndices.size(); i++){
-            cout << opponentIndices.at(i);
-            if(i < opponentIndices.size() - 1){
-                cout << ", ";
-            }
-        }
-        cout << " ]" << endl;
+        cout << "   Opponent Indices: [ " << maskString(opponentMask, false) << " ]" << endl;
         this->printCheckingPieces();
     }
 
-    // clean up
-    opponentIndices.clear();
-
     return check;
 }
 
@@ -259,8 +240,9 @@ bool Board::isCheck(TeamColor team){
  * @return True if no valid moves can be made.
 */
 bool Board::isCheckmate(TeamColor team){
+    StatTimer timer(CheckmateStat);
     vector<int> pieceIndices = this->getTeamPieceIndices(team);
-    vector<int> allCheckingIndices = {};
+    Bitboard allCheckingMask = EMPTY_BB;
     int totalMoves = 0;
     for(int i=0; i<pieceIndices.size(); i++){
         Board* board = new Board(this); // clone this board for calculations so this board isn't altered
@@ -278,12 +260,7 @@ bool Board::isCheckmate(TeamColor team){
         // track checking indices for all potential moves in board. These are checkmating pieces if 
         //  checkmate is found. Only tally this up when checking the king
         if(p.getType() == King){
-            for(int x=0; x < board->getPotentialCheckingIndices().size(); x++){
-                int checkingIndex = board->getPotentialCheckingIndices().at(x);
-                if( !count( begin(allCheckingIndices), end(allCheckingIndices), checkingIndex )){
-                    allCheckingIndices.push_back(checkingIndex);
-                }
-            }
+            allCheckingMask |= board->getPotentialCheckingMask();
         }
 
         totalMoves += m->getSizeofAllDestIndices();
@@ -296,33 +273,18 @@ bool Board::isCheckmate(TeamColor team){
     pieceIndices.clear();
     
     if(totalMoves != 0){
-        allCheckingIndices.clear();
         return false;
     }
     else{
-        for(int i=0; i<allCheckingIndices.size(); i++){
-            this->checkmatingIndices.push_back(allCheckingIndices.at(i));
-        }
-        allCheckingIndices.clear();
+        this->checkmatingMask |= allCheckingMask;
         return true;
     }
 }
 
 void Board::printCheckingPieces(){
-    string location;  // location of piece in terms of the board. Ex: A8 instead of 0.
-    int index;
-    if(this->threatenedKingIndices.size() > 0){
+    if(this->threatenedKingMask){
         cout << "Board.cpp: PrintCheckingPieces():";
-        cout << "  Locations: [ ";
-        for(int i=0; i < this->checkingPieceIndices.size(); i++){
-            index = this->checkingPieceIndices.at(i);
-            location = Util::reverseParseIndex(index);   // board value for index. ex A2 or H8.
-            cout << "(" << location << ", " << index << ")";
-            if(i < this->checkingPieceIndices.size() - 1){
-                cout << ", ";
-            }
-        }
-        cout << " ]" << endl;
+        cout << "  Locations: [ " << maskString(this->checkingPieceMask, true) << " ]" << endl;
     }
     else{
         cout << "Board.cpp: printCheckingPieces(): King is NOT checked" << endl;
@@ -332,64 +294,20 @@ void Board::printCheckingPieces(){
 void Board::printPotentialCheckingIndices(){
     cout << "Board.cpp: printPotentialCheckingPieces():";
     cout << "  Locations: [ ";
-    if(this->potentialCheckingIndices.size() > 0){
-        for(int i=0; i < this->potentialCheckingIndices.size(); i++){
-            int index = this->potentialCheckingIndices.at(i);
-            string location = Util::reverseParseIndex(index);   // board value for index. ex A2 or H8.
-            cout << "(" << location << ", " << index << ")";
-            if(i < this->potentialCheckingIndices.size() - 1){
-                cout << ", ";
-            }
-        }
-        cout << " ]" << endl;
+    if(this->potentialCheckingMask){
+        cout << maskString(this->potentialCheckingMask, true) << " ]" << endl;
     }
 }
 
 void Board::printSpecialIndices(){
-    string specialStrs[7] = {
-        "NonSpecial",
-        "Prequel",
-        "Sequel",
-        "Castling", 
-        "EnPassant",
-        "PawnStart",
-        "PawnPromo"
-    };
-    int count = 0;
-
-    cout << "Board.cpp: printSpecialIndices(): [ ";
-
-    if(this->specialHighlightIndices.size() > 0){
-        
-        for(auto const& [key, val] : this->specialHighlightIndices){
-            cout << "{ ";
-            cout << key << ":" << specialStrs[val];
-            cout << " }";
-            if(count < this->specialHighlightIndices.size() - 1){
-                cout << ", ";
-            }
-            count++;
-        }
-    }
-    cout << " ]" << endl;
+    cout << "Board.cpp: printSpecialIndices(): [ " << maskString(this->specialHighlightMask, true) << " ]" << endl;
 }
 
 void Board::printMoveHighlightIndices(){
-string location;  // location of piece in terms of the board. Ex: A8 instead of 0.
-    int index;
-    if(this->moveHighlightIndices.size() > 0){
+    if(this->moveHighlightMask){
         if(DEBUG_MODE){
             cout << "Board.cpp: printMoveHighlightIndices():";
-            cout << "  Locations: [ ";
-            for(int i=0; i < this->moveHighlightIndices.size(); i++){
-                index = this->moveHighlightIndices.at(i);
-                location = Util::reverseParseIndex(index);   // board value for index. ex A2 or H8.
-                cout << "(" << location << ", " << index << ")";
-                if(i < this->moveHighlightIndices.size() - 1){
-                    cout << ", ";
-                }
-            }
-            cout << " ]" << endl;
+            cout << "  Locations: [ " << maskString(this->moveHighlightMask, true) << " ]" << endl;
         }
     }
     else{
@@ -398,141 +316,158 @@ string location;  // location of piece in terms of the board. Ex: A8 instead of
 }
 
 void Board::display(){
-    const string reset("\033[0m");
-    const string tanBackground("\033[48;2;210;164;121m");
-    const string yellowForeground("\033[38;2;255;235;153m");
-    const string yellowBackground("\033[48;2;255;235;153m");
-    const string selectedBackground("\033[48;2;128;223;255m"); // 
-    const string availMoveBackground("\033[48;2;255;255;255m"); // Tsquare is and available move
-    const string checkingBackground("\033[48;2;255;77;77m");     // piece is putting a king in check
-    const string checkedKingBackground("\033[48;2;255;204;0m");// this king is in check
-    const string checkingTargetBackground("\033[48;2;255;204;204m"); // this piece can be captured and it checking the king
-    const string checkmatingBackground = checkingBackground; // this piece is putting a king in checkmate 
-    const string specialBackground("\033[48;2;238;204;255m");   
-    const string blink("\033[5m");
-    const string blinkReset("\033[25m");
-    const string inverse("\033[7m");
-    const string inverseReset("\033[27m");
-
-    // build each line of the board to reduce I/O overhead
-    string line;
-    string displayOut = "";
-    int color;
-    int squareIndex = 0;
-    Piece piece;
-    char rowNumber;
-    string outerPadding = "       ";
-    string letterPadding = " ";
-
-    // Local function to print out the letters that corespond with columns on the board
-    auto uiLetters = [](int rowSize, string padding) -> void {
-        string line = "";
+    FrameBuffer frame;
+    this->render(frame);
+    cout.flush();   // keep anything already printed ahead of the board
+    frame.flush(STDOUT_FILENO);
+}
+
+/**
+    Compose the whole board, with coordinates and highlights, into a frame buffer
+    @param frame Buffer to append the board's lines to. Every line ends with a newline.
+    @returns nothing
+*/
+void Board::render(FrameBuffer& frame){
+    StatTimer timer(RenderStat);
+    // Local function to add the letters that corespond with columns on the board
+    auto uiLetters = [&frame](int rowSize) -> void {
         // Add some extra padding since there is 2 chars length from left corner of board to first square center.
-        cout << " " << padding;
+        frame.append(BOARD_LEFT_MARGIN, BOARD_LEFT_MARGIN_SIZE);
+        frame.append("  ", 2);
         for(int i=0; i<rowSize; i++){
             // determine which values of i line up with the center of a square and print out letter's char. 32 is ascii for ' ' 
             char letter = (i % 2 == 0 && (i / 2) % 2 != 0) ? ((i + 2) / 4 ) + 64 : 32;
-            cout << letter;
+            frame.append(letter);
         }
-        cout << endl;
+        frame.append('\n');
     };
 
-    // print letters at top
-    uiLetters(this->rowSize, outerPadding + letterPadding);
+    // letters at top
+    uiLetters(this->rowSize);
+    for(int j=0; j<this->colSize; j++){
+        this->renderLine(frame, j);
+    }
+    // letters at bottom
+    uiLetters(this->rowSize);
+    // Extra padding at bottom to separate board from input prompt
+    frame.append('\n');
+}
+
+/**
+    Append one line of the drawn board, including the rank numbers on both sides
+    @param frame Buffer to append to
+    @param j Line of the board drawing, from 0 to colSize - 1
+    @returns nothing
+*/
+void Board::renderLine(FrameBuffer& frame, int j){
+    // Actually had the numbers and letters flipped, so this is actually a number.
+    //   48 is 0 in ascii
+    char rowNumber = (j % 2 != 0) ? ((j - 209) / -2) - 48 : 32;
+
+    frame.append(BOARD_LEFT_MARGIN, BOARD_LEFT_MARGIN_SIZE);
+    frame.append(rowNumber);
+    frame.append(' ');
+    int squareIndex = (j / 2) * 8;
+    for(int i=0; i<this->rowSize; i++){
+        // Color board border area
+        if(j % 2 == 0 || i % 4 == 0){
+            frame.append(BOARD_BORDER_COLORS);
+            frame.append(Board::displayboard[j*this->rowSize + i]);
+            frame.append(ANSI_RESET);
+        }
+        // Draw entire square, which is 3 chars wide.
+        else{
+            this->renderSquare(frame, squareIndex);
+            i += 2;
+            squareIndex++;
+        }
+    }
+    frame.append(' ');
+    frame.append(rowNumber);
+    frame.append('\n');
+}
 
-    // string bg;  // background color for each square
+/**
+    Append a single square: its background color, the piece on it and a color reset
+    @param frame Buffer to append to
+    @param index Board index of the square
+    @returns nothing
+*/
+void Board::renderSquare(FrameBuffer& frame, int index){
+    frame.append(this->squareBackground(index));
+    frame.append(' ');
+    frame.append(this->internalboard[index].toString());
+    frame.append(' ');
+    frame.append(ANSI_RESET);
+}
+
+/**
+    Background color of a square, including every kind of highlight
+    @param index Board index of the square
+    @returns An ANSI escape sequence. Always one of the BOARD_*_BACKGROUND constants, so the
+        pointer can be compared to tell if a square's color changed.
+*/
+const char* Board::squareBackground(int index){
+    // create checkered pattern of board
+    const char* bg = ((index / 8 + index) % 2 == 0) ? BOARD_LIGHT_BACKGROUND : BOARD_DARK_BACKGROUND;
+    Bitboard square = Bitboards::squareBB(index);
     bool checkingbg = false;
     bool availbg = false;
-    for (int j=0; j<this->colSize; j++){
-        line = "";
-        for (int i=0; i<this->rowSize; i++){
-            string bg = "";
-            checkingbg = false;
-            availbg = false;
-            // Color board border area
-            if(j % 2 == 0 || i % 4 == 0){
-                line += yellowForeground;
-                line += tanBackground;
-                line += Board::displayboard[j*this->rowSize + i];
-                line += reset;
-            }
-            // Draw entire square, which is 3 chars wide.
-            else{
-                // create checkered pattern of board
-                if(j % 4 == 1){  // account for the edges of rows when coloring squares
-                    bg = (squareIndex % 2 != 0) ? tanBackground : yellowBackground;
-                }
-                else{
-                    bg = (squareIndex % 2 == 0) ? tanBackground : yellowBackground;
-                }
-                // These 3 are all if's to override the basic selection background color
-                // check if this square has a checked king
-                if(find( begin(this->threatenedKingIndices), end(this->threatenedKingIndices), squareIndex) != end(this->threatenedKingIndices)){
-                    bg = checkedKingBackground;
-                }
-                // check if this square is an available move that needs to be highlighted
-                if(find( begin(this->moveHighlightIndices), end(this->moveHighlightIndices), squareIndex) != end(this->moveHighlightIndices)){
-                    bg = availMoveBackground;
-                    availbg = true;
-                }
-                // This move is a special move
-                if(this->specialHighlightIndices.count(squareIndex)){
-                    SpecialMove stype = this->specialHighlightIndices.at(squareIndex);
-                    // This move it a potential Castling move
-                    if(stype == Castling){
-                        bg = specialBackground;
-                    }
-                    // This move it a potential Castling move
-                    else if(stype == EnPassant){
-                        bg = specialBackground;
-                    }
-                    // This pawn can be promoted
-                    else if(stype == PawnPromo){
-                        bg = specialBackground;
-                    }
-                }
-                // check if this square has a piece putting a king in check
-                if(find( begin(this->checkingPieceIndices), end(this->checkingPieceIndices), squareIndex) != end(this->checkingPieceIndices)){
-                    bg = checkingBackground;
-                    checkingbg = true;
-                }
-                // this piece is creating a checkmate
-                if(find( begin(this->checkmatingIndices), end(this->checkmatingIndices), squareIndex) != end(this->checkmatingIndices)){
-                    bg = checkmatingBackground;
-                }
-                // piece is checking the king, but also can be targeted by a piece
-                if(checkingbg && availbg){
-                    bg = checkingTargetBackground;
-                }
-                // specific piece was selected
-                if(squareIndex == this->selectedIndex){
-                    bg = selectedBackground;
-                }
-                
-                line += bg;
-                line += " ";
-                line += this->internalboard[squareIndex].toString();
-                line += " ";
-                i += 2; 
-                squareIndex++;
-            }
-            line += reset;
-        }
-        // Actually had the numbers and letters flipped, so this is actually a number.
-        //   48 is 0 in ascii
-        rowNumber = (j % 2 != 0) ? ((j - 209) / -2) - 48 : 32;
-
-        cout << outerPadding;
-        printf("%c", rowNumber);
-        cout << letterPadding;
-        cout << line;
-        cout << letterPadding;
-        printf("%c\n", rowNumber);
-    }
-    // print letters at bottom
-    uiLetters(this->rowSize, outerPadding + letterPadding);
-    // Extra padding at bottom to separate board from input prompt
-    cout << endl;
+    // These are all if's to override the basic selection background color
+    // check if this square has a checked king
+    if(this->threatenedKingMask & square){
+        bg = BOARD_CHECKED_KING_BACKGROUND;
+    }
+    // check if this square is an available move that needs to be highlighted
+    if(this->moveHighlightMask & square){
+        bg = BOARD_AVAILABLE_MOVE_BACKGROUND;
+        availbg = true;
+    }
+    // This move is a special move: Castling, En Passant or a pawn that can be promoted
+    if(this->specialHighlightMask & square){
+        bg = BOARD_SPECIAL_BACKGROUND;
+    }
+    // check if this square has a piece putting a king in check
+    if(this->checkingPieceMask & square){
+        bg = BOARD_CHECKING_BACKGROUND;
+        checkingbg = true;
+    }
+    // this piece is creating a checkmate
+    if(this->checkmatingMask & square){
+        bg = BOARD_CHECKING_BACKGROUND;
+    }
+    // piece is checking the king, but also can be targeted by a piece
+    if(checkingbg && availbg){
+        bg = BOARD_CHECKING_TARGET_BACKGROUND;
+    }
+    // specific piece was selected
+    if(index == this->selectedIndex){
+        bg = BOARD_SELECTED_BACKGROUND;
+    }
+    return bg;
+}
+
+/**
+    @returns Number of lines render() produces
+*/
+int Board::getDisplayLineCount(){
+    return this->colSize + 3;
+}
+
+/**
+    @param index Board index of a square
+    @returns Line of render()'s output the square is drawn on, starting at 0
+*/
+int Board::getSquareLine(int index){
+    return 1 + 2 * (index / 8) + 1;
+}
+
+/**
+    @param index Board index of a square
+    @returns Column of render()'s output the square starts at, starting at 0
+*/
+int Board::getSquareColumn(int index){
+    return BOARD_LEFT_MARGIN_SIZE + 2 + 4 * (index % 8) + 1;
 }
 
 // Fully initialize the board
@@ -543,16 +478,18 @@ void Board::fullInitialization(){
 
 void Board::initMembers(){
     // The board is an 8x8 grid ofsquares, with each square being a 3x5 grid of chars
-    this->moveHighlightIndices = {};
-    this->checkingPieceIndices = {};
-    this->checkmatingIndices = {};
-    this->threatenedKingIndices = {};
-    this->specialHighlightIndices = {};
+    this->moveHighlightMask = EMPTY_BB;
+    this->checkingPieceMask = EMPTY_BB;
+    this->checkmatingMask = EMPTY_BB;
+    this->threatenedKingMask = EMPTY_BB;
+    this->potentialCheckingMask = EMPTY_BB;
+    this->specialHighlightMask = EMPTY_BB;
     this->promotablePawn = {};
     this->internalboard = new Piece[8*8];
     this->rowSize = 5*8-7;  // 43 -> Each square is 5 chars wide
     this->colSize = 3*8-7;  // 17 -> Each square is 3 chars in height
     this->displayboard = new char[this->rowSize*this->colSize];
+    Stats::count(BoardAllocStat);
     this->selectedIndex = -1;
     this->turnCount = 0;
 }
@@ -638,63 +575,52 @@ vector<int> Board::getTeamPieceIndices(TeamColor tc){
     return vectorIndices;
 }
 
-vector<int> Board::getPotentialCheckingIndices(){
-    return this->potentialCheckingIndices;
+Bitboard Board::getPotentialCheckingMask(){
+    return this->potentialCheckingMask;
 }
 
-vector<int> Board::getThreatenedKingIndices(){
-    return this->threatenedKingIndices;
+Bitboard Board::getThreatenedKingMask(){
+    return this->threatenedKingMask;
 }
 
-void Board::setMoveHighlightIndices(vector<int> newIndices){
-    this->moveHighlightIndices = newIndices;
+void Board::setMoveHighlightMask(Bitboard squares){
+    this->moveHighlightMask = squares;
 }
 
-void Board::appendMoveHighlightIndex(int* newIndices, int size){
-    for(int i=0; i < size; i++){
-        this->moveHighlightIndices.push_back(newIndices[i]);
-    }
+/**
+ * Highlight more squares as available moves
+ * @param squares Squares to add, such as Move::getAllDestMask()
+*/
+void Board::appendMoveHighlightMask(Bitboard squares){
+    this->moveHighlightMask |= squares;
 }
 
 /**
- * Append all values in vector to potentialCheckingIndices
- * @param newIndices Vector to add values from
- * @param duplicates If duplicate values should be added to the array
+ * Add squares to potentialCheckingMask. A square is only ever in the set once.
+ * @param squares Squares to add
 */
-void Board::appendPotentialCheckingIndices(vector<int> newIndices, bool duplicates){
-    for(int i=0; i < newIndices.size(); i++){
-        int val = newIndices.at(i);
-        if( !duplicates){
-            if( !count(begin(this->potentialCheckingIndices), end(this->potentialCheckingIndices), val)){
-                this->potentialCheckingIndices.push_back(val);
-            }
-        }
-        else{
-            this->potentialCheckingIndices.push_back(val);
-        }
-    }
+void Board::appendPotentialCheckingMask(Bitboard squares){
+    this->potentialCheckingMask |= squares;
 }
 
-void Board::setCheckingPieceIndices(vector<int> indices){
-    this->checkingPieceIndices = indices;
+void Board::setCheckingPieceMask(Bitboard squares){
+    this->checkingPieceMask = squares;
 }
 
-void Board::setCheckedKingIndices(vector<int> indices){
-    this->checkingPieceIndices = indices;
+void Board::setCheckedKingMask(Bitboard squares){
+    this->threatenedKingMask = squares;
 }
 
-void Board::appendCheckedKingIndices(int index){
-    this->threatenedKingIndices.push_back(index);
+void Board::appendCheckedKingIndex(int index){
+    this->threatenedKingMask |= Bitboards::squareBB(index);
 }
 
-void Board::appendSpecialIndices(map<int, SpecialMove> table){
-    for(auto it = table.begin(); it != table.end(); it++){
-        int key = it->first;
-        SpecialMove val = it->second;
-        if( !this->specialHighlightIndices.count(key)){
-            this->specialHighlightIndices.insert( {key, val} );
-        }
-    }
+/**
+ * Highlight squares as special moves
+ * @param squares Castling, En Passant and promotion squares, such as Move::getSpecialHighlightMask()
+*/
+void Board::appendSpecialMask(Bitboard squares){
+    this->specialHighlightMask |= squares;
 }
 
 // return index of the king
@@ -773,7 +699,7 @@ void Board::incrementTurnCount(){
 /**
  * Find a pawn on the board that can be promoted for a team
  * @param tc What team's pawns to examine
- * @returns The index of a promotable pawn. Returns -1 otherwise. Updates specialHighlightIndices for Board.
+ * @returns The index of a promotable pawn. Returns -1 otherwise. Updates specialHighlightMask for Board.
 */
 int Board::findPromotablePawn(TeamColor tc){
     if(tc == NoColor){
@@ -793,7 +719,7 @@ int Board::findPromotablePawn(TeamColor tc){
     }
     if(index != -1){
         // this->promotablePawn.push_back(index);
-        this->specialHighlightIndices.insert( {index, SpecialMove::PawnPromo} );
+        this->specialHighlightMask |= Bitboards::squareBB(index);
     }
     return index;    
 }
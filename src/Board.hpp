@@ -2,6 +2,8 @@
 #define Board_H
 
 #include "Piece.hpp"
+#include "Bitboard.hpp"
+#include "FrameBuffer.hpp"
 
 #include <vector>
 #include <iostream>
@@ -22,6 +24,21 @@ enum SpecialMove {
     PawnPromo       // special state for pawn, pawn can be promoted
 };
 
+// ANSI colors used to draw the board. Squares always use one of these arrays, so comparing pointers
+//  tells if a square's background changed.
+inline constexpr char ANSI_RESET[] = "\033[0m";
+inline constexpr char BOARD_BORDER_COLORS[] = "\033[38;2;255;235;153m\033[48;2;210;164;121m";
+inline constexpr char BOARD_DARK_BACKGROUND[] = "\033[48;2;210;164;121m";
+inline constexpr char BOARD_LIGHT_BACKGROUND[] = "\033[48;2;255;235;153m";
+inline constexpr char BOARD_SELECTED_BACKGROUND[] = "\033[48;2;128;223;255m";
+inline constexpr char BOARD_AVAILABLE_MOVE_BACKGROUND[] = "\033[48;2;255;255;255m";     // the square is an available move
+inline constexpr char BOARD_CHECKING_BACKGROUND[] = "\033[48;2;255;77;77m";            // piece is putting a king in check or checkmate
+inline constexpr char BOARD_CHECKED_KING_BACKGROUND[] = "\033[48;2;255;204;0m";        // this king is in check
+inline constexpr char BOARD_CHECKING_TARGET_BACKGROUND[] = "\033[48;2;255;204;204m";   // this piece can be captured and is checking the king
+inline constexpr char BOARD_SPECIAL_BACKGROUND[] = "\033[48;2;238;204;255m";
+inline constexpr char BOARD_LEFT_MARGIN[] = "       ";
+const int BOARD_LEFT_MARGIN_SIZE = sizeof(BOARD_LEFT_MARGIN) - 1;
+
 class Board
 {    
     int rowSize;
@@ -31,13 +48,14 @@ class Board
     int selectedIndex;
     int turnCount;
     bool loaderInit;  // True if the StateFactory class will be loading the initial state for Board
-    vector<int> moveHighlightIndices;
-    map<int, SpecialMove> specialHighlightIndices;
+    // Highlights are sets of squares, bit 'i' is index 'i', so display tests each square with one AND
+    Bitboard moveHighlightMask;  // Squares the selected piece can move to
+    Bitboard specialHighlightMask;  // Castling, En Passant and promotion squares
     vector<int> promotablePawn;
-    vector<int> checkingPieceIndices;  // Indices that contain a piece that is putting a king in check
-    vector<int> potentialCheckingIndices; // all indices that could potentially threaten the king
-    vector<int> threatenedKingIndices;  // Indices of all Kings in check
-    vector<int> checkmatingIndices;  // Indices that contain a piece putting a king in checkmate
+    Bitboard checkingPieceMask;  // Squares that contain a piece that is putting a king in check
+    Bitboard potentialCheckingMask; // all squares that could potentially threaten the king
+    Bitboard threatenedKingMask;  // Squares of all Kings in check
+    Bitboard checkmatingMask;  // Squares that contain a piece putting a king in checkmate
     
 public:
     Board(bool);
@@ -45,6 +63,13 @@ public:
     ~Board();
     void clone(Board*);
     void display();
+    void render(FrameBuffer&);
+    void renderLine(FrameBuffer&, int);
+    void renderSquare(FrameBuffer&, int);
+    const char* squareBackground(int);
+    int getDisplayLineCount();
+    static int getSquareLine(int);
+    static int getSquareColumn(int);
     void clear();
     void reset();
     void printInternal();
@@ -66,21 +91,21 @@ public:
     int getTurnCount();
     int getKingIndex(TeamColor);
     vector<int> getTeamPieceIndices(TeamColor);
-    vector<int> getPotentialCheckingIndices();
-    vector<int> getThreatenedKingIndices();
+    Bitboard getPotentialCheckingMask();
+    Bitboard getThreatenedKingMask();
     // setters
     void setPiece(int, Piece);
     void setPiece(int, TeamColor, PieceType, int);
     void removePiece(int);
-    void setMoveHighlightIndices(vector<int>);
+    void setMoveHighlightMask(Bitboard);
     void setTurnCount(int);
     void incrementTurnCount();
-    void appendMoveHighlightIndex(int*, int);
-    void setCheckingPieceIndices(vector<int>);
-    void setCheckedKingIndices(vector<int>);
-    void appendCheckedKingIndices(int);
-    void appendPotentialCheckingIndices(vector<int>, bool);
-    void appendSpecialIndices(map<int, SpecialMove>);
+    void appendMoveHighlightMask(Bitboard);
+    void setCheckingPieceMask(Bitboard);
+    void setCheckedKingMask(Bitboard);
+    void appendCheckedKingIndex(int);
+    void appendPotentialCheckingMask(Bitboard);
+    void appendSpecialMask(Bitboard);
     void setSelectedIndex(int);
     void promotePiece(int, PieceType);    
     
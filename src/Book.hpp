@@ -0,0 +1,55 @@
+#ifndef Book_H
+#define Book_H
+
+#include "Position.hpp"
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+/*
+    Polyglot opening book.
+
+    A book file is a list of 16 byte entries sorted by key (big endian, no header):
+        uint64   key        Polyglot hash of the position
+        uint16   move       bits 0-5 destination, bits 6-11 source, bits 12-14 promotion
+        uint16   weight     how often the move should be chosen relative to other moves
+        uint32   learn      unused
+    Squares are numbered 0 = A1 to 63 = H8, and promotions are 0 none, 1 Knight, 2 Bishop, 3 Rook,
+     4 Queen. Castling is written as the king capturing its own rook.
+    The file is mapped read-only and searched in place, so processes using the same book share
+     its pages and opening it costs nothing no matter its size.
+*/
+const int BOOK_ENTRY_SIZE = 16;
+const int POLYGLOT_RANDOM_SIZE = 781;
+const uint64_t POLYGLOT_START_KEY = 0x463B96181691FC9CULL;   // Polyglot key of the standard start position
+
+struct BookEntry {
+    uint64_t key;
+    uint16_t move;
+    uint16_t weight;
+    uint32_t learn;
+};
+
+struct BookMove {
+    PackedMove move;
+    int weight;
+};
+
+class Book {
+    public:
+        static void load(string);
+        static void unload();
+        static bool isLoaded();
+        static size_t getEntryCount();
+        static BookEntry getEntry(size_t);
+        static int probeAll(Position&, BookMove*, int);
+        static PackedMove probe(Position&, bool);
+        static uint64_t polyglotKey(Position&);
+        static uint16_t encodeMove(PackedMove);
+        static PackedMove decodeMove(Position&, uint16_t);
+        static void writeEntry(uint8_t*, BookEntry);
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "BookBuilder.hpp"
+#include "Book.hpp"
+#include "ChessException.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+
+using namespace std;
+
+
+/**
+    @param depth Plies of each game to count
+    @param threadCount Number of threads to replay games with
+*/
+BookBuilder::BookBuilder(int depth, int threadCount){
+    this->depth = max(depth, 1);
+    this->threadCount = max(threadCount, 1);
+    this->gamesUsed = 0;
+}
+
+/**
+    Count the opening moves of every game in an archive. Can be called for several archives.
+    @param archive Games to count
+    @returns nothing. Throws ChessException if a game can't be decoded.
+*/
+void BookBuilder::build(GameArchive& archive){
+    atomic<uint64_t> nextGame(0);
+    atomic<uint64_t> used(0);
+    vector<BookTable> tables(this->threadCount);
+    vector<string> errors(this->threadCount);
+
+    // Map: every thread counts the games it takes in its own table
+    auto work = [this, &archive, &nextGame, &used, &tables, &errors](int t){
+        BookTable& counts = tables[t];
+        PgnGame game;
+        Position pos;
+        try{
+            while(true){
+                uint64_t first = nextGame.fetch_add(BOOK_GAMES_PER_TASK);
+                if(first >= archive.getGameCount()){
+                    return;
+                }
+                uint64_t last = min(archive.getGameCount(), first + BOOK_GAMES_PER_TASK);
+                for(uint64_t id = first; id < last; id++){
+                    archive.readHeader(id, game);
+                    GaResult result = GameArchive::encodeResult(game.result);
+                    if(result == GaUnknown){
+                        continue;
+                    }
+                    used++;
+                    archive.replay(id, pos, [&counts, result](Position& before, PackedMove m){
+                        BookStats& s = counts[BookNode{Book::polyglotKey(before), m}];
+                        if(result == GaDraw){
+                            s.draws++;
+                        }
+                        else if((result == GaRedWins) == (before.getSideToMove() == Red)){
+                            s.wins++;
+                        }
+                        else{
+                            s.losses++;
+                        }
+                    }, this->depth);
+                }
+            }
+        }
+        catch(const ChessException &cex){
+            errors[t] = cex.what();
+        }
+    };
+    vector<thread> threads;
+    for(int t=1; t < this->threadCount; t++){
+        threads.emplace_back(work, t);
+    }
+    work(0);
+    for(thread& t : threads){
+        t.join();
+    }
+    for(string& e : errors){
+        if(!e.empty()){
+            throw ChessException(e);
+        }
+    }
+
+    // Reduce: add every thread's counts to the book's table
+    for(BookTable& counts : tables){
+        if(this->table.empty()){
+            this->table.swap(counts);
+            continue;
+        }
+        for(auto const& [node, s] : counts){
+            BookStats& total = this->table[node];
+            total.wins += s.wins;
+            total.draws += s.draws;
+            total.losses += s.losses;
+        }
+        BookTable().swap(counts);
+    }
+    this->gamesUsed += used;
+}
+
+/**
+    Write the counted moves as a Polyglot book
+    @param path Location of the .bin book file
+    @param minGames Moves played in fewer games are left out
+    @returns Number of entries written. Throws ChessException if the file can't be written.
+*/
+uint64_t BookBuilder::writeBook(string path, uint32_t minGames){
+    // Other Polyglot programs only find positions whose keys match the standard ones
+    Position start;
+    start.loadFen(START_FEN);
+    if(Book::polyglotKey(start) != POLYGLOT_START_KEY){
+        throw ChessException("BookBuilder.cpp: Polyglot keys don't match the standard Random64 array");
+    }
+    vector<pair<BookNode, BookStats>> moves = this->sortedMoves(minGames);
+    ofstream out(path, ios::binary | ios::trunc);
+    if(!out){
+        throw ChessException("BookBuilder.cpp: Could not create book file");
+    }
+    vector<uint8_t> data(moves.size() * BOOK_ENTRY_SIZE);
+    for(size_t first = 0; first < moves.size(); ){
+        // Moves of one position, scaled together
+        size_t last = first;
+        uint64_t heaviest = 0;
+        while(last < moves.size() && moves[last].first.key == moves[first].first.key){
+            BookStats& s = moves[last].second;
+            heaviest = max(heaviest, (uint64_t) (2ULL * s.wins + s.draws));
+            last++;
+        }
+        uint64_t scale = (heaviest + 65534) / 65535;
+        for(size_t i = first; i < last; i++){
+            BookStats& s = moves[i].second;
+            BookEntry e;
+            e.key = moves[i].first.key;
+            e.move = Book::encodeMove(moves[i].first.move);
+            e.weight = (uint16_t) ((2ULL * s.wins + s.draws) / max(scale, (uint64_t) 1));
+            e.learn = 0;
+            Book::writeEntry(&data[i * BOOK_ENTRY_SIZE], e);
+        }
+        first = last;
+    }
+    out.write((const char*) data.data(), data.size());
+    if(!out){
+        throw ChessException("BookBuilder.cpp: Could not write book file");
+    }
+    return moves.size();
+}
+
+/**
+    Write the counts of the moves in the book as text
+    @param path Location of the stats file
+    @param minGames Moves played in fewer games are left out
+    @returns Number of moves written. Throws ChessException if the file can't be written.
+*/
+uint64_t BookBuilder::writeStats(string path, uint32_t minGames){
+    vector<pair<BookNode, BookStats>> moves = this->sortedMoves(minGames);
+    ofstream out(path, ios::trunc);
+    if(!out){
+        throw ChessException("BookBuilder.cpp: Could not create stats file");
+    }
+    out << "# key move games wins draws losses" << '\n';
+    for(auto const& [node, s] : moves){
+        out << hex << setw(16) << setfill('0') << node.key << dec << ' ' << Position::moveToString(node.move) << ' ';
+        out << (s.wins + s.draws + s.losses) << ' ' << s.wins << ' ' << s.draws << ' ' << s.losses << '\n';
+    }
+    if(!out){
+        throw ChessException("BookBuilder.cpp: Could not write stats file");
+    }
+    return moves.size();
+}
+
+uint64_t BookBuilder::getGamesUsed(){
+    return this->gamesUsed;
+}
+
+size_t BookBuilder::getMoveCount(){
+    return this->table.size();
+}
+
+/*
+    Private method
+    Moves played in at least minGames games, in book order: by key, then by weight, heaviest first
+*/
+vector<pair<BookNode, BookStats>> BookBuilder::sortedMoves(uint32_t minGames){
+    vector<pair<BookNode, BookStats>> moves;
+    for(auto const& [node, s] : this->table){
+        uint64_t score = 2ULL * s.wins + s.draws;
+        if(s.wins + s.draws + s.losses >= minGames && score > 0){
+            moves.emplace_back(node, s);
+        }
+    }
+    sort(moves.begin(), moves.end(), [](const pair<BookNode, BookStats>& a, const pair<BookNode, BookStats>& b){
+        if(a.first.key != b.first.key){
+            return a.first.key < b.first.key;
+        }
+        uint64_t wa = 2ULL * a.second.wins + a.second.draws;
+        uint64_t wb = 2ULL * b.second.wins + b.second.draws;
+        return (wa != wb) ? wa > wb : a.first.move < b.first.move;
+    });
+    return moves;
+}
@@ -0,0 +1,71 @@
+#ifndef BookBuilder_H
+#define BookBuilder_H
+
+#include "GameArchive.hpp"
+#include "Position.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/*
+    Builds an opening book from the first plies of every game in an archive.
+
+    Each thread replays its own share of the games and counts, for every position and move, how the
+     games that played it ended (the map step). The threads' tables are then merged into one (the
+     reduce step), so the threads never share a table or take a lock while counting.
+    The book written is a Polyglot book. A move's weight is 2 * wins + draws for the team that plays
+     it, scaled down when needed so the heaviest move of a position fits in 16 bits. Games without a
+     result are skipped.
+    The stats file lists every move kept in the book, in the same order, as text:
+        <polyglot key in hex> <move, e.g. e2e4> <games> <wins> <draws> <losses>
+     with wins and losses counted for the team that plays the move.
+*/
+const int BOOK_DEFAULT_DEPTH = 20;
+const int BOOK_GAMES_PER_TASK = 256;    // games a thread takes at a time
+
+struct BookNode {
+    uint64_t key;       // Polyglot key of the position
+    PackedMove move;
+
+    bool operator==(const BookNode& other) const {
+        return this->key == other.key && this->move == other.move;
+    }
+};
+
+struct BookNodeHash {
+    size_t operator()(const BookNode& n) const {
+        return n.key ^ ((uint64_t) n.move * 0x9E3779B97F4A7C15ULL);
+    }
+};
+
+struct BookStats {
+    uint32_t wins;
+    uint32_t draws;
+    uint32_t losses;
+};
+
+typedef unordered_map<BookNode, BookStats, BookNodeHash> BookTable;
+
+class BookBuilder {
+    int depth;
+    int threadCount;
+    BookTable table;
+    uint64_t gamesUsed;
+
+    public:
+        BookBuilder(int, int);
+        void build(GameArchive&);
+        uint64_t writeBook(string, uint32_t);
+        uint64_t writeStats(string, uint32_t);
+        uint64_t getGamesUsed();
+        size_t getMoveCount();
+
+    private:
+        vector<pair<BookNode, BookStats>> sortedMoves(uint32_t);
+};
+
+#endif
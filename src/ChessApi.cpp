@@ -0,0 +1,331 @@
+#include "ChessApi.h"
+#include "Position.hpp"
+#include "Search.hpp"
+#include "TranspositionTable.hpp"
+#include "Nnue.hpp"
+#include "ChessException.hpp"
+
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+    The handle behind ChessPosition*. Keys of earlier positions are kept to find repetitions.
+*/
+struct ChessPosition {
+    Position pos;
+    vector<uint64_t> keys;
+};
+
+static thread_local string lastError;
+static thread_local unique_ptr<Search> threadSearch;   // made on a thread's first search
+
+// The table every search of the library shares, allocated on the first search
+static TranspositionTable& apiTable(){
+    static TranspositionTable table;
+    return table;
+}
+
+static int fail(const char* message){
+    lastError = message;
+    return -1;
+}
+
+// Position::isLegal only checks moves the generator could have made. Moves from C can be anything,
+//  so they are looked up among the legal moves instead.
+static bool isLegalMove(ChessPosition* pos, chess_move move){
+    MoveList legal;
+    pos->pos.generateLegalMoves(legal);
+    return move != NULL_MOVE && legal.contains(move);
+}
+
+// Copy a string for C, like snprintf: as much as fits, and the length of the whole string
+static int copyOut(const string& text, char* out, size_t size){
+    if(out != NULL && size > 0){
+        size_t n = min(text.size(), size - 1);
+        memcpy(out, text.data(), n);
+        out[n] = '\0';
+    }
+    return (int) text.size();
+}
+
+
+// Positions ===================================
+
+int chess_api_version(void){
+    return CHESS_API_VERSION;
+}
+
+/**
+    @returns Why the last call on this thread that failed did. Empty if none has.
+*/
+const char* chess_last_error(void){
+    return lastError.c_str();
+}
+
+/**
+    @returns A new position at the start of a game. Free it with chess_position_free().
+*/
+ChessPosition* chess_position_new(void){
+    return chess_position_from_fen(START_FEN.c_str());
+}
+
+/**
+    @param fen A position in Forsyth-Edwards Notation
+    @returns A new position, or NULL if the FEN isn't a legal position
+*/
+ChessPosition* chess_position_from_fen(const char* fen){
+    try{
+        unique_ptr<ChessPosition> handle(new ChessPosition());
+        if(chess_position_set_fen(handle.get(), fen) != 0){
+            return NULL;
+        }
+        return handle.release();
+    }
+    catch(const exception &e){
+        fail(e.what());
+        return NULL;
+    }
+}
+
+/**
+    @returns A new position with the same moves played, or NULL if there is no memory
+*/
+ChessPosition* chess_position_copy(const ChessPosition* pos){
+    try{
+        return new ChessPosition(*pos);
+    }
+    catch(const exception &e){
+        fail(e.what());
+        return NULL;
+    }
+}
+
+void chess_position_free(ChessPosition* pos){
+    delete pos;
+}
+
+/**
+    Replace the position. Earlier moves are forgotten.
+    @returns 0, or -1 if the FEN isn't a legal position, which leaves the position as it was
+*/
+int chess_position_set_fen(ChessPosition* pos, const char* fen){
+    if(fen == NULL){
+        return fail("ChessApi.cpp: No FEN given");
+    }
+    try{
+        Position loaded;
+        loaded.loadFen(fen);
+        pos->pos = loaded;
+        pos->keys.clear();
+        return 0;
+    }
+    catch(const exception &e){
+        return fail(e.what());
+    }
+}
+
+/**
+    @param out Receives the FEN, cut short if it doesn't fit. May be NULL to ask for the length.
+    @param size Bytes available at out, including the terminating '\0'
+    @returns Length of the whole FEN
+*/
+int chess_position_get_fen(ChessPosition* pos, char* out, size_t size){
+    return copyOut(pos->pos.toFen(), out, size);
+}
+
+/**
+    @returns CHESS_WHITE or CHESS_BLACK
+*/
+int chess_position_side_to_move(ChessPosition* pos){
+    return (pos->pos.getSideToMove() == Red) ? CHESS_WHITE : CHESS_BLACK;
+}
+
+int chess_position_in_check(ChessPosition* pos){
+    return pos->pos.inCheck() ? 1 : 0;
+}
+
+/**
+    @returns A ChessStatus. Repetition means the third time the position appears.
+*/
+int chess_position_status(ChessPosition* pos){
+    Position& p = pos->pos;
+    MoveList legal;
+    p.generateLegalMoves(legal);
+    if(legal.size == 0){
+        return p.inCheck() ? CHESS_CHECKMATE : CHESS_STALEMATE;
+    }
+    if(p.getHalfmoveClock() >= 100){
+        return CHESS_DRAW;
+    }
+    int repetitions = 0;
+    for(int i=2; i <= p.getHalfmoveClock() && i <= (int) pos->keys.size(); i += 2){
+        repetitions += (pos->keys[pos->keys.size() - i] == p.getKey());
+    }
+    if(repetitions >= 2){
+        return CHESS_DRAW;
+    }
+    // Only kings, and at most one bishop or knight between them
+    if( !p.getPieces(Pawn) && !p.getPieces(Rook) && !p.getPieces(Queen)
+        && Bitboards::popCount(p.getPieces(Bishop) | p.getPieces(Knight)) <= 1){
+        return CHESS_DRAW;
+    }
+    return CHESS_PLAYING;
+}
+
+/**
+    @returns The Zobrist key of the position, the same in every build
+*/
+uint64_t chess_position_key(ChessPosition* pos){
+    return pos->pos.getKey();
+}
+
+
+// Moves ===================================
+
+/**
+    @param out Receives the legal moves, as many as fit
+    @param capacity Number of moves out has room for. There are never more than 256.
+    @returns Number of legal moves
+*/
+int chess_generate_moves(ChessPosition* pos, chess_move* out, int capacity){
+    MoveList legal;
+    pos->pos.generateLegalMoves(legal);
+    for(int i=0; i < legal.size && i < capacity; i++){
+        out[i] = legal.moves[i];
+    }
+    return legal.size;
+}
+
+/**
+    @returns 0, or -1 if the move isn't legal in the position
+*/
+int chess_make_move(ChessPosition* pos, chess_move move){
+    if( !isLegalMove(pos, move)){
+        return fail("ChessApi.cpp: Illegal move");
+    }
+    pos->keys.push_back(pos->pos.getKey());
+    pos->pos.makeMove(move);
+    return 0;
+}
+
+/**
+    Take back the last move made with chess_make_move()
+    @returns 0, or -1 if no move was made since the position was loaded
+*/
+int chess_unmake_move(ChessPosition* pos){
+    if(pos->keys.empty()){
+        return fail("ChessApi.cpp: No move to take back");
+    }
+    pos->pos.unmakeMove();
+    pos->keys.pop_back();
+    return 0;
+}
+
+/**
+    @param text A move in coordinate notation, e.g. "e7e8q", or in SAN, e.g. "Nf3"
+    @returns The move, or 0 if it isn't legal in the position
+*/
+chess_move chess_parse_move(ChessPosition* pos, const char* text){
+    if(text == NULL){
+        return NULL_MOVE;
+    }
+    PackedMove m = pos->pos.parseMove(text);
+    if(m == NULL_MOVE){
+        m = pos->pos.parseSan(text);
+    }
+    if(m == NULL_MOVE){
+        fail("ChessApi.cpp: Illegal move");
+    }
+    return m;
+}
+
+/**
+    Write a move in coordinate notation. Like chess_position_get_fen().
+    @returns Length of the whole text
+*/
+int chess_move_to_string(chess_move move, char* out, size_t size){
+    return copyOut(Position::moveToString(move), out, size);
+}
+
+/**
+    Write a legal move in SAN. Like chess_position_get_fen().
+    @returns Length of the whole text, or -1 if the move isn't legal in the position
+*/
+int chess_move_to_san(ChessPosition* pos, chess_move move, char* out, size_t size){
+    if( !isLegalMove(pos, move)){
+        return fail("ChessApi.cpp: Illegal move");
+    }
+    return copyOut(pos->pos.moveToSan(move), out, size);
+}
+
+
+// Search ===================================
+
+/**
+    Search for the best move. Every thread searches with its own Search, and all of them share the
+     transposition table.
+    @returns 0, or -1 if no limit is set
+*/
+int chess_search(ChessPosition* pos, const ChessLimits* limits, ChessSearchResult* result){
+    if(limits == NULL || (limits->time_ms <= 0 && limits->move_time_ms <= 0 && limits->depth <= 0 && limits->nodes == 0)){
+        return fail("ChessApi.cpp: A search needs a time, a depth or a node limit");
+    }
+    try{
+        if( !threadSearch){
+            threadSearch.reset(new Search(&apiTable()));
+        }
+        TimeControl tc;
+        tc.time = limits->time_ms;
+        tc.increment = limits->increment_ms;
+        tc.moveTime = limits->move_time_ms;
+        tc.depth = limits->depth;
+        tc.nodes = limits->nodes;
+        SearchResult found = threadSearch->think(pos->pos, tc);
+        result->best_move = found.bestMove;
+        result->ponder_move = found.ponderMove;
+        result->score = found.score;
+        result->depth = found.depth;
+        result->nodes = found.nodes;
+        result->time_ms = found.time;
+        return 0;
+    }
+    catch(const exception &e){
+        return fail(e.what());
+    }
+}
+
+/**
+    Reallocate the transposition table. Must not be called while a search is running.
+    @returns 0, or -1 if the memory can't be allocated
+*/
+int chess_set_hash_size(size_t mb){
+    try{
+        apiTable().resize(mb);
+        return 0;
+    }
+    catch(const exception &e){
+        return fail(e.what());
+    }
+}
+
+/**
+    Evaluate with a network from now on. Must not be called while a search is running.
+    @returns 0, or -1 if the file isn't a valid network
+*/
+int chess_load_network(const char* path){
+    if(path == NULL){
+        return fail("ChessApi.cpp: No network file given");
+    }
+    try{
+        Nnue::load(path);
+        return 0;
+    }
+    catch(const exception &e){
+        return fail(e.what());
+    }
+}
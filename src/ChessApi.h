@@ -0,0 +1,90 @@
+#ifndef ChessApi_H
+#define ChessApi_H
+
+/*
+    C interface of libchess: positions, legal moves, FEN and search.
+
+    The interface only uses C types and an opaque position handle, so programs in any language can
+     link the shared library, and it stays compatible when the C++ classes behind it change.
+     CHESS_API_VERSION goes up when a function is added, and functions are never changed or removed.
+    Functions that can fail return a negative number, or NULL, and chess_last_error() says why,
+     until the next failure on the same thread. A position may be used by one thread at a time;
+     separate positions can be used and searched on separate threads.
+    Moves are 32 bit values, only meaningful in the position they were generated for. 0 is no move.
+*/
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHESS_API_VERSION 1
+#define CHESS_API __attribute__((visibility("default")))
+
+typedef struct ChessPosition ChessPosition;
+typedef uint32_t chess_move;
+
+enum ChessColor {
+    CHESS_WHITE = 0,
+    CHESS_BLACK = 1
+};
+
+enum ChessStatus {
+    CHESS_PLAYING = 0,
+    CHESS_CHECKMATE = 1,
+    CHESS_STALEMATE = 2,
+    CHESS_DRAW = 3          /* 50 move rule, repetition or insufficient material */
+};
+
+/* Limits of a search. 0 means the limit isn't used. At least one must be set. */
+typedef struct ChessLimits {
+    int64_t time_ms;        /* time left on the clock of the side to move */
+    int64_t increment_ms;
+    int64_t move_time_ms;   /* search for exactly this long */
+    int depth;
+    uint64_t nodes;
+} ChessLimits;
+
+typedef struct ChessSearchResult {
+    chess_move best_move;
+    chess_move ponder_move;
+    int score;              /* centipawns from the side to move's point of view */
+    int depth;
+    uint64_t nodes;
+    int64_t time_ms;
+} ChessSearchResult;
+
+CHESS_API int chess_api_version(void);
+CHESS_API const char* chess_last_error(void);
+
+/* Positions */
+CHESS_API ChessPosition* chess_position_new(void);
+CHESS_API ChessPosition* chess_position_from_fen(const char* fen);
+CHESS_API ChessPosition* chess_position_copy(const ChessPosition* pos);
+CHESS_API void chess_position_free(ChessPosition* pos);
+CHESS_API int chess_position_set_fen(ChessPosition* pos, const char* fen);
+CHESS_API int chess_position_get_fen(ChessPosition* pos, char* out, size_t size);
+CHESS_API int chess_position_side_to_move(ChessPosition* pos);
+CHESS_API int chess_position_in_check(ChessPosition* pos);
+CHESS_API int chess_position_status(ChessPosition* pos);
+CHESS_API uint64_t chess_position_key(ChessPosition* pos);
+
+/* Moves */
+CHESS_API int chess_generate_moves(ChessPosition* pos, chess_move* out, int capacity);
+CHESS_API int chess_make_move(ChessPosition* pos, chess_move move);
+CHESS_API int chess_unmake_move(ChessPosition* pos);
+CHESS_API chess_move chess_parse_move(ChessPosition* pos, const char* text);
+CHESS_API int chess_move_to_string(chess_move move, char* out, size_t size);
+CHESS_API int chess_move_to_san(ChessPosition* pos, chess_move move, char* out, size_t size);
+
+/* Search */
+CHESS_API int chess_search(ChessPosition* pos, const ChessLimits* limits, ChessSearchResult* result);
+CHESS_API int chess_set_hash_size(size_t mb);
+CHESS_API int chess_load_network(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
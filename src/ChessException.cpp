@@ -12,13 +12,13 @@ ChessException::ChessException(const char* msg){
     this->msg = msg;
 }
 ChessException::ChessException(string msg){
-    this->msg = msg.c_str();
+    this->msg = msg;
 }
 
 ChessException::~ChessException() =  default;
 
 const char* ChessException::what() const _GLIBCXX_TXN_SAFE_DYN _GLIBCXX_NOTHROW {
-    return this->msg;
+    return this->msg.c_str();
 }
 
 void ChessException::setMsg(const char* msg){
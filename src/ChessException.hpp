@@ -2,13 +2,14 @@
 #define ChessException_H
 
 #include <iostream>
+#include <string>
 
 using namespace std;
 
 
 class ChessException : public std::exception
 {   
-    const char* msg;
+    string msg;     // owned, so messages built at the throw site outlive it
 
     public:
         ChessException(const char*);
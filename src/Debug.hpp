@@ -4,5 +4,7 @@
 #define DEBUG_MODE false
 #define CHECK_DEBUG false
 #define POTENTIAL_STATE_DEBUG false
+#define EVAL_DEBUG false    // recompute the full evaluation and compare it to the incremental score
+#define STATS_MODE true     // count calls, time and allocations of the hot paths. See Stats.hpp
 
 #endif
\ No newline at end of file
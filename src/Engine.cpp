@@ -0,0 +1,256 @@
+#include "Engine.hpp"
+
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+
+Engine::Engine() : search(&this->table){
+    this->searching = false;
+    this->quickSearch = false;
+    this->hasResult = false;
+    this->resultKey = 0;
+    this->worker = thread(&Engine::loop, this);
+}
+
+Engine::~Engine(){
+    this->stop();
+    EngineCommand quit;
+    quit.task = EngineQuit;
+    this->post(quit);
+    this->worker.join();
+}
+
+/**
+    Start searching for a move in the background. Use wait() to get the move.
+    @param pos Position to search. It is copied.
+    @param tc Time and depth limits
+    @returns nothing
+*/
+void Engine::think(Position& pos, TimeControl tc){
+    EngineCommand cmd;
+    cmd.task = EngineThink;
+    cmd.pos = pos;
+    cmd.tc = tc;
+    this->post(cmd);
+}
+
+/**
+    Search a position without a time limit until stop() is called
+    @param pos Position to search. It is copied.
+    @returns nothing
+*/
+void Engine::ponder(Position& pos){
+    EngineCommand cmd;
+    cmd.task = EnginePonder;
+    cmd.pos = pos;
+    cmd.tc = TimeControl();
+    cmd.tc.infinite = true;
+    this->post(cmd);
+}
+
+/**
+    Stop the running search, and cut queued searches to one ply so they return a move at once.
+     Returns once the engine thread is idle.
+*/
+void Engine::stop(){
+    unique_lock<mutex> guard(this->lock);
+    for(EngineCommand& cmd : this->queue){
+        cmd.stopped = true;
+    }
+    // The worker may have taken a command without having started its search yet, and starting a
+    //  search clears the stop flag. Keep stopping until the worker reports it is done.
+    while(this->searching || !this->queue.empty()){
+        // One ply searches are left to finish, so they always find a move
+        if(this->searching && !this->quickSearch){
+            this->search.stop();
+        }
+        this->done.wait_for(guard, chrono::milliseconds(1));
+    }
+}
+
+/**
+    Block until every queued search has finished
+    @returns The result of the last search
+*/
+SearchResult Engine::wait(){
+    unique_lock<mutex> guard(this->lock);
+    this->done.wait(guard, [this] { return !this->searching && this->queue.empty(); });
+    return this->result;
+}
+
+/**
+    Get the result of the last finished search if it was searched from a given position
+    @param key Zobrist key of the position
+    @param out Set to the result when one is found
+    @returns true if a result was found
+*/
+bool Engine::getResult(uint64_t key, SearchResult& out){
+    lock_guard<mutex> guard(this->lock);
+    if(!this->hasResult || this->searching || this->resultKey != key){
+        return false;
+    }
+    out = this->result;
+    return true;
+}
+
+bool Engine::isSearching(){
+    lock_guard<mutex> guard(this->lock);
+    return this->searching || !this->queue.empty();
+}
+
+/**
+    Start the clock of a search queued with TimeControl::ponder
+*/
+void Engine::ponderhit(){
+    this->search.ponderhit();
+}
+
+/**
+    @returns Nodes searched by all threads in the current or last search
+*/
+uint64_t Engine::getNodes(){
+    uint64_t total = this->search.getNodes();
+    for(auto& helper : this->helpers){
+        total += helper->getNodes();
+    }
+    return total;
+}
+
+/**
+    Set the number of threads searching together. Stops any running search.
+    @param count Threads including the main search, 1 to MAX_THREADS
+    @returns nothing
+*/
+void Engine::setThreads(int count){
+    this->stop();
+    count = min(max(count, 1), MAX_THREADS);
+    this->helpers.resize(count - 1);
+    for(int i=0; i < (int) this->helpers.size(); i++){
+        if(!this->helpers[i]){
+            this->helpers[i].reset(new Search(&this->table));
+            this->helpers[i]->setThreadIndex(i + 1);
+        }
+    }
+}
+
+int Engine::getThreads(){
+    return (int) this->helpers.size() + 1;
+}
+
+/**
+    @returns The table every thread of this engine searches with. Only resize or clear it after stop().
+*/
+TranspositionTable& Engine::getTable(){
+    return this->table;
+}
+
+/**
+    @param callback Called on the engine thread after each iteration of the main search
+*/
+void Engine::setInfoCallback(function<void(SearchResult&)> callback){
+    this->stop();
+    this->search.setInfoCallback(callback);
+}
+
+/**
+    @param callback Called on the engine thread when a search finishes, before wait() returns
+*/
+void Engine::setResultCallback(function<void(SearchResult&)> callback){
+    this->stop();
+    lock_guard<mutex> guard(this->lock);
+    this->resultCallback = callback;
+}
+
+// Private method
+void Engine::post(EngineCommand cmd){
+    {
+        lock_guard<mutex> guard(this->lock);
+        this->queue.push_back(cmd);
+    }
+    this->wake.notify_one();
+}
+
+/*
+    Private method
+    Body of the engine thread. Runs queued commands one at a time.
+*/
+void Engine::loop(){
+    while(true){
+        EngineCommand cmd;
+        {
+            unique_lock<mutex> guard(this->lock);
+            this->wake.wait(guard, [this] { return !this->queue.empty(); });
+            cmd = this->queue.front();
+            this->queue.pop_front();
+            if(cmd.task == EngineQuit){
+                return;
+            }
+            this->searching = true;
+            this->quickSearch = cmd.stopped;
+        }
+        SearchResult found = this->runSearch(cmd);
+        function<void(SearchResult&)> callback;
+        {
+            lock_guard<mutex> guard(this->lock);
+            this->result = found;
+            this->resultKey = cmd.pos.getKey();
+            // A one ply search isn't worth playing instead of searching again
+            this->hasResult = !cmd.stopped;
+            callback = this->resultCallback;
+        }
+        if(callback){
+            callback(found);
+        }
+        {
+            lock_guard<mutex> guard(this->lock);
+            this->searching = false;
+        }
+        this->done.notify_all();
+    }
+}
+
+/*
+    Private method
+    Run the main search on this thread and the helper searches on their own threads until the main
+     search finishes
+*/
+SearchResult Engine::runSearch(EngineCommand& cmd){
+    if(cmd.stopped){
+        TimeControl quick;
+        quick.depth = 1;
+        return this->search.think(cmd.pos, quick);
+    }
+    if(this->helpers.empty()){
+        return this->search.think(cmd.pos, cmd.tc);
+    }
+    TimeControl helperTc;
+    helperTc.infinite = true;
+    helperTc.depth = cmd.tc.depth;
+    atomic<int> running(0);
+    vector<thread> threads;
+    for(auto& helper : this->helpers){
+        helper->clearNodes();
+    }
+    for(auto& helper : this->helpers){
+        Search* h = helper.get();
+        running++;
+        threads.emplace_back([h, &cmd, helperTc, &running] {
+            h->think(cmd.pos, helperTc);
+            running--;
+        });
+    }
+    SearchResult found = this->search.think(cmd.pos, cmd.tc);
+    // A helper that hasn't started yet clears its stop flag when it does, so keep stopping them
+    while(running > 0){
+        for(auto& helper : this->helpers){
+            helper->stop();
+        }
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    for(thread& t : threads){
+        t.join();
+    }
+    return found;
+}
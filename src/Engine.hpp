@@ -0,0 +1,85 @@
+#ifndef Engine_H
+#define Engine_H
+
+#include "Position.hpp"
+#include "Search.hpp"
+#include "TimeManager.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum EngineTask {
+    EngineThink,    // timed search for a move to play
+    EnginePonder,   // search until stopped, while waiting for the player
+    EngineQuit
+};
+
+struct EngineCommand {
+    EngineTask task;
+    Position pos;
+    TimeControl tc;
+    bool stopped = false;   // stop() was called before the search started
+};
+
+const int MAX_THREADS = 64;
+
+/*
+    Runs a Search on its own thread, fed by a command queue.
+    The game thread queues work and keeps handling input. Searches queued with ponder() run until
+     stop() is called, so the time the player spends typing is spent searching. Searches that stop()
+     catches still in the queue run anyway, only one ply deep, so every search queued with think()
+     reports a move through the result callback, as UCI requires of every "go". The result of the
+     last finished search is kept, keyed by the position's Zobrist key, so it can be reused when the
+     game reaches that position.
+    With more than one thread, helper searches run alongside the main search on the same position
+     (lazy SMP). They only share work through the engine's TranspositionTable, and the main search's
+     move is played. Every Engine has its own table, so engines never see each other's results.
+*/
+class Engine {
+    TranspositionTable table;       // declared before the searches, which are given it
+    Search search;
+    vector<unique_ptr<Search>> helpers;
+    thread worker;
+    mutex lock;                     // guards everything below
+    function<void(SearchResult&)> resultCallback;
+    condition_variable wake;        // signalled when a command is queued
+    condition_variable done;        // signalled when a search finishes
+    deque<EngineCommand> queue;
+    bool searching;
+    bool quickSearch;               // the running search is a one ply search cut short by stop()
+    bool hasResult;
+    uint64_t resultKey;             // key of the position 'result' was searched from
+    SearchResult result;
+
+    public:
+        Engine();
+        ~Engine();
+        void think(Position&, TimeControl);
+        void ponder(Position&);
+        void stop();
+        SearchResult wait();
+        bool getResult(uint64_t, SearchResult&);
+        bool isSearching();
+        void ponderhit();
+        uint64_t getNodes();
+        void setThreads(int);
+        int getThreads();
+        TranspositionTable& getTable();
+        void setInfoCallback(function<void(SearchResult&)>);
+        void setResultCallback(function<void(SearchResult&)>);
+
+    private:
+        void post(EngineCommand);
+        void loop();
+        SearchResult runSearch(EngineCommand&);
+};
+
+#endif
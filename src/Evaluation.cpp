@@ -0,0 +1,143 @@
+#include "Evaluation.hpp"
+#include "Position.hpp"
+#include "Bitboard.hpp"
+#include "Nnue.hpp"
+#include "PawnTable.hpp"
+#include "Kpk.hpp"
+#include "Tablebase.hpp"
+#include "ChessException.hpp"
+#include "Debug.hpp"
+
+#include <iostream>
+#include <cstring>
+
+using namespace std;
+
+/*
+    All methods are static in Evaluation
+*/
+
+
+/**
+    Static evaluation of a position. Uses the neural network when one is loaded, otherwise the
+     material and piece-square score plus the pawn structure from the calling thread's pawn table.
+    @param pos The Position to evaluate
+    @param useNnue false to use the classical evaluation even when a network is loaded
+    @returns Score in centipawns from the point of view of the team to move
+*/
+int Evaluation::evaluate(Position& pos, bool useNnue){
+    // Endgames in the tablebases are scored exactly. Faster mates score higher.
+    TbResult tb;
+    if(Tablebase::getTableCount() > 0 && Tablebase::probe(pos, tb)){
+        return tb.wdl * (KNOWN_WIN + TB_MAX_PLIES - tb.plies);
+    }
+
+    // King and pawn vs king is scored exactly from the bitbase. Positions loaded from a FEN may be
+    //  missing a king, which the bitbase can't index.
+    if(pos.getPieces(Pawn) && Bitboards::popCount(pos.getOccupied()) == 3
+        && pos.getPieces(Red, King) && pos.getPieces(Black, King)){
+        return evaluateKpk(pos);
+    }
+
+    if(useNnue && Nnue::isLoaded()){
+        int score = Nnue::evaluate(pos, pos.getAccumulator());
+        /** DEBUG: the incrementally updated accumulator must match a freshly built one */
+        if(DEBUG_MODE && EVAL_DEBUG){
+            Accumulator fresh;
+            Nnue::refresh(pos, fresh, Red);
+            Nnue::refresh(pos, fresh, Black);
+            if(memcmp(fresh.values, pos.getAccumulator().values, sizeof(fresh.values)) != 0){
+                throw ChessException("Evaluation.cpp: Incremental NNUE accumulator does not match full refresh");
+            }
+        }
+        return score;
+    }
+
+    Score psq = pos.getPsqScore();
+    int phase = pos.getPhase();
+
+    /** DEBUG: the incremental totals must match a full recalculation */
+    if(DEBUG_MODE && EVAL_DEBUG){
+        Score full = computePsq(pos);
+        int fullPhase = computePhase(pos);
+        if(full != psq || fullPhase != phase){
+            cout << "Evaluation.cpp: incremental psq (" << psq.mg << ", " << psq.eg << ") phase " << phase;
+            cout << " | full psq (" << full.mg << ", " << full.eg << ") phase " << fullPhase << endl;
+            throw ChessException("Evaluation.cpp: Incremental evaluation does not match full recalculation");
+        }
+    }
+
+    PawnEntry* pawns = PawnTable::local().probe(pos);
+    /** DEBUG: a cached pawn evaluation must match one calculated from scratch */
+    if(DEBUG_MODE && EVAL_DEBUG){
+        Bitboard passed[3];
+        if(PawnTable::evaluatePawns(pos, passed) != pawns->score){
+            throw ChessException("Evaluation.cpp: Cached pawn evaluation does not match recalculation");
+        }
+    }
+    psq += pawns->score;
+
+    int score = taper(psq, phase);
+    return (pos.getSideToMove() == Red) ? score : -score;
+}
+
+/**
+    Score a king and pawn vs king position with the KPK bitbase
+    @param pos Position with only two kings and one pawn
+    @returns KNOWN_WIN plus a bonus for advancing the pawn if the team with the pawn wins, 0 if it
+     is a draw. From the point of view of the team to move.
+*/
+int Evaluation::evaluateKpk(Position& pos){
+    int pawn = Bitboards::lsb(pos.getPieces(Pawn));
+    TeamColor strong = pos.getTeam(pawn);
+    TeamColor weak = (strong == Red) ? Black : Red;
+    if(!Kpk::probe(strong, pos.getKingIndex(strong), pawn, pos.getKingIndex(weak), pos.getSideToMove())){
+        return 0;
+    }
+    int rank = (strong == Red) ? 8 - pawn / 8 : pawn / 8 + 1;
+    int score = KNOWN_WIN + pieceValue[Pawn].eg + 10 * rank;
+    return (pos.getSideToMove() == strong) ? score : -score;
+}
+
+/**
+    Recalculate the material and piece-square score by scanning the board.
+    Only used to verify the score Position updates incrementally.
+    @param pos The Position to scan
+    @returns Score from Red's point of view
+*/
+Score Evaluation::computePsq(Position& pos){
+    Score total = { 0, 0 };
+    for(int i=0; i < 64; i++){
+        TeamColor tc = pos.getTeam(i);
+        if(tc != NoColor){
+            total += PSQ_TABLES.psq[tc][pos.getType(i)][i];
+        }
+    }
+    return total;
+}
+
+/**
+    Recalculate the game phase by counting pieces
+    @param pos The Position to count
+    @returns Sum of phaseWeight over all pieces
+*/
+int Evaluation::computePhase(Position& pos){
+    int phase = 0;
+    for(int pt = Queen; pt < Pawn; pt++){
+        phase += phaseWeight[pt] * Bitboards::popCount(pos.getPieces((PieceType) pt));
+    }
+    return phase;
+}
+
+/**
+    Blend midgame and endgame scores
+    @param s Midgame and endgame score
+    @param phase Game phase. MAX_PHASE or more is a full midgame, 0 is a pure endgame.
+    @returns Tapered score
+*/
+int Evaluation::taper(Score s, int phase){
+    if(phase > MAX_PHASE){
+        phase = MAX_PHASE;   // promotions can push the phase above a full set of pieces
+    }
+    return (s.mg * phase + s.eg * (MAX_PHASE - phase)) / MAX_PHASE;
+}
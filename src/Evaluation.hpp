@@ -0,0 +1,157 @@
+#ifndef Evaluation_H
+#define Evaluation_H
+
+#include "Piece.hpp"
+
+using namespace std;
+
+class Position;
+
+/*
+    A pair of scores in centipawns. 'mg' is used while many pieces are on the board (midgame), 'eg' is
+     used once most pieces have been traded (endgame). The final score is tapered between the two
+     based on the game phase.
+*/
+struct Score {
+    int mg;
+    int eg;
+};
+
+inline Score operator+(Score a, Score b){ return { a.mg + b.mg, a.eg + b.eg }; }
+inline Score operator-(Score a, Score b){ return { a.mg - b.mg, a.eg - b.eg }; }
+inline Score& operator+=(Score& a, Score b){ a.mg += b.mg; a.eg += b.eg; return a; }
+inline Score& operator-=(Score& a, Score b){ a.mg -= b.mg; a.eg -= b.eg; return a; }
+inline bool operator==(Score a, Score b){ return a.mg == b.mg && a.eg == b.eg; }
+inline bool operator!=(Score a, Score b){ return !(a == b); }
+
+// Material value of each PieceType. Kings are never captured so they have no material value.
+const Score pieceValue[7] = {
+    { 0, 0 },       // NoPiece
+    { 0, 0 },       // King
+    { 1025, 936 },  // Queen
+    { 477, 512 },   // Rook
+    { 365, 297 },   // Bishop
+    { 337, 281 },   // Knight
+    { 82, 94 }      // Pawn
+};
+
+// Contribution of each PieceType to the game phase. A full set of pieces is MAX_PHASE.
+const int phaseWeight[7] = { 0, 0, 4, 2, 1, 1, 0 };
+const int MAX_PHASE = 24;
+
+// Score for positions known to be won, such as a winning king and pawn vs king ending
+const int KNOWN_WIN = 10000;
+
+/*
+    Positional bonus for each PieceType, from Red's point of view. Rows are ranks 1-8 and columns are
+     files A-D. Files E-H mirror files A-D. Pawns never stand on ranks 1 or 8.
+*/
+const Score psqBonus[7][8][4] = {
+    { },    // NoPiece
+    {       // King
+        { { 271, 1 }, { 327, 45 }, { 271, 85 }, { 198, 76 } },
+        { { 278, 53 }, { 303, 100 }, { 234, 133 }, { 179, 135 } },
+        { { 195, 88 }, { 258, 130 }, { 169, 169 }, { 120, 175 } },
+        { { 164, 103 }, { 190, 156 }, { 138, 172 }, { 98, 172 } },
+        { { 154, 96 }, { 179, 166 }, { 105, 199 }, { 70, 199 } },
+        { { 123, 92 }, { 145, 172 }, { 81, 184 }, { 31, 191 } },
+        { { 88, 47 }, { 120, 121 }, { 65, 116 }, { 33, 131 } },
+        { { 59, 11 }, { 89, 59 }, { 45, 73 }, { -1, 78 } }
+    },
+    {       // Queen
+        { { 3, -69 }, { -5, -57 }, { -5, -47 }, { 4, -26 } },
+        { { -3, -55 }, { 5, -31 }, { 8, -22 }, { 12, -4 } },
+        { { -3, -39 }, { 6, -18 }, { 13, -9 }, { 7, 3 } },
+        { { 4, -23 }, { 5, -3 }, { 9, 13 }, { 8, 24 } },
+        { { 0, -29 }, { 14, -6 }, { 12, 9 }, { 5, 21 } },
+        { { -4, -38 }, { 10, -18 }, { 6, -12 }, { 8, 1 } },
+        { { -5, -50 }, { 6, -27 }, { 10, -24 }, { 8, -8 } },
+        { { -2, -75 }, { -2, -52 }, { 1, -43 }, { -2, -36 } }
+    },
+    {       // Rook
+        { { -31, -9 }, { -20, -13 }, { -14, -10 }, { -5, -9 } },
+        { { -21, -12 }, { -13, -9 }, { -8, -1 }, { 6, -2 } },
+        { { -25, 6 }, { -11, -8 }, { -1, -2 }, { 3, -6 } },
+        { { -13, -6 }, { -5, 1 }, { -4, -9 }, { -6, 7 } },
+        { { -27, -5 }, { -15, 8 }, { -4, 7 }, { 3, -6 } },
+        { { -22, 6 }, { -2, 1 }, { 6, -7 }, { 12, 10 } },
+        { { -2, 4 }, { 12, 5 }, { 16, 20 }, { 18, -5 } },
+        { { -17, 18 }, { -19, 0 }, { -1, 19 }, { 9, 13 } }
+    },
+    {       // Bishop
+        { { -53, -57 }, { -5, -30 }, { -8, -37 }, { -23, -12 } },
+        { { -15, -37 }, { 8, -13 }, { 19, -17 }, { 4, 1 } },
+        { { -7, -16 }, { 21, -1 }, { -5, -2 }, { 17, 10 } },
+        { { -5, -20 }, { 11, -6 }, { 25, 0 }, { 39, 17 } },
+        { { -12, -17 }, { 29, -1 }, { 22, -14 }, { 31, 15 } },
+        { { -16, -30 }, { 6, 6 }, { 1, 4 }, { 11, 6 } },
+        { { -17, -31 }, { -14, -20 }, { 5, -1 }, { 0, 1 } },
+        { { -48, -46 }, { 1, -42 }, { -14, -37 }, { -23, -24 } }
+    },
+    {       // Knight
+        { { -175, -96 }, { -92, -65 }, { -74, -49 }, { -73, -21 } },
+        { { -77, -67 }, { -41, -54 }, { -27, -18 }, { -15, 8 } },
+        { { -61, -40 }, { -17, -27 }, { 6, -8 }, { 12, 29 } },
+        { { -35, -35 }, { 8, -2 }, { 40, 13 }, { 49, 28 } },
+        { { -34, -45 }, { 13, -16 }, { 44, 9 }, { 51, 39 } },
+        { { -9, -51 }, { 22, -44 }, { 58, -16 }, { 53, 17 } },
+        { { -67, -69 }, { -27, -50 }, { 4, -51 }, { 37, 12 } },
+        { { -201, -100 }, { -83, -88 }, { -56, -56 }, { -26, -17 } }
+    },
+    {       // Pawn
+        { },
+        { { -5, -4 }, { 4, -6 }, { 8, 2 }, { 6, 4 } },
+        { { -8, -6 }, { -6, -4 }, { 6, -2 }, { 14, -3 } },
+        { { -6, 2 }, { -2, 0 }, { 12, -6 }, { 22, -8 } },
+        { { 2, 10 }, { 6, 6 }, { 10, 0 }, { 18, -4 } },
+        { { 8, 28 }, { 10, 24 }, { 14, 18 }, { 16, 14 } },
+        { { 12, 60 }, { 14, 56 }, { 16, 50 }, { 18, 46 } },
+        { }
+    }
+};
+
+/*
+    Full piece-square tables, built at compile time from pieceValue and psqBonus.
+    psq[team][type][index] is the material plus positional score of a piece on a Board index, from
+     Red's point of view. Black scores are mirrored vertically and negated, so a position's score is
+     the sum of psq over all pieces.
+*/
+struct PsqTables {
+    Score psq[3][7][64];
+};
+
+constexpr PsqTables buildPsqTables(){
+    PsqTables t = {};
+    for(int pt = King; pt <= Pawn; pt++){
+        for(int index=0; index < 64; index++){
+            int row = index / 8;
+            int col = index % 8;
+            int fileCol = (col < 4) ? col : 7 - col;  // mirror files E-H onto A-D
+            // Red's rank 1 is row 7 of the internal board. Black's rank 1 is row 0.
+            Score red = psqBonus[pt][7 - row][fileCol];
+            Score black = psqBonus[pt][row][fileCol];
+            t.psq[Red][pt][index] = { pieceValue[pt].mg + red.mg, pieceValue[pt].eg + red.eg };
+            t.psq[Black][pt][index] = { -(pieceValue[pt].mg + black.mg), -(pieceValue[pt].eg + black.eg) };
+        }
+    }
+    return t;
+}
+
+inline constexpr PsqTables PSQ_TABLES = buildPsqTables();
+
+
+/*
+    Static evaluation of a Position. The material and piece-square part of the score is updated
+     incrementally by Position whenever a piece is added or removed, so evaluating only combines
+     a few precomputed totals.
+*/
+class Evaluation {
+    public:
+        static int evaluate(Position&, bool = true);
+        static int evaluateKpk(Position&);
+        static Score computePsq(Position&);
+        static int computePhase(Position&);
+        static int taper(Score, int);
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "FrameBuffer.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <unistd.h>
+
+using namespace std;
+
+
+FrameBuffer::FrameBuffer(size_t size){
+    this->capacity = (size > 0) ? size : 1;
+    this->length = 0;
+    this->data = (char*) malloc(this->capacity);
+    if(this->data == NULL){
+        throw bad_alloc();
+    }
+}
+
+FrameBuffer::~FrameBuffer(){
+    free(this->data);
+}
+
+/*
+    Empty the buffer. The memory is kept for the next frame.
+*/
+void FrameBuffer::clear(){
+    this->length = 0;
+}
+
+void FrameBuffer::append(const char* str, size_t len){
+    this->reserve(len);
+    memcpy(this->data + this->length, str, len);
+    this->length += len;
+}
+
+void FrameBuffer::append(const char* str){
+    this->append(str, strlen(str));
+}
+
+void FrameBuffer::append(const string& str){
+    this->append(str.data(), str.size());
+}
+
+void FrameBuffer::append(char c){
+    this->reserve(1);
+    this->data[this->length++] = c;
+}
+
+void FrameBuffer::appendInt(int value){
+    char digits[12];
+    int n = 0;
+    unsigned int v = (value < 0) ? -(unsigned int) value : value;
+    do{
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while(v > 0);
+    if(value < 0){
+        this->append('-');
+    }
+    while(n > 0){
+        this->append(digits[--n]);
+    }
+}
+
+/**
+    Append an ANSI escape sequence that moves the cursor
+    @param row Terminal row, starting at 1
+    @param col Terminal column, starting at 1
+    @returns nothing
+*/
+void FrameBuffer::moveCursor(int row, int col){
+    this->append("\033[", 2);
+    this->appendInt(row);
+    this->append(';');
+    this->appendInt(col);
+    this->append('H');
+}
+
+/**
+    Write the whole buffer to a file descriptor and empty it
+    @param fd File descriptor, e.g. STDOUT_FILENO
+    @returns false if the write failed
+*/
+bool FrameBuffer::flush(int fd){
+    size_t written = 0;
+    // A single write() normally takes everything. Pipes and slow terminals may take less.
+    while(written < this->length){
+        ssize_t n = write(fd, this->data + written, this->length - written);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            this->length = 0;
+            return false;
+        }
+        written += n;
+    }
+    this->length = 0;
+    return true;
+}
+
+const char* FrameBuffer::getData(){
+    return this->data;
+}
+
+size_t FrameBuffer::size(){
+    return this->length;
+}
+
+/*
+    Private method
+    Make room for 'extra' more characters
+*/
+void FrameBuffer::reserve(size_t extra){
+    if(this->length + extra <= this->capacity){
+        return;
+    }
+    size_t grown = this->capacity;
+    while(this->length + extra > grown){
+        grown *= 2;
+    }
+    char* bigger = (char*) realloc(this->data, grown);
+    if(bigger == NULL){
+        throw bad_alloc();
+    }
+    this->data = bigger;
+    this->capacity = grown;
+}
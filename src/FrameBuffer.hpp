@@ -0,0 +1,41 @@
+#ifndef FrameBuffer_H
+#define FrameBuffer_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+const size_t FRAME_BUFFER_SIZE = 64 * 1024;     // enough for a full frame with every square highlighted
+
+/*
+    Growable character buffer a whole terminal frame is composed in, so it can be written with a
+     single system call instead of many small stream writes
+*/
+class FrameBuffer {
+    char* data;
+    size_t length;
+    size_t capacity;
+
+    public:
+        FrameBuffer(size_t = FRAME_BUFFER_SIZE);
+        ~FrameBuffer();
+        FrameBuffer(const FrameBuffer&) = delete;
+        FrameBuffer& operator=(const FrameBuffer&) = delete;
+        void clear();
+        void append(const char*, size_t);
+        void append(const char*);
+        void append(const string&);
+        void append(char);
+        void appendInt(int);
+        void moveCursor(int, int);
+        bool flush(int);
+        // getters
+        const char* getData();
+        size_t size();
+
+    private:
+        void reserve(size_t);
+};
+
+#endif
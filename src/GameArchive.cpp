@@ -0,0 +1,365 @@
+#include "GameArchive.hpp"
+#include "ChessException.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+
+static uint64_t readLittleEndian(const uint8_t* data, int bytes){
+    uint64_t value = 0;
+    for(int i = bytes - 1; i >= 0; i--){
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+static void writeLittleEndian(uint8_t* data, uint64_t value, int bytes){
+    for(int i=0; i < bytes; i++){
+        data[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+// Set up the position a game starts from
+static void startPosition(Position& pos, const PgnGame& game){
+    string fen = game.getTag("FEN");
+    pos.loadFen(fen.empty() ? START_FEN : fen);
+}
+
+GameArchive::GameArchive(){
+    this->mapped = NULL;
+    this->mappedSize = 0;
+    this->gameCount = 0;
+    this->offsets = NULL;
+}
+
+GameArchive::~GameArchive(){
+    this->unmap();
+}
+
+// Loading ===================================
+
+/**
+    Map an archive file into memory. Replaces any archive that was already mapped.
+    @param path Location of the .ccga file
+    @returns nothing. Throws ChessException if the file can't be used.
+*/
+void GameArchive::map(string path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw ChessException("GameArchive.cpp: Could not open archive file");
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        close(fd);
+        throw ChessException("GameArchive.cpp: Could not read archive file size");
+    }
+    size_t size = st.st_size;
+    if(size < (size_t) GA_HEADER_SIZE){
+        close(fd);
+        throw ChessException("GameArchive.cpp: Archive file is too short");
+    }
+    void* mem = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mem == MAP_FAILED){
+        throw ChessException("GameArchive.cpp: Could not map archive file");
+    }
+    const uint8_t* data = (const uint8_t*) mem;
+    uint64_t version = readLittleEndian(data + 4, 4);
+    uint64_t games = readLittleEndian(data + 8, 8);
+    uint64_t indexOffset = readLittleEndian(data + 16, 8);
+    if(memcmp(data, "CCGA", 4) != 0 || version != GA_VERSION || indexOffset < (uint64_t) GA_HEADER_SIZE
+        || indexOffset > size || (size - indexOffset) / 8 != games || (size - indexOffset) % 8 != 0){
+        munmap(mem, size);
+        throw ChessException("GameArchive.cpp: Archive file header doesn't match its size");
+    }
+
+    this->unmap();
+    this->mapped = data;
+    this->mappedSize = size;
+    this->gameCount = games;
+    this->offsets = data + indexOffset;
+}
+
+void GameArchive::unmap(){
+    if(this->mapped != NULL){
+        munmap((void*) this->mapped, this->mappedSize);
+    }
+    this->mapped = NULL;
+    this->mappedSize = 0;
+    this->gameCount = 0;
+    this->offsets = NULL;
+}
+
+uint64_t GameArchive::getGameCount(){
+    return this->gameCount;
+}
+
+// Reading ===================================
+
+/**
+    Read a game's tags, result and length without replaying its moves
+    @param id Game number, 0 to getGameCount() - 1
+    @param game Set to the game. Its offset is the game's offset in the archive.
+    @returns nothing. Throws ChessException if the game doesn't exist or is cut off.
+*/
+void GameArchive::readHeader(uint64_t id, PgnGame& game){
+    const uint8_t* data = this->gameData(id);
+    const uint8_t* end = this->offsets;
+    int tagBytes = (int) readLittleEndian(data + 4, 2);
+    if(data + GA_GAME_HEADER_SIZE + tagBytes > end){
+        throw ChessException("GameArchive.cpp: Game is cut off");
+    }
+    game.tags.clear();
+    game.result = decodeResult((GaResult) data[0]);
+    game.plies = (int) readLittleEndian(data + 2, 2);
+    game.error.clear();
+    game.offset = data - this->mapped;
+
+    const char* tag = (const char*) data + GA_GAME_HEADER_SIZE;
+    const char* tagEnd = tag + tagBytes;
+    while(tag < tagEnd){
+        size_t nameLength = strnlen(tag, tagEnd - tag);
+        const char* value = tag + nameLength + 1;
+        if(value >= tagEnd){
+            throw ChessException("GameArchive.cpp: Game tags are cut off");
+        }
+        size_t valueLength = strnlen(value, tagEnd - value);
+        game.tags.emplace_back(string(tag, nameLength), string(value, valueLength));
+        tag = value + valueLength + 1;
+    }
+}
+
+/**
+    Replay a game
+    @param id Game number, 0 to getGameCount() - 1
+    @param pos Set to the position the game starts from, and left at the position after its last move
+    @param onMove Called with the position before each move is made. May be empty.
+    @param maxPlies Stop after this many moves, e.g. to only replay openings
+    @returns Number of moves replayed. Throws ChessException if the game can't be decoded.
+*/
+int GameArchive::replay(uint64_t id, Position& pos, function<void(Position&, PackedMove)> onMove, int maxPlies){
+    PgnGame game;
+    this->readHeader(id, game);
+    startPosition(pos, game);
+
+    const uint8_t* data = this->gameData(id);
+    const uint8_t* next = data + GA_GAME_HEADER_SIZE + readLittleEndian(data + 4, 2);
+    const uint8_t* end = this->offsets;
+    uint64_t bits = 0;
+    int available = 0;
+    MoveList pseudo;
+    int plies = min(game.plies, maxPlies);
+    for(int ply=0; ply < plies; ply++){
+        pseudo.size = 0;
+        pos.generateMoves(pseudo);
+        int width = indexBits(pseudo.size);
+        while(available < width){
+            if(next >= end){
+                throw ChessException("GameArchive.cpp: Game moves are cut off");
+            }
+            bits |= (uint64_t) *next++ << available;
+            available += 8;
+        }
+        int index = (int) (bits & ((1ULL << width) - 1));
+        bits >>= width;
+        available -= width;
+        if(index >= pseudo.size){
+            throw ChessException("GameArchive.cpp: Game has an illegal move");
+        }
+        // Only the stored move needs to be put in place, not the whole list sorted
+        nth_element(pseudo.moves, pseudo.moves + index, pseudo.moves + pseudo.size);
+        PackedMove m = pseudo.moves[index];
+        if(!pos.isLegal(m)){
+            throw ChessException("GameArchive.cpp: Game has an illegal move");
+        }
+        if(onMove){
+            onMove(pos, m);
+        }
+        pos.makeMove(m);
+    }
+    return plies;
+}
+
+/**
+    Read a whole game
+    @param id Game number, 0 to getGameCount() - 1
+    @param game Set to the game's tags, result and length
+    @param moves Set to the game's moves
+    @returns nothing. Throws ChessException if the game can't be decoded.
+*/
+void GameArchive::readGame(uint64_t id, PgnGame& game, vector<PackedMove>& moves){
+    this->readHeader(id, game);
+    moves.clear();
+    moves.reserve(game.plies);
+    Position pos;
+    this->replay(id, pos, [&moves](Position&, PackedMove m){ moves.push_back(m); });
+}
+
+/*
+    Private method
+    Start of a game's header, checked against the file
+*/
+const uint8_t* GameArchive::gameData(uint64_t id){
+    if(id >= this->gameCount){
+        throw ChessException("GameArchive.cpp: Game number out of range");
+    }
+    uint64_t offset = readLittleEndian(this->offsets + id * 8, 8);
+    if(offset < (uint64_t) GA_HEADER_SIZE || offset + GA_GAME_HEADER_SIZE > (uint64_t) (this->offsets - this->mapped)){
+        throw ChessException("GameArchive.cpp: Game offset is outside the archive");
+    }
+    return this->mapped + offset;
+}
+
+// Encoding ===================================
+
+/**
+    Static method
+    @param result PGN game termination marker
+    @returns The result as stored in archives. Anything unknown is GaUnknown.
+*/
+GaResult GameArchive::encodeResult(string_view result){
+    if(result == "1-0") return GaRedWins;
+    if(result == "0-1") return GaBlackWins;
+    if(result == "1/2-1/2") return GaDraw;
+    return GaUnknown;
+}
+
+/**
+    Static method
+    @param result Result as stored in archives
+    @returns PGN game termination marker
+*/
+string GameArchive::decodeResult(GaResult result){
+    switch(result){
+        case GaRedWins: return "1-0";
+        case GaBlackWins: return "0-1";
+        case GaDraw: return "1/2-1/2";
+        default: return "*";
+    }
+}
+
+/**
+    Static method
+    @param count Number of legal moves
+    @returns Bits needed to store an index into the moves
+*/
+int GameArchive::indexBits(int count){
+    return (count <= 1) ? 0 : 32 - __builtin_clz((unsigned) (count - 1));
+}
+
+
+GameArchiveWriter::GameArchiveWriter(){
+    this->written = 0;
+}
+
+/**
+    Create an archive file. The header is only complete after close().
+    @param path Location of the .ccga file
+    @returns nothing. Throws ChessException if the file can't be created.
+*/
+void GameArchiveWriter::open(string path){
+    this->out.open(path, ios::binary | ios::trunc);
+    if(!this->out){
+        throw ChessException("GameArchive.cpp: Could not create archive file");
+    }
+    this->path = path;
+    this->offsets.clear();
+    char header[GA_HEADER_SIZE] = { 0 };
+    this->out.write(header, GA_HEADER_SIZE);
+    this->written = GA_HEADER_SIZE;
+}
+
+/**
+    Add a game to the end of the archive
+    @param game Tags and result of the game. A FEN tag sets the position the game starts from.
+    @param moves Legal moves of the game
+    @returns nothing. Throws ChessException if a move is illegal or the game is too long to store.
+*/
+void GameArchiveWriter::add(const PgnGame& game, const vector<PackedMove>& moves){
+    if(moves.size() > (size_t) GA_MAX_PLIES){
+        throw ChessException("GameArchive.cpp: Game has too many moves for an archive");
+    }
+    string tags;
+    for(auto const& [name, value] : game.tags){
+        tags += name;
+        tags += '\0';
+        tags += value;
+        tags += '\0';
+    }
+    if(tags.size() > (size_t) GA_MAX_TAG_BYTES){
+        throw ChessException("GameArchive.cpp: Game tags are too long for an archive");
+    }
+
+    vector<uint8_t> record(GA_GAME_HEADER_SIZE);
+    record[0] = (uint8_t) GameArchive::encodeResult(game.result);
+    writeLittleEndian(&record[2], moves.size(), 2);
+    writeLittleEndian(&record[4], tags.size(), 2);
+    record.insert(record.end(), tags.begin(), tags.end());
+
+    Position pos;
+    startPosition(pos, game);
+    MoveList pseudo;
+    uint64_t bits = 0;
+    int pending = 0;
+    for(PackedMove m : moves){
+        pseudo.size = 0;
+        pos.generateMoves(pseudo);
+        if(!pseudo.contains(m) || !pos.isLegal(m)){
+            throw ChessException("GameArchive.cpp: Game has an illegal move");
+        }
+        int index = 0;
+        for(int i=0; i < pseudo.size; i++){
+            index += (pseudo.moves[i] < m);
+        }
+        bits |= (uint64_t) index << pending;
+        pending += GameArchive::indexBits(pseudo.size);
+        while(pending >= 8){
+            record.push_back((uint8_t) bits);
+            bits >>= 8;
+            pending -= 8;
+        }
+        pos.makeMove(m);
+    }
+    if(pending > 0){
+        record.push_back((uint8_t) bits);
+    }
+
+    this->offsets.push_back(this->written);
+    this->out.write((const char*) record.data(), record.size());
+    this->written += record.size();
+}
+
+/**
+    Write the game index and the header
+    @returns nothing. Throws ChessException if the file can't be written.
+*/
+void GameArchiveWriter::close(){
+    uint64_t indexOffset = this->written;
+    vector<uint8_t> index(this->offsets.size() * 8);
+    for(size_t i=0; i < this->offsets.size(); i++){
+        writeLittleEndian(&index[i * 8], this->offsets[i], 8);
+    }
+    this->out.write((const char*) index.data(), index.size());
+
+    uint8_t header[GA_HEADER_SIZE];
+    memcpy(header, "CCGA", 4);
+    writeLittleEndian(header + 4, GA_VERSION, 4);
+    writeLittleEndian(header + 8, this->offsets.size(), 8);
+    writeLittleEndian(header + 16, indexOffset, 8);
+    this->out.seekp(0);
+    this->out.write((const char*) header, GA_HEADER_SIZE);
+    this->out.close();
+    if(this->out.fail()){
+        throw ChessException("GameArchive.cpp: Could not write archive file " + this->path);
+    }
+}
+
+uint64_t GameArchiveWriter::getGameCount(){
+    return this->offsets.size();
+}
@@ -0,0 +1,92 @@
+#ifndef GameArchive_H
+#define GameArchive_H
+
+#include "Position.hpp"
+#include "Pgn.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+    Compact binary game archive.
+
+    A move is stored as its index in the position's pseudo-legal moves (Position::generateMoves),
+     sorted by PackedMove value so archives don't depend on the order moves are generated in. Each
+     index takes just enough bits for the number of moves: none when there is only one, 5 bits for
+     20 moves, so a typical move takes 5 or 6 bits. Decoding a move costs one call to generateMoves
+     and one legality check, instead of checking every move the way parsing text does.
+
+    File layout (little endian):
+        char     magic[4]       "CCGA"
+        uint32   version        GA_VERSION
+        uint64   games
+        uint64   indexOffset    where offsets[] starts
+        games, each starting with a GA_GAME_HEADER_SIZE byte header:
+            uint8    result     GaResult
+            uint8    reserved
+            uint16   plies
+            uint16   tagBytes
+            char     tags[tagBytes]     name '\0' value '\0' ..., in the order of the PGN file
+            uint8    moves[(bits + 7) / 8]  move indices, least significant bit first
+        uint64   offsets[games] byte offset of each game's header
+    A game with a FEN tag starts from that position.
+    Archives are written by GameArchiveWriter and mapped read-only by GameArchive, so any game can
+     be read without touching the rest of the file.
+*/
+const int GA_VERSION = 1;
+const int GA_HEADER_SIZE = 24;
+const int GA_GAME_HEADER_SIZE = 6;
+const int GA_MAX_PLIES = 65535;
+const int GA_MAX_TAG_BYTES = 65535;
+
+enum GaResult {
+    GaUnknown,      // "*"
+    GaRedWins,      // "1-0"
+    GaBlackWins,    // "0-1"
+    GaDraw          // "1/2-1/2"
+};
+
+class GameArchive {
+    const uint8_t* mapped;
+    size_t mappedSize;
+    uint64_t gameCount;
+    const uint8_t* offsets;
+
+    public:
+        GameArchive();
+        ~GameArchive();
+        void map(string);
+        void unmap();
+        uint64_t getGameCount();
+        void readHeader(uint64_t, PgnGame&);
+        int replay(uint64_t, Position&, function<void(Position&, PackedMove)>, int maxPlies = GA_MAX_PLIES);
+        void readGame(uint64_t, PgnGame&, vector<PackedMove>&);
+        // Encoding shared with the writer
+        static GaResult encodeResult(string_view);
+        static string decodeResult(GaResult);
+        static int indexBits(int);
+
+    private:
+        const uint8_t* gameData(uint64_t);
+};
+
+class GameArchiveWriter {
+    ofstream out;
+    string path;
+    vector<uint64_t> offsets;
+    uint64_t written;       // bytes written so far
+
+    public:
+        GameArchiveWriter();
+        void open(string);
+        void add(const PgnGame&, const vector<PackedMove>&);
+        void close();
+        uint64_t getGameCount();
+};
+
+#endif
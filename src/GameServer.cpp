@@ -0,0 +1,565 @@
+#include "GameServer.hpp"
+#include "ChessException.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+/**
+    @param searchThreads Number of computer moves searched at a time
+    @param limits Limits of each computer move's search
+    @throws ChessException if the event loop can't be set up
+*/
+GameServer::GameServer(int searchThreads, TimeControl limits){
+    // Every connection takes a descriptor, and the default soft limit of 1024 is far below the
+    //  thousands of clients a server should take. Raise it as far as allowed.
+    rlimit files;
+    if(getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max){
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+    this->listenFd = -1;
+    this->accepting = false;
+    this->nextGame = 1;
+    this->limits = limits;
+    this->stopping = false;
+    this->stopRequested = false;
+    this->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    this->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(this->epollFd < 0 || this->wakeFd < 0){
+        throw ChessException("GameServer.cpp: Could not create the event loop: " + string(strerror(errno)));
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = this->wakeFd;
+    epoll_ctl(this->epollFd, EPOLL_CTL_ADD, this->wakeFd, &ev);
+    for(int i=0; i < max(searchThreads, 1); i++){
+        this->workers.emplace_back(&GameServer::searchLoop, this);
+    }
+}
+
+GameServer::~GameServer(){
+    {
+        lock_guard<mutex> lock(this->jobMutex);
+        this->stopping = true;
+    }
+    this->jobReady.notify_all();
+    for(thread& t : this->workers){
+        t.join();
+    }
+    for(auto const& [fd, conn] : this->connections){
+        close(fd);
+    }
+    if(this->listenFd >= 0){
+        close(this->listenFd);
+    }
+    if( !this->unixPath.empty()){
+        unlink(this->unixPath.c_str());
+    }
+    close(this->wakeFd);
+    close(this->epollFd);
+}
+
+/**
+    Accept connections on a Unix domain socket. A socket file left at the path by an earlier server
+     is replaced.
+    @param path Location of the socket file
+    @throws ChessException if the socket can't be created
+*/
+void GameServer::listenUnix(string path){
+    sockaddr_un addr = {};
+    if(path.size() >= sizeof(addr.sun_path)){
+        throw ChessException("GameServer.cpp: Socket path is too long: " + path);
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    struct stat st;
+    if(stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)){
+        unlink(path.c_str());
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0 || bind(fd, (sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0){
+        string reason = strerror(errno);
+        if(fd >= 0){
+            close(fd);
+        }
+        throw ChessException("GameServer.cpp: Could not listen on " + path + ": " + reason);
+    }
+    this->unixPath = path;
+    this->listenFd = fd;
+    this->accepting = true;
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(this->epollFd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/**
+    Accept connections on a TCP port of the loopback interface
+    @param port The port
+    @throws ChessException if the socket can't be created
+*/
+void GameServer::listenTcp(int port){
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int on = 1;
+    if(fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0
+        || bind(fd, (sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0){
+        string reason = strerror(errno);
+        if(fd >= 0){
+            close(fd);
+        }
+        throw ChessException("GameServer.cpp: Could not listen on port " + to_string(port) + ": " + reason);
+    }
+    this->listenFd = fd;
+    this->accepting = true;
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(this->epollFd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/**
+    Serve clients until stop() is called
+    @throws ChessException if the event loop fails
+*/
+void GameServer::run(){
+    if(this->listenFd < 0){
+        throw ChessException("GameServer.cpp: Not listening on a socket");
+    }
+    epoll_event events[SERVER_MAX_EVENTS];
+    while( !this->stopRequested){
+        int count = epoll_wait(this->epollFd, events, SERVER_MAX_EVENTS, -1);
+        if(count < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            throw ChessException("GameServer.cpp: epoll_wait failed: " + string(strerror(errno)));
+        }
+        for(int i=0; i < count; i++){
+            int fd = events[i].data.fd;
+            if(fd == this->listenFd){
+                this->acceptConnections();
+            }
+            else if(fd == this->wakeFd){
+                uint64_t wakeups;
+                while(read(this->wakeFd, &wakeups, sizeof(wakeups)) > 0){}
+                this->finishSearches();
+            }
+            else if(this->connections.count(fd)){
+                if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)){
+                    this->readConnection(fd);
+                }
+                if((events[i].events & EPOLLOUT) && this->connections.count(fd)){
+                    this->writeConnection(fd);
+                }
+            }
+        }
+    }
+}
+
+/**
+    Make run() return. Can be called from any thread, and from a signal handler.
+*/
+void GameServer::stop(){
+    this->stopRequested = true;
+    uint64_t one = 1;
+    ssize_t written = write(this->wakeFd, &one, sizeof(one));
+    (void) written;
+}
+
+size_t GameServer::getGameCount(){
+    return this->games.size();
+}
+
+/*
+    Private method
+    Accept every waiting connection
+*/
+void GameServer::acceptConnections(){
+    while(true){
+        int fd = accept4(this->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0){
+            if(errno == EAGAIN || errno == EWOULDBLOCK){
+                return;
+            }
+            // The client gave up before it was accepted. Take the next one.
+            if(errno == EINTR || errno == ECONNABORTED || errno == EPROTO){
+                continue;
+            }
+            // Out of descriptors or memory. The listening socket stays readable, so stop watching it
+            //  or the loop would spin. The connections wait in the backlog until one is closed.
+            this->setAccepting(false);
+            return;
+        }
+        // Replies are single short lines that shouldn't wait to fill a segment
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        ServerConnection& conn = this->connections[fd];
+        conn.writing = false;
+        conn.closing = false;
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(this->epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+/*
+    Private method
+    Start or stop watching the listening socket for connections
+*/
+void GameServer::setAccepting(bool accepting){
+    if(this->listenFd < 0 || this->accepting == accepting){
+        return;
+    }
+    this->accepting = accepting;
+    epoll_event ev = {};
+    ev.events = accepting ? EPOLLIN : 0;
+    ev.data.fd = this->listenFd;
+    epoll_ctl(this->epollFd, EPOLL_CTL_MOD, this->listenFd, &ev);
+}
+
+/*
+    Private method
+    Read what the client sent and answer every whole line
+*/
+void GameServer::readConnection(int fd){
+    char buffer[16 * 1024];
+    bool ended = false;
+    while(true){
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if(n > 0){
+            this->connections[fd].input.append(buffer, n);
+            continue;
+        }
+        if(n == 0 || (errno != EAGAIN && errno != EINTR)){
+            ended = true;
+        }
+        if(n == 0 || errno != EINTR){
+            break;
+        }
+    }
+
+    string input;
+    input.swap(this->connections[fd].input);
+    size_t start = 0;
+    for(size_t end = input.find('\n'); end != string::npos; end = input.find('\n', start)){
+        string_view line(input.data() + start, end - start);
+        if( !line.empty() && line.back() == '\r'){
+            line.remove_suffix(1);
+        }
+        this->handleLine(fd, line);
+        start = end + 1;
+    }
+    ServerConnection& conn = this->connections[fd];
+    conn.input.assign(input, start, string::npos);
+    if(conn.input.size() > SERVER_MAX_LINE){
+        this->reply(fd, "error line too long");
+        conn.closing = true;
+    }
+    this->writeConnection(fd);
+    if(ended){
+        this->closeConnection(fd);
+    }
+}
+
+/*
+    Private method
+    Write as much of the waiting output as the socket takes, and wait for it to take more if needed
+*/
+void GameServer::writeConnection(int fd){
+    ServerConnection& conn = this->connections[fd];
+    size_t sent = 0;
+    while(sent < conn.output.size()){
+        ssize_t n = send(fd, conn.output.data() + sent, conn.output.size() - sent, MSG_NOSIGNAL);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            if(errno == EAGAIN){
+                break;
+            }
+            this->closeConnection(fd);
+            return;
+        }
+        sent += n;
+    }
+    conn.output.erase(0, sent);
+    if(conn.output.empty() && conn.closing){
+        this->closeConnection(fd);
+        return;
+    }
+    bool waiting = !conn.output.empty();
+    if(waiting != conn.writing){
+        conn.writing = waiting;
+        epoll_event ev = {};
+        ev.events = waiting ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(this->epollFd, EPOLL_CTL_MOD, fd, &ev);
+    }
+}
+
+/*
+    Private method
+    Close a connection and its games. Searches of its games are dropped when they finish.
+*/
+void GameServer::closeConnection(int fd){
+    auto it = this->connections.find(fd);
+    if(it == this->connections.end()){
+        return;
+    }
+    for(uint32_t id : it->second.games){
+        this->games.erase(id);
+    }
+    epoll_ctl(this->epollFd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    this->connections.erase(it);
+    // A descriptor is free again for connections waiting in the backlog
+    this->setAccepting(true);
+}
+
+/*
+    Private method
+    Carry out one command. See the protocol in GameServer.hpp.
+*/
+void GameServer::handleLine(int fd, string_view line){
+    ServerConnection& conn = this->connections[fd];
+    if(conn.closing){
+        return;
+    }
+    size_t first = line.find_first_not_of(" \t");
+    if(first == string_view::npos){
+        return;
+    }
+    line.remove_prefix(first);
+    size_t space = line.find_first_of(" \t");
+    string_view command = line.substr(0, space);
+    string_view rest = (space == string_view::npos) ? string_view() : line.substr(space + 1);
+    rest.remove_prefix(min(rest.find_first_not_of(" \t"), rest.size()));
+
+    if(command == "new"){
+        GameSession session;
+        try{
+            session.pos.loadFen(rest.empty() ? START_FEN : rest);
+        }
+        catch(const ChessException &cex){
+            this->reply(fd, "error " + string(cex.what()));
+            return;
+        }
+        session.owner = fd;
+        session.searching = false;
+        uint32_t id = this->nextGame++;
+        this->games.emplace(id, move(session));
+        conn.games.push_back(id);
+        this->reply(fd, "ok " + to_string(id));
+        return;
+    }
+    if(command == "quit"){
+        conn.closing = true;
+        return;
+    }
+    if(command != "move" && command != "go" && command != "state" && command != "moves" && command != "close"){
+        this->reply(fd, "error unknown command");
+        return;
+    }
+
+    // Every other command names a game of this connection
+    string_view idText = rest.substr(0, rest.find_first_of(" \t"));
+    string_view argument = rest.substr(idText.size());
+    argument.remove_prefix(min(argument.find_first_not_of(" \t"), argument.size()));
+    while( !argument.empty() && (argument.back() == ' ' || argument.back() == '\t')){
+        argument.remove_suffix(1);
+    }
+    uint32_t id = (uint32_t) strtoul(string(idText).c_str(), NULL, 10);
+    auto it = this->games.find(id);
+    if(it == this->games.end() || it->second.owner != fd){
+        this->reply(fd, "error " + string(idText) + " unknown game");
+        return;
+    }
+    GameSession& session = it->second;
+    string prefix = to_string(id) + " ";
+
+    if(command == "state"){
+        this->reply(fd, "ok " + prefix + GameServer::getStatus(session) + " " + session.pos.toFen());
+    }
+    else if(command == "moves"){
+        MoveList legal;
+        session.pos.generateLegalMoves(legal);
+        string text = "ok " + to_string(id);
+        for(int i=0; i < legal.size; i++){
+            text += " " + Position::moveToString(legal.moves[i]);
+        }
+        this->reply(fd, text);
+    }
+    else if(command == "close"){
+        this->games.erase(it);
+        conn.games.erase(find(conn.games.begin(), conn.games.end(), id));
+        this->reply(fd, "ok " + to_string(id));
+    }
+    else if(session.searching){
+        this->reply(fd, "error " + prefix + "busy");
+    }
+    else{
+        string status = GameServer::getStatus(session);
+        if(status != "playing" && status != "check"){
+            this->reply(fd, "error " + prefix + "game over");
+        }
+        else if(command == "go"){
+            session.searching = true;
+            {
+                lock_guard<mutex> lock(this->jobMutex);
+                this->jobs.push_back(ServerJob{id, session.pos, NULL_MOVE});
+            }
+            this->jobReady.notify_one();
+        }
+        else{
+            string text(argument);
+            PackedMove m = session.pos.parseMove(text);
+            if(m == NULL_MOVE){
+                m = session.pos.parseSan(text);
+            }
+            if(m == NULL_MOVE){
+                this->reply(fd, "error " + prefix + "illegal move");
+            }
+            else{
+                this->reply(fd, this->playMove(id, session, m));
+            }
+        }
+    }
+}
+
+/*
+    Private method
+    Queue one line of output. A client that lets too much output pile up is disconnected.
+*/
+void GameServer::reply(int fd, string line){
+    ServerConnection& conn = this->connections[fd];
+    if(conn.output.size() + line.size() >= SERVER_MAX_OUTPUT){
+        conn.output.clear();
+        conn.closing = true;
+        return;
+    }
+    conn.output += line;
+    conn.output += '\n';
+}
+
+/*
+    Private method
+    Play the computer moves the workers found, and send them to their games' owners
+*/
+void GameServer::finishSearches(){
+    deque<ServerJob> done;
+    {
+        lock_guard<mutex> lock(this->jobMutex);
+        done.swap(this->results);
+    }
+    vector<int> written;
+    for(ServerJob& job : done){
+        auto it = this->games.find(job.game);
+        if(it == this->games.end()){
+            continue;   // closed while searching
+        }
+        GameSession& session = it->second;
+        session.searching = false;
+        if(job.move == NULL_MOVE){
+            this->reply(session.owner, "error " + to_string(job.game) + " no move");
+        }
+        else{
+            this->reply(session.owner, this->playMove(job.game, session, job.move));
+        }
+        written.push_back(session.owner);
+    }
+    sort(written.begin(), written.end());
+    written.erase(unique(written.begin(), written.end()), written.end());
+    for(int fd : written){
+        this->writeConnection(fd);
+    }
+}
+
+/*
+    Private method
+    Worker thread: search the queued positions, each with the same limits. Every worker has its own
+     transposition table. A table per game would cost megabytes for each of thousands of games.
+*/
+void GameServer::searchLoop(){
+    TranspositionTable table;
+    Search search(&table);
+    while(true){
+        ServerJob job;
+        {
+            unique_lock<mutex> lock(this->jobMutex);
+            this->jobReady.wait(lock, [this]{ return this->stopping || !this->jobs.empty(); });
+            if(this->stopping){
+                return;
+            }
+            job = move(this->jobs.front());
+            this->jobs.pop_front();
+        }
+        job.move = search.think(job.pos, this->limits).bestMove;
+        {
+            lock_guard<mutex> lock(this->jobMutex);
+            this->results.push_back(move(job));
+        }
+        uint64_t one = 1;
+        ssize_t written = write(this->wakeFd, &one, sizeof(one));
+        (void) written;
+    }
+}
+
+/*
+    Private method
+    Play a legal move in a game
+    @returns The reply: "ok <id> <move> <status>"
+*/
+string GameServer::playMove(uint32_t id, GameSession& session, PackedMove m){
+    session.keys.push_back(session.pos.getKey());
+    session.pos.makeMove(m);
+    return "ok " + to_string(id) + " " + Position::moveToString(m) + " " + GameServer::getStatus(session);
+}
+
+/*
+    Private method
+    @returns playing, check, checkmate, stalemate or draw
+*/
+string GameServer::getStatus(GameSession& session){
+    Position& pos = session.pos;
+    MoveList legal;
+    pos.generateLegalMoves(legal);
+    if(legal.size == 0){
+        return pos.inCheck() ? "checkmate" : "stalemate";
+    }
+    if(pos.getHalfmoveClock() >= 100){
+        return "draw";
+    }
+    int repetitions = 0;
+    for(int i=1; i <= pos.getHalfmoveClock() && i <= (int) session.keys.size(); i++){
+        repetitions += (session.keys[session.keys.size() - i] == pos.getKey());
+    }
+    if(repetitions >= 2){
+        return "draw";
+    }
+    // Only kings, and at most one bishop or knight between them
+    if( !pos.getPieces(Pawn) && !pos.getPieces(Rook) && !pos.getPieces(Queen)
+        && Bitboards::popCount(pos.getPieces(Bishop) | pos.getPieces(Knight)) <= 1){
+        return "draw";
+    }
+    return pos.inCheck() ? "check" : "playing";
+}
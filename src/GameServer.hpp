@@ -0,0 +1,113 @@
+#ifndef GameServer_H
+#define GameServer_H
+
+#include "Position.hpp"
+#include "Search.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/*
+    Hosts many games at once for clients on a Unix domain socket or a loopback TCP port.
+
+    One thread runs an epoll loop over every connection, reading commands and writing replies
+     without blocking. Computer moves are searched by a small pool of worker threads, which hand
+     their results back to the loop through an eventfd, so a search never holds up other games.
+    A game is a Position plus its moves, small enough to keep thousands of them. Games belong to
+     the connection that created them and are closed with it.
+
+    Protocol: one command per line, one reply line per command. Replies start with "ok" or "error",
+     followed by the game id when the command names a game. Replies to "go" come once the search
+     is done, possibly after replies to later commands.
+        new [FEN]           ok <id>                     start a game, from the standard position by default
+        move <id> <move>    ok <id> <move> <status>     play a move, in coordinate notation or SAN
+        go <id>             ok <id> <move> <status>     let the computer play a move
+        state <id>          ok <id> <status> <FEN>
+        moves <id>          ok <id> <move>...           legal moves
+        close <id>          ok <id>
+        quit                                            close the connection
+    Moves in replies are in coordinate notation, e.g. e7e8q. The status is one of playing, check,
+     checkmate, stalemate or draw (50 move rule, 3-fold repetition or insufficient material).
+*/
+const size_t SERVER_MAX_LINE = 4096;            // longer commands close the connection
+const size_t SERVER_MAX_OUTPUT = 1024 * 1024;   // connections that don't read their replies are closed
+const int SERVER_MAX_EVENTS = 256;              // epoll events handled per wakeup
+const int SERVER_DEFAULT_DEPTH = 5;             // depth of "go" searches without a time per move
+
+struct GameSession {
+    Position pos;
+    vector<uint64_t> keys;      // key of every position before the current one, for repetitions
+    int owner;                  // descriptor of the connection that created the game
+    bool searching;             // a computer move is being searched
+};
+
+struct ServerConnection {
+    string input;               // bytes read but not yet a whole line
+    string output;              // replies not yet written
+    vector<uint32_t> games;
+    bool writing;               // waiting for the socket to take more output
+    bool closing;               // close once the output is written
+};
+
+/*
+    A computer move to search, and later its result. Games are closed along with their connection
+     and their ids aren't reused, so a result whose game still exists can go to the game's owner.
+*/
+struct ServerJob {
+    uint32_t game;
+    Position pos;
+    PackedMove move;
+};
+
+class GameServer {
+    int epollFd;
+    int listenFd;
+    int wakeFd;                 // eventfd written when searches finish or stop() is called
+    bool accepting;             // listenFd is watched for connections. Off while out of descriptors.
+    string unixPath;            // socket file to remove when the server stops
+    unordered_map<int, ServerConnection> connections;
+    unordered_map<uint32_t, GameSession> games;
+    uint32_t nextGame;
+    TimeControl limits;         // limits of "go" searches
+    vector<thread> workers;
+    mutex jobMutex;             // guards jobs, results and stopping
+    condition_variable jobReady;
+    deque<ServerJob> jobs;
+    deque<ServerJob> results;
+    bool stopping;              // tells the workers to return
+    atomic<bool> stopRequested; // set by stop(), which may be called from a signal handler
+
+    public:
+        GameServer(int, TimeControl);
+        ~GameServer();
+        void listenUnix(string);
+        void listenTcp(int);
+        void run();
+        void stop();
+        size_t getGameCount();
+
+    private:
+        void acceptConnections();
+        void setAccepting(bool);
+        void readConnection(int);
+        void writeConnection(int);
+        void closeConnection(int);
+        void handleLine(int, string_view);
+        void reply(int, string);
+        void finishSearches();
+        void searchLoop();
+        string playMove(uint32_t, GameSession&, PackedMove);
+        static string getStatus(GameSession&);
+};
+
+#endif
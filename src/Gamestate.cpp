@@ -7,12 +7,17 @@
 #include "Message.hpp"
 #include "MessageManager.hpp"
 #include "Debug.hpp"
+#include "Position.hpp"
+#include "Pgn.hpp"
+#include "Stats.hpp"
 
 #include <stdlib.h>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <cstdio>
+#include <ctime>
+#include <fstream>
 
 
 Gamestate::Gamestate(){
@@ -22,6 +27,14 @@ Gamestate::Gamestate(){
     this->board = new Board(true);
     this->prompt = new Prompt();
     this->currentMove = new Move(Red);  // red team always starts
+    this->engine = new Engine();
+    this->renderer = new Renderer();
+    this->pondering = true;
+    this->headless = false;
+    this->rejectedCount = 0;
+    this->computerTeam = NoColor;
+    this->timeControl = TimeControl();
+    this->timeControl.moveTime = 1000;
     this->reset();
 }
 
@@ -29,6 +42,8 @@ Gamestate::~Gamestate(){
     delete this->board;
     delete this->prompt;
     delete this->currentMove;
+    delete this->engine;
+    delete this->renderer;
     // // TODO: If the player objects are created, uncomment this
     // delete this->checkedPlayer;
     // delete this->checkmatedPlayer;
@@ -47,6 +62,10 @@ void Gamestate::initNonPointers(){
     this->currentTeamTurn = Red;
     this->captureDelta = 0;
     this->nmanager = MessageManager();
+    this->computerClock = this->timeControl.time;
+    this->computerPromotion = NoPiece;
+    this->expectedReply = NULL_MOVE;
+    this->reportedTurn = -1;
 }
 
 /*
@@ -57,6 +76,7 @@ void Gamestate::start(){
         this->callReset = false;
         this->mainGameloop();
     }
+    this->savePgn();
 }
 
 /*
@@ -72,12 +92,13 @@ void Gamestate::reset(){
     @returns nothing
 */
 void Gamestate::reset(vector<string> state){
+    this->savePgn();
     this->validSet.clear();
     this->validSet = {};
     this->callReset = true;
     this->board->clear();
     this->initNonPointers();
-    StateFactory::loadState(this, state);
+    this->loadState(state);
     this->currentMove->reset(this->currentTeamTurn);
     this->nmanager.clear();
 }
@@ -86,9 +107,18 @@ void Gamestate::reset(vector<string> state){
     Display all messages in the NotificationManager and display the Board
 */
 void Gamestate::display(){
-    this->nmanager.displayTop();
-    this->board->display();
-    this->nmanager.displayBottom();
+    // Debug output is printed between frames, so keep drawing everything in order
+    if(DEBUG_MODE){
+        this->nmanager.displayTop();
+        this->board->display();
+        this->nmanager.displayBottom();
+        return;
+    }
+    vector<string> top;
+    vector<string> bottom;
+    this->nmanager.collectTop(top);
+    this->nmanager.collectBottom(bottom);
+    this->renderer->draw(this->board, top, bottom);
 }   
 
 void Gamestate::setGameOver(){
@@ -109,6 +139,8 @@ void Gamestate::mainGameloop(){
         "   sel <pos1>         : Select piece at <pos1>. Ex: sel a2\n"
         "   mv <pos2>          : Move piece selected with \"sel\" to <pos2>. Ex: mv a4\n"
         "   mv <pos1> <pos2>   : Select piece at <pos1> and move to <pos2>. Ex: mv a2 a4\n"
+        "   go                 : Let the computer play a move for the current team.\n"
+        "   stats              : Show call counts and times of the hot paths.\n"
         "   reset              : Resart the chess game.\n"
         "   quit/exit/q        : Exit the game.\n";
     Message helpMessage = Message(HELP_STRING, ONCE, BELOW);
@@ -118,14 +150,19 @@ void Gamestate::mainGameloop(){
         bool validMove = false;     // checks if the move made is value and ends the current player's turn
         // reset from last turn
         bool turnChecked = false;
+        this->computerPromotion = NoPiece;
         string turnString = teamString[this->currentTeamTurn];
         this->currentMove->setTeamColor(this->currentTeamTurn);
         
-        if(!DEBUG_MODE){ system("clear"); }
-        else{ cout << "======================New Turn Start ======================" << endl; }
+        // The renderer clears the screen itself, and only where it changed
+        if(this->headless){ this->nmanager.clear(); }
+        else if(DEBUG_MODE){ cout << "======================New Turn Start ======================" << endl; }
 
         // Check if the last move made put this team in check
         turnChecked = this->board->isCheck(this->currentTeamTurn);
+        // Headless mode reports the status once per turn, not after every command
+        bool reportStatus = (this->headless && this->reportedTurn != this->board->getTurnCount());
+        this->reportedTurn = this->board->getTurnCount();
         
         if(turnChecked){
             // Determine if this turn's player has a king in checkmate
@@ -137,9 +174,16 @@ void Gamestate::mainGameloop(){
                 
                 this->nmanager.addMessage( Message(string_format("%s's King has been Checkmated.", teamString[this->checkmated].c_str()), ONCE, ABOVE) );
                 this->nmanager.addMessage( Message(string_format("%s team has won!\nGame Over!",teamString[this->winner].c_str()), ONCE, ABOVE) );
+                if(reportStatus){
+                    this->report("checkmate " + teamString[this->checkmated]);
+                    this->report("winner " + teamString[this->winner]);
+                }
             }
             else{
                 this->nmanager.addMessage( Message(string_format("%s's King is in Check!", teamString[this->currentTeamTurn].c_str()), ONCE, ABOVE) );
+                if(reportStatus){
+                    this->report("check " + teamString[this->currentTeamTurn]);
+                }
             }
         }
 
@@ -153,10 +197,27 @@ void Gamestate::mainGameloop(){
             this->nmanager.addMessage(gameoverMessage);
         }
         
-        this->display();
+        if(!this->headless){
+            this->display();
+        }
 
-        this->prompt->promptInput("\nEnter Command");
-        int* parsedArgs = this->prompt->getCmdArgs();
+        int* parsedArgs;
+        int computerArgs[MAX_ARGS] = { GoCmd, -1, -1, -1 };
+        bool computerTurn = (this->currentTeamTurn == this->computerTeam && !this->gameOver);
+        if(computerTurn){
+            parsedArgs = computerArgs;
+        }
+        else{
+            // Search while the player thinks, and stop as soon as a command comes in
+            this->startPondering();
+            this->prompt->promptInput("\nEnter Command");
+            this->engine->stop();
+            parsedArgs = this->prompt->getCmdArgs();
+            if(this->prompt->isEndOfInput()){
+                this->terminate = true;
+                return;
+            }
+        }
 
         /** DEBUG: */
         if(DEBUG_MODE){
@@ -168,17 +229,39 @@ void Gamestate::mainGameloop(){
         }
         
         try{
+            // Replace 'go' with the move the computer chose
+            if(parsedArgs[0] == GoCmd){
+                if(this->gameOver){
+                    continue;
+                }
+                this->currentMove->reset(this->currentTeamTurn);
+                this->board->clearAllHighlightedIndices();
+                this->validSet.clear();
+                this->computerMove(parsedArgs);
+                if(this->gameOver){
+                    continue;
+                }
+            }
             switch(parsedArgs[0]){
                 case(InvalidCmd):
                     this->nmanager.addMessage( Message("Invalid command", ONCE, BELOW) );
+                    this->report("invalid command");
                     break;
                 case(HelpCmd):
                     if(DEBUG_MODE) cout << "Help Command" << endl;
                     this->nmanager.addMessage(helpMessage);
+                    this->report(HELP_STRING);
                     break;
+                case(StatsCmd):{
+                    string table = Stats::report();
+                    this->nmanager.addMessage( Message(table, ONCE, BELOW) );
+                    this->report(table);
+                    break;
+                }
                 case(SelectCmd):
                     // Stop movement commands after game has ended
                     if(this->gameOver){
+                        this->report("rejected Game over");
                         break;
                     }
                     if(DEBUG_MODE) cout << "Select" << endl;
@@ -212,14 +295,22 @@ void Gamestate::mainGameloop(){
                         // Calculate possible moves and highlight them. Determine if king is checked. Also adds the moves this->validSet
                         this->validSet = this->currentMove->calcAllMoves(this->board, true);                        
                         // add special moves to board for highlighting
-                        this->board->appendSpecialIndices(currentMove->getAllSpecialIndices());
+                        this->board->appendSpecialMask(this->currentMove->getSpecialHighlightMask());
                         // add normal moves to board for highlighting
-                        this->board->appendMoveHighlightIndex(this->currentMove->getAllDestIndices(), this->currentMove->getSizeofAllDestIndices());
+                        this->board->appendMoveHighlightMask(this->currentMove->getAllDestMask());
+                        if(this->headless){
+                            string selected = "selected " + Util::reverseParseIndex(parsedArgs[1]);
+                            for(Move* m : this->validSet){
+                                selected += " " + Util::reverseParseIndex(m->getDestIndex());
+                            }
+                            this->report(selected);
+                        }
                     }
                     break;
                 case(MoveCmd):
                     // Stop movement commands after game has ended
                     if(this->gameOver){
+                        this->report("rejected Game over");
                         break;
                     }
                     if(DEBUG_MODE) cout << "Move" << endl;
@@ -236,6 +327,7 @@ void Gamestate::mainGameloop(){
                     if(DEBUG_MODE) cout << "SelectMoveCmd" << endl;
                     // Stop movement commands after game has ended
                     if(this->gameOver){
+                        this->report("rejected Game over");
                         break;
                     }
                     this->currentMove->setSourceIndex(parsedArgs[1]);
@@ -392,6 +484,15 @@ void Gamestate::mainGameloop(){
                 if( !this->moveInSet(this->currentMove)){
                     throw InvalidMoveException("The attempted move is not in the set of valid moves");
                 }
+                PieceType movedType = this->board->getPiece(this->currentMove->getSourceIndex()).getType();
+                // Position the move is played in, to record it for the PGN file
+                Position before;
+                if( !this->pgnPath.empty()){
+                    if(this->moveHistory.empty()){
+                        this->startFen = this->saveFen();
+                    }
+                    before.load(this->board, this->currentTeamTurn);
+                }
                 Move* equiv = this->getMoveFromSet(this->currentMove);
                 delete this->currentMove; // delete old reference
                 this->currentMove = equiv; // moves in this->validSet will have been initialized using new
@@ -407,9 +508,21 @@ void Gamestate::mainGameloop(){
 
                     // Prompt user for what piece to promote the pawn to
                     bool validPromotion = false;
+                    if(this->computerPromotion != NoPiece){
+                        this->board->promotePiece(this->currentMove->getDestIndex(), this->computerPromotion);
+                        validPromotion = true;
+                    }
                     while( !validPromotion){
-                        this->display();
+                        if(!this->headless){
+                            this->display();
+                        }
                         this->prompt->promotionInput();
+                        // Input ran out before a piece was chosen
+                        if(this->prompt->isEndOfInput()){
+                            this->board->promotePiece(this->currentMove->getDestIndex(), Queen);
+                            this->terminate = true;
+                            break;
+                        }
                         int arg = this->prompt->getPromoArg();
 
                         // Error checking
@@ -424,6 +537,19 @@ void Gamestate::mainGameloop(){
                     }
                 }
 
+                if( !this->pgnPath.empty()){
+                    this->recordMove(before, this->currentMove->getSourceIndex(), this->currentMove->getDestIndex());
+                }
+
+                if(this->headless){
+                    string accepted = "accepted " + Util::reverseParseIndex(this->currentMove->getSourceIndex()) + " " + Util::reverseParseIndex(this->currentMove->getDestIndex());
+                    PieceType landed = this->board->getPiece(this->currentMove->getDestIndex()).getType();
+                    if(landed != movedType){
+                        accepted += " " + verbosePieceString[landed];
+                    }
+                    this->report(accepted);
+                }
+
                 // Switch turn
                 this->currentTeamTurn = (this->currentTeamTurn == Red) ? Black : Red;
                 // Reset piece data for previous move and set team for next turn
@@ -449,6 +575,7 @@ void Gamestate::mainGameloop(){
                     // cout << "Draw!" << endl << "Game Over!" << endl;
 
                     this->nmanager.addMessage( Message("An automatic draw has been declared.\n  Reason: 50 moves have been made without a piece captured.\nDraw!\nGame Over!", CONTINUOUS, ABOVE) );
+                    this->report("draw fifty-move");
                     this->gameOver = true;
                 } 
 
@@ -459,6 +586,7 @@ void Gamestate::mainGameloop(){
                 cerr << ex.what() << endl;
             }
             this->nmanager.addMessage(Message(ex.what(), ONCE, BELOW));
+            this->report(string("rejected ") + ex.what());
             // Reset move since player could have selected an opponent's piece
             this->currentMove->reset(this->currentTeamTurn); 
             // Clear highlighted indices
@@ -471,6 +599,7 @@ void Gamestate::mainGameloop(){
                 cerr << ex.what() << endl;
             }
             this->nmanager.addMessage(Message("No piece selected", ONCE, BELOW));
+            this->report("rejected No piece selected");
             this->currentMove->reset(this->currentTeamTurn);
             this->board->clearAllHighlightedIndices();
             this->validSet.clear();
@@ -480,15 +609,23 @@ void Gamestate::mainGameloop(){
                 cerr << "Gamestate.cpp: Input destination" << endl;
             }
             this->nmanager.addMessage(Message("Invalid move destination", ONCE, BELOW));
+            this->report("rejected Invalid move destination");
         }
         catch(const InvalidMoveException &ex){
             this->nmanager.addMessage(Message(ex.what(), ONCE, BELOW));
+            this->report(string("rejected ") + ex.what());
+            // The Board rejected the computer's move. Hand the team back to the player instead of retrying forever.
+            if(computerTurn){
+                this->computerTeam = NoColor;
+                this->nmanager.addMessage(Message("The computer player has been turned off.", ONCE, BELOW));
+            }
         }
         catch(const ChessException &ex){
             if(DEBUG_MODE){
                 cerr << "Gamestate.cpp: Caught chess exception" << endl;
                 cerr << ex.what() << endl;
             }
+            this->report(string("rejected ") + ex.what());
         }
         catch(const exception &ex){
             if(DEBUG_MODE){
@@ -523,6 +660,229 @@ void Gamestate::setCaptureDelta(int cd){
     this->captureDelta = cd;
 }
 
+/**
+    Let the computer play one team
+    @param team The team the computer plays. NoColor to let people play both teams.
+    @returns nothing
+*/
+void Gamestate::setComputerTeam(TeamColor team){
+    this->computerTeam = team;
+}
+
+/**
+    Set the clock used for the computer's moves
+    @param tc Either a fixed time per move (moveTime) or a clock with time, increment and moves to go
+    @returns nothing
+*/
+void Gamestate::setTimeControl(TimeControl tc){
+    this->timeControl = tc;
+    this->computerClock = tc.time;
+}
+
+/**
+    Search in the background while waiting for input
+    @param enable false to leave the CPU idle between moves
+    @returns nothing
+*/
+void Gamestate::setPondering(bool enable){
+    this->pondering = enable;
+}
+
+/**
+    Run without drawing the board. Commands are read from 'in' and every result is printed as a
+     single line, for scripted games and regression runs.
+    @param enable true for headless mode
+    @param in Stream to read commands from. NULL keeps the current one.
+    @returns nothing
+*/
+void Gamestate::setHeadless(bool enable, istream* in){
+    this->headless = enable;
+    this->prompt->setShowPrompt(!enable);
+    if(in != NULL){
+        this->prompt->setInput(in);
+    }
+}
+
+/**
+    Search the current board and turn the best move into a SelectMoveCmd
+    @param args Command arguments to overwrite with the move. Must hold MAX_ARGS ints.
+    @returns nothing
+*/
+void Gamestate::computerMove(int* args){
+    Position pos(this->board, this->currentTeamTurn);
+    TimeControl tc = this->timeControl;
+    if(tc.moveTime <= 0 && !tc.infinite && tc.depth <= 0){
+        tc.time = max<int64_t>(this->computerClock, 1);
+    }
+    this->engine->stop();
+    SearchResult result;
+    bool pondered = false;
+    // Reuse a background search of this position if it already ran as long as this move may take
+    TimeManager budget;
+    budget.start(tc);
+    if(this->engine->getResult(pos.getKey(), result) && result.bestMove != NULL_MOVE && !result.fromBook
+            && result.time >= budget.getSoftLimit() && (tc.depth <= 0 || result.depth >= tc.depth)){
+        pondered = true;
+        result.time = 0;
+    }
+    else{
+        this->engine->think(pos, tc);
+        result = this->engine->wait();
+    }
+    this->expectedReply = result.ponderMove;
+    if(result.bestMove == NULL_MOVE){
+        if(pos.inCheck()){
+            this->winner = (this->currentTeamTurn == Red) ? Black : Red;
+            this->checkmated = this->currentTeamTurn;
+        }
+        // The Board didn't catch the end of the game
+        this->nmanager.addMessage( Message(pos.inCheck() ? "Checkmate. The computer has no legal moves." : "Stalemate. The computer has no legal moves.\nDraw!\nGame Over!", CONTINUOUS, ABOVE) );
+        this->report(pos.inCheck() ? "checkmate " + teamString[this->currentTeamTurn] : "stalemate");
+        this->gameOver = true;
+        return;
+    }
+    if(tc.time > 0){
+        this->computerClock += tc.increment - result.time;
+    }
+
+    int src = moveSource(result.bestMove);
+    int dest = moveDest(result.bestMove);
+    args[0] = SelectMoveCmd;
+    args[1] = src;
+    args[2] = dest;
+    args[3] = -1;
+    if(moveSpecial(result.bestMove) == PawnPromo){
+        this->computerPromotion = movePromotion(result.bestMove);
+    }
+
+    string moveString = Util::reverseParseIndex(src) + Util::reverseParseIndex(dest);
+    if(result.fromBook){
+        this->nmanager.addMessage( Message(string_format("Computer played %s (book)", moveString.c_str()), ONCE, ABOVE) );
+    }
+    else if(pondered){
+        this->nmanager.addMessage( Message(string_format("Computer played %s (pondered: depth %i, score %i, %llu nodes)", moveString.c_str(), result.depth, result.score, (unsigned long long) result.nodes), ONCE, ABOVE) );
+    }
+    else{
+        this->nmanager.addMessage( Message(string_format("Computer played %s (depth %i, score %i, %llu nodes, %lli ms)", moveString.c_str(), result.depth, result.score, (unsigned long long) result.nodes, (long long) result.time), ONCE, ABOVE) );
+    }
+}
+
+/**
+    Append every game to a PGN file when it is reset or the program exits
+    @param path File to append to. Empty to not save games.
+    @returns nothing
+*/
+void Gamestate::setPgnOutput(string path){
+    this->pgnPath = path;
+    this->moveHistory.clear();
+}
+
+/*
+    Private method
+    Add the move that was just made on the board to moveHistory
+    @param before The position the move was played in
+    @param src Source index of the move
+    @param dest Destination index of the move
+*/
+void Gamestate::recordMove(Position& before, int src, int dest){
+    PieceType landed = this->board->getPiece(dest).getType();
+    MoveList legal;
+    before.generateLegalMoves(legal);
+    for(int i=0; i < legal.size; i++){
+        PackedMove m = legal.moves[i];
+        if(moveSource(m) == src && moveDest(m) == dest && (moveSpecial(m) != PawnPromo || movePromotion(m) == landed)){
+            this->moveHistory.push_back(m);
+            return;
+        }
+    }
+}
+
+/*
+    Private method
+    Append the moves played since the last reset to the PGN file
+*/
+void Gamestate::savePgn(){
+    if(this->pgnPath.empty() || this->moveHistory.empty()){
+        return;
+    }
+    char date[16];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y.%m.%d", localtime(&now));
+    string result = "*";
+    if(this->gameOver){
+        result = (this->winner == Red) ? "1-0" : (this->winner == Black) ? "0-1" : "1/2-1/2";
+    }
+
+    PgnGame game;
+    game.setTag("Event", "console_chess game");
+    game.setTag("Site", "?");
+    game.setTag("Date", date);
+    game.setTag("Round", "-");
+    game.setTag("White", (this->computerTeam == Red) ? "console_chess" : "Player");
+    game.setTag("Black", (this->computerTeam == Black) ? "console_chess" : "Player");
+    game.setTag("Result", result);
+    if(this->startFen != START_FEN){
+        game.setTag("SetUp", "1");
+        game.setTag("FEN", this->startFen);
+    }
+    game.result = result;
+
+    ofstream out(this->pgnPath, ios::app);
+    try{
+        PgnWriter::writeGame(out, game, this->moveHistory);
+    }
+    catch(const ChessException &ex){
+        cerr << ex.what() << endl;
+    }
+    if( !out){
+        cerr << "Couldn't write the game to " << this->pgnPath << endl;
+    }
+    this->moveHistory.clear();
+}
+
+/**
+    @returns Number of commands rejected or not understood in headless mode, in every game played
+*/
+int Gamestate::getRejectedCount(){
+    return this->rejectedCount;
+}
+
+/*
+    Private method
+    Print a result line in headless mode
+*/
+void Gamestate::report(string line){
+    if(this->headless){
+        cout << line << '\n';
+    }
+    if(line.rfind("rejected ", 0) == 0 || line == "invalid command"){
+        this->rejectedCount++;
+    }
+}
+
+/*
+    Private method
+    Queue a background search for the position the computer will most likely face next, the
+     position after the reply it expects from the player. Games without a computer player don't
+     ponder, so two people playing each other don't keep a core busy.
+*/
+void Gamestate::startPondering(){
+    if(!this->pondering || this->gameOver || this->headless || this->computerTeam == NoColor){
+        return;
+    }
+    if(this->computerTeam == this->currentTeamTurn || this->expectedReply == NULL_MOVE){
+        return;
+    }
+    Position pos(this->board, this->currentTeamTurn);
+    MoveList legal;
+    pos.generateLegalMoves(legal);
+    if(!legal.contains(this->expectedReply)){
+        return;
+    }
+    pos.makeMove(this->expectedReply);
+    this->engine->ponder(pos);
+}
+
 bool Gamestate::moveInSet(Move* potm){
     for(int i=0; i<this->validSet.size(); i++){
         if(this->validSet.at(i)->equals(potm)) return true;
@@ -568,6 +928,14 @@ Board* Gamestate::getBoard(){
     return this->board;
 }
 
+TeamColor Gamestate::getCurrentTeamTurn(){
+    return this->currentTeamTurn;
+}
+
+int Gamestate::getCaptureDelta(){
+    return this->captureDelta;
+}
+
 void Gamestate::printValidSet(){
     cout << "Gamestate.cpp: Moves in Valid Set" << endl;
     for(int i=0; i < this->validSet.size(); i++){
@@ -578,3 +946,72 @@ void Gamestate::printValidSet(){
     cout << endl;
     
 }
+
+
+// Loaders ===================================
+
+/**
+    Loads a pre-constructed game state
+    @param state The string vector that contains all values of the state to load
+    @returns nothing
+*/
+void Gamestate::loadState(vector<string> state){
+    // parse turn, turn count, capture delta
+    if(state.size() != 4){
+        throw ChessException("Gamestate.cpp: State length is invalid");
+    }
+    if( !regex_match(state[0], STATE_REGEX_TURN_REP)){
+        throw ChessException("Gamestate.cpp: State TurnValue invalid");
+    }
+    if( !regex_match(state[1], STATE_REGEX_COUNT_REP)){
+        throw ChessException("Gamestate.cpp: State TurnCount invalid!");
+    }
+    if( !regex_match(state[2], STATE_REGEX_DELTA_REP)){
+        throw ChessException("Gamestate.cpp: State CaptureDelta invalid!");
+    }
+
+    TeamColor turnTeam = NoColor;
+    if(state[0] == "r"){
+        turnTeam = Red;
+    }
+    else if(state[0] == "b"){
+        turnTeam = Black;
+    }
+    else if(state[0] == "n"){
+        turnTeam = NoColor;
+    }
+
+    // pparse this from string to int
+    int turnCount = stoi(state[1]);
+    int captureDelta = stoi(state[2]);
+    // Update board object
+    StateFactory::loadBoard(this->board, state[3], turnCount);
+    // Update other members
+    this->setCurrentTeamTurn(turnTeam);
+    this->setCaptureDelta(captureDelta);
+}
+
+/**
+    Loads a position in Forsyth-Edwards Notation, like loadState
+    @param fen The record
+    @returns nothing
+    @throws ChessException if the record can't be parsed
+*/
+void Gamestate::loadFen(string_view fen){
+    FenRecord record;
+    StateFactory::parseFen(fen, record);
+    // The Board's turn counter is 1 on Red's first move
+    int turnCount = 2 * (max(1, record.fullmoveNumber) - 1) + (record.turn == Black) + 1;
+    this->board->load(StateFactory::buildFen(record, turnCount), turnCount);
+    this->setCurrentTeamTurn(record.turn);
+    this->setCaptureDelta(record.halfmoveClock);
+}
+
+/**
+    @returns The board in Forsyth-Edwards Notation
+*/
+string Gamestate::saveFen(){
+    FenRecord record;
+    StateFactory::readBoard(this->board, this->currentTeamTurn, this->captureDelta, record);
+    return StateFactory::toFen(record);
+}
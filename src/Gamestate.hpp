@@ -7,10 +7,14 @@
 #include "Prompt.hpp"
 #include "Move.hpp"
 #include "MessageManager.hpp"
+#include "Engine.hpp"
+#include "Renderer.hpp"
+#include "TimeManager.hpp"
 
 #include <vector>
 #include <iostream>
 #include <string>
+#include <string_view>
 
 class Gamestate
 {      
@@ -30,6 +34,20 @@ class Gamestate
     bool callReset;  // member to keep the game running after game over if the user wants to start another game.
     TeamColor winner;
     TeamColor checkmated;  // The losing team
+    Engine* engine;                 // searches on its own thread
+    Renderer* renderer;             // draws the screen, redrawing only what changed
+    TeamColor computerTeam;         // team played by the computer. NoColor if both teams are human.
+    TimeControl timeControl;        // clock settings for the computer's moves
+    int64_t computerClock;          // milliseconds left on the computer's clock
+    PieceType computerPromotion;    // piece the computer chose for its pawn promotion this turn
+    PackedMove expectedReply;       // the player's reply the computer expects to its last move
+    bool pondering;                 // search in the background while waiting for input
+    bool headless;                  // no board or messages. Print one result line per event instead.
+    int reportedTurn;               // last turn whose check status was reported in headless mode
+    int rejectedCount;              // commands rejected or not understood in headless mode
+    string pgnPath;                 // finished games are appended to this file. Empty to not save games.
+    string startFen;                // position the moves in moveHistory start from
+    vector<PackedMove> moveHistory; // moves played since the last reset, only kept while saving games
 
     public:
         Gamestate();
@@ -38,8 +56,19 @@ class Gamestate
         void setCurrentTeamTurn(TeamColor);
         void setBoard(Board*);
         void setCaptureDelta(int);
+        void setComputerTeam(TeamColor);
+        void setTimeControl(TimeControl);
+        void setPondering(bool);
+        void setHeadless(bool, istream*);
+        void setPgnOutput(string);
         Board* getBoard();
+        TeamColor getCurrentTeamTurn();
+        int getCaptureDelta();
+        int getRejectedCount();
         void display();
+        void loadState(vector<string>);
+        void loadFen(string_view);
+        string saveFen();
 
     private:
         bool moveInSet(Move*);
@@ -56,6 +85,11 @@ class Gamestate
         void setTurn(TeamColor);
         TeamColor getTurn();
         void printValidSet();
+        void computerMove(int*);
+        void startPondering();
+        void report(string);
+        void recordMove(Position&, int, int);
+        void savePgn();
 };
 
 #endif
\ No newline at end of file
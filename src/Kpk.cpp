@@ -0,0 +1,40 @@
+#include "Kpk.hpp"
+
+#include <cstdint>
+
+using namespace std;
+
+/*
+    Generated at build time by tools/KpkGenerator.cpp. Bit 'i' of the table is bit (i % 32) of
+     word (i / 32).
+*/
+static const uint32_t KPK_BITBASE[KPK_SIZE / 32] = {
+#include "KpkBitbase.inc"
+};
+
+/**
+    Find out whether a king and pawn vs king position is a win
+    @param strongTeam Team that has the pawn
+    @param strongKing Index of the strong team's king
+    @param strongPawn Index of the strong team's pawn
+    @param weakKing Index of the other team's king
+    @param toMove Team to move
+    @returns true if the strong team wins with best play, false if it is a draw
+*/
+bool Kpk::probe(TeamColor strongTeam, int strongKing, int strongPawn, int weakKing, TeamColor toMove){
+    // The bitbase only stores Red pawns. Flip Black's pieces vertically and swap the teams.
+    if(strongTeam == Black){
+        strongKing ^= 56;
+        strongPawn ^= 56;
+        weakKing ^= 56;
+        toMove = (toMove == Black) ? Red : Black;
+    }
+    // Mirror files E-H onto files A-D
+    if(strongPawn % 8 >= 4){
+        strongKing ^= 7;
+        strongPawn ^= 7;
+        weakKing ^= 7;
+    }
+    int index = kpkIndex(toMove, strongKing, weakKing, strongPawn);
+    return (KPK_BITBASE[index / 32] >> (index % 32)) & 1;
+}
@@ -0,0 +1,44 @@
+#ifndef Kpk_H
+#define Kpk_H
+
+#include "Piece.hpp"
+
+#include <cstdint>
+
+using namespace std;
+
+/*
+    King and pawn vs king bitbase. One bit for every position with Red as the team with the pawn,
+     set when Red wins with best play and clear when the position is a draw.
+    The table is generated by retrograde analysis with tools/KpkGenerator.cpp during the build and
+     compiled into the program, so probing is a single bit lookup.
+
+    Positions are indexed by:
+        team to move     2  (Red, Black)
+        Black king      64
+        Red king        64
+        pawn            24  files A-D, ranks 2-7. Pawns on files E-H are mirrored onto A-D.
+*/
+const int KPK_PAWN_SQUARES = 24;
+const int KPK_SIZE = 2 * 64 * 64 * KPK_PAWN_SQUARES;   // bits
+
+/**
+    Bitbase index of a position with Red's pawn on files A-D
+    @param toMove Team to move
+    @param redKing Index of Red's king
+    @param blackKing Index of Black's king
+    @param pawn Index of Red's pawn
+    @returns Bit index into the bitbase
+*/
+inline int kpkIndex(TeamColor toMove, int redKing, int blackKing, int pawn){
+    // Internal row 6 is rank 2, row 1 is rank 7
+    int pawnSquare = (pawn % 8) + 4 * (6 - pawn / 8);
+    return (toMove == Black) + 2 * (blackKing + 64 * (redKing + 64 * pawnSquare));
+}
+
+class Kpk {
+    public:
+        static bool probe(TeamColor, int, int, int, TeamColor);
+};
+
+#endif
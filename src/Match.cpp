@@ -0,0 +1,465 @@
+#include "Match.hpp"
+#include "ChessException.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+
+// Elo difference of a score between 0 and 1
+static double scoreToElo(double score){
+    if(score <= 0){
+        return -INFINITY;
+    }
+    if(score >= 1){
+        return INFINITY;
+    }
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+// Expected score of an Elo difference
+static double eloToScore(double elo){
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+
+// Scores =====================================================================
+
+uint64_t MatchScore::getGames() const {
+    return this->wins + this->draws + this->losses;
+}
+
+/**
+    @returns Points per game, 0 to 1. 0.5 before any game is played.
+*/
+double MatchScore::getScore() const {
+    uint64_t games = this->getGames();
+    if(games == 0){
+        return 0.5;
+    }
+    return (this->wins + 0.5 * this->draws) / games;
+}
+
+/**
+    @returns Elo difference of the first engine over the second. Infinite if every game was won or lost.
+*/
+double MatchScore::getElo() const {
+    return scoreToElo(this->getScore());
+}
+
+/**
+    The score of each game is 1, 0.5 or 0, and its variance is measured from the games played, so
+     draws narrow the interval. The 95% interval of the average score is converted to Elo.
+    @returns Half the width of the 95% confidence interval of getElo()
+*/
+double MatchScore::getEloError() const {
+    uint64_t games = this->getGames();
+    if(games == 0){
+        return INFINITY;
+    }
+    double score = this->getScore();
+    if(score <= 0 || score >= 1){
+        return INFINITY;
+    }
+    double variance = (this->wins + 0.25 * this->draws) / games - score * score;
+    double deviation = sqrt(max(variance, 0.0) / games);
+    return (scoreToElo(score + 1.959964 * deviation) - scoreToElo(score - 1.959964 * deviation)) / 2;
+}
+
+/**
+    Log likelihood ratio of H1: the Elo difference is elo1, against H0: it is elo0. Game scores are
+     taken as normally distributed with the variance measured so far, which is close enough once a
+     few dozen games are played. Half a game of each outcome is added when measuring the variance,
+     so a match where every game ended the same way still decides, but not after a couple of games.
+    @param elo0 Elo difference of H0
+    @param elo1 Elo difference of H1
+    @returns The ratio. 0 before any game is played.
+*/
+double MatchScore::getLlr(double elo0, double elo1) const {
+    uint64_t games = this->getGames();
+    if(games == 0){
+        return 0;
+    }
+    double score = this->getScore();
+    double total = games + 1.5;
+    double w = (this->wins + 0.5) / total;
+    double d = (this->draws + 0.5) / total;
+    double variance = w + 0.25 * d - (w + 0.5 * d) * (w + 0.5 * d);
+    double s0 = eloToScore(elo0);
+    double s1 = eloToScore(elo1);
+    return (s1 - s0) * (2 * score - s0 - s1) * games / (2 * variance);
+}
+
+
+// Match ======================================================================
+
+/**
+    @param first Engine the scores are counted for
+    @param second Its opponent
+    @param rules Adjudication settings
+    @param threadCount Number of games played at a time
+    @throws ChessException if an engine has nothing to limit its searches
+*/
+Match::Match(MatchEngine first, MatchEngine second, MatchRules rules, int threadCount){
+    this->engines[0] = first;
+    this->engines[1] = second;
+    for(MatchEngine& engine : this->engines){
+        if(engine.time <= 0 && engine.moveTime <= 0 && engine.depth <= 0 && engine.nodes == 0){
+            throw ChessException("Match.cpp: Engine " + engine.name + " needs a time control, a depth or a node limit");
+        }
+    }
+    this->rules = rules;
+    this->threadCount = max(threadCount, 1);
+}
+
+/**
+    Read an EPD file of opening positions. Blank lines and lines starting with '#' are skipped.
+    @param path Location of the file
+    @returns Number of openings read
+    @throws ChessException if the file can't be read or a line isn't a legal position
+*/
+size_t Match::loadOpenings(string path){
+    ifstream file(path);
+    if(!file){
+        throw ChessException("Match.cpp: Could not open openings file " + path);
+    }
+    this->openings.clear();
+    string line;
+    int lineNumber = 0;
+    Position pos;
+    while(getline(file, line)){
+        lineNumber++;
+        if( !line.empty() && line.back() == '\r'){
+            line.pop_back();
+        }
+        size_t first = line.find_first_not_of(" \t");
+        if(first == string::npos || line[first] == '#'){
+            continue;
+        }
+        try{
+            string fen = Match::epdToFen(line);
+            pos.loadFen(fen);
+            this->openings.push_back(fen);
+        }
+        catch(const ChessException &cex){
+            throw ChessException(path + ":" + to_string(lineNumber) + ": " + cex.what());
+        }
+    }
+    return this->openings.size();
+}
+
+void Match::setSprt(MatchSprt sprt){
+    this->sprt = sprt;
+}
+
+/**
+    Write every finished game to a PGN file
+    @param path Location of the file, which is replaced
+    @throws ChessException if the file can't be created
+*/
+void Match::setPgnOutput(string path){
+    this->pgnFile.open(path, ios::trunc);
+    if(!this->pgnFile){
+        throw ChessException("Match.cpp: Could not create PGN file " + path);
+    }
+}
+
+/**
+    @param callback Called after each game with the game and the score so far, one game at a time
+*/
+void Match::setGameCallback(function<void(const MatchGame&, const MatchScore&)> callback){
+    this->gameCallback = callback;
+}
+
+/**
+    Play the games. With the SPRT enabled, no more games are started once it accepts a hypothesis,
+     and the games already running are played out.
+    @param gameCount Number of games to play
+    @returns The score of the first engine
+    @throws ChessException if a game can't be played or written
+*/
+MatchScore Match::run(int gameCount){
+    this->score = MatchScore();
+    atomic<int> nextRound(0);
+    atomic<bool> finished(false);
+    int workerCount = max(min(this->threadCount, gameCount), 1);
+    vector<string> errors(workerCount);
+
+    auto work = [this, gameCount, &nextRound, &finished, &errors](int t){
+        try{
+            while( !finished){
+                int round = nextRound++;
+                if(round >= gameCount){
+                    return;
+                }
+                // Each engine gets a fresh table and Search every game, so nothing either engine
+                //  found is seen by the other engine or used in another game
+                unique_ptr<TranspositionTable> tables[2];
+                unique_ptr<Search> searches[2];
+                Search* players[2];
+                for(int e=0; e < 2; e++){
+                    tables[e] = make_unique<TranspositionTable>(this->engines[e].hashMB);
+                    searches[e] = make_unique<Search>(tables[e].get());
+                    searches[e]->setOptions(this->engines[e].options);
+                    players[e] = searches[e].get();
+                }
+                MatchGame game = this->playGame(round, players);
+
+                lock_guard<mutex> lock(this->resultMutex);
+                if(game.result == "1/2-1/2"){
+                    this->score.draws++;
+                }
+                else if((game.result == "1-0") == (game.redEngine == 0)){
+                    this->score.wins++;
+                }
+                else{
+                    this->score.losses++;
+                }
+                this->writeGame(game);
+                if(this->gameCallback){
+                    this->gameCallback(game, this->score);
+                }
+                if(this->sprt.enabled && this->getSprtResult() != SprtContinue){
+                    finished = true;
+                }
+            }
+        }
+        catch(const ChessException &cex){
+            errors[t] = cex.what();
+            finished = true;
+        }
+    };
+    vector<thread> threads;
+    for(int t=1; t < workerCount; t++){
+        threads.emplace_back(work, t);
+    }
+    work(0);
+    for(thread& t : threads){
+        t.join();
+    }
+    for(string& e : errors){
+        if( !e.empty()){
+            throw ChessException(e);
+        }
+    }
+    return this->score;
+}
+
+/**
+    @returns Whether the SPRT has accepted a hypothesis with the games played so far
+*/
+SprtResult Match::getSprtResult(){
+    double llr = this->score.getLlr(this->sprt.elo0, this->sprt.elo1);
+    if(llr >= this->getUpperBound()){
+        return SprtAcceptH1;
+    }
+    if(llr <= this->getLowerBound()){
+        return SprtAcceptH0;
+    }
+    return SprtContinue;
+}
+
+/**
+    @returns The log likelihood ratio at which the SPRT accepts H0
+*/
+double Match::getLowerBound(){
+    return log(this->sprt.beta / (1 - this->sprt.alpha));
+}
+
+/**
+    @returns The log likelihood ratio at which the SPRT accepts H1
+*/
+double Match::getUpperBound(){
+    return log((1 - this->sprt.beta) / this->sprt.alpha);
+}
+
+/**
+    Static method
+    Turn an EPD line into a FEN. The halfmove clock and move number come from the "hmvc" and "fmvn"
+     operations when they are given.
+    @param epd Piece placement, team to move, castling and en passant fields, then any operations
+    @returns The FEN
+    @throws ChessException if a field is missing
+*/
+string Match::epdToFen(string_view epd){
+    istringstream in{string(epd)};
+    string fields[4];
+    for(string& field : fields){
+        if( !(in >> field)){
+            throw ChessException("Match.cpp: EPD needs 4 fields: " + string(epd));
+        }
+    }
+    string halfmoves = "0";
+    string moveNumber = "1";
+    string operation;
+    while(getline(in, operation, ';')){
+        istringstream op(operation);
+        string opcode, operand;
+        op >> opcode >> operand;
+        if(opcode == "hmvc" && !operand.empty()){
+            halfmoves = operand;
+        }
+        else if(opcode == "fmvn" && !operand.empty()){
+            moveNumber = operand;
+        }
+    }
+    return fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " " + halfmoves + " " + moveNumber;
+}
+
+/*
+    Private method
+    Play one game. Even rounds have the first engine as Red, odd rounds the second, with the same
+     opening for both rounds of a pair.
+*/
+MatchGame Match::playGame(int round, Search* players[2]){
+    MatchGame game;
+    game.round = round;
+    game.redEngine = round % 2;
+    game.fen = this->openings.empty() ? string(START_FEN) : this->openings[(round / 2) % this->openings.size()];
+    game.nodes = 0;
+
+    Position pos;
+    pos.loadFen(game.fen);
+    vector<uint64_t> keys;          // key of every position of the game, for repetitions
+    int64_t clocks[2] = {this->engines[0].time, this->engines[1].time};
+    int resignCounts[2] = {0, 0};   // moves in a row each engine's score was lost
+    int drawCount = 0;              // plies in a row both engines' scores were drawn
+    int winner = -1;                // engine index, -1 for a draw
+    while(true){
+        MoveList legal;
+        pos.generateLegalMoves(legal);
+        int mover = (pos.getSideToMove() == Red) ? game.redEngine : 1 - game.redEngine;
+        if(legal.size == 0){
+            winner = pos.inCheck() ? 1 - mover : -1;
+            game.termination = pos.inCheck() ? "checkmate" : "stalemate";
+            break;
+        }
+        if(pos.getHalfmoveClock() >= 100){
+            game.termination = "50 move rule";
+            break;
+        }
+        int repetitions = 0;
+        for(int i=2; i <= pos.getHalfmoveClock() && i <= (int) keys.size(); i += 2){
+            repetitions += (keys[keys.size() - i] == pos.getKey());
+        }
+        if(repetitions >= 2){
+            game.termination = "3-fold repetition";
+            break;
+        }
+        if(Match::isInsufficientMaterial(pos)){
+            game.termination = "insufficient material";
+            break;
+        }
+        if(this->rules.maxMoves > 0 && game.moves.size() >= 2 * (size_t) this->rules.maxMoves){
+            game.termination = "move limit";
+            break;
+        }
+
+        MatchEngine& engine = this->engines[mover];
+        TimeControl tc;
+        tc.time = clocks[mover];
+        tc.increment = (engine.time > 0) ? engine.increment : 0;
+        tc.moveTime = engine.moveTime;
+        tc.depth = engine.depth;
+        tc.nodes = engine.nodes;
+        auto start = chrono::steady_clock::now();
+        SearchResult result = players[mover]->think(pos, tc);
+        int64_t elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        game.nodes += result.nodes;
+        if(engine.time > 0){
+            clocks[mover] -= elapsed;
+            if(clocks[mover] < 0){
+                winner = 1 - mover;
+                game.termination = "time forfeit";
+                break;
+            }
+            clocks[mover] += engine.increment;
+        }
+        if( !legal.contains(result.bestMove)){
+            winner = 1 - mover;
+            game.termination = "illegal move";
+            break;
+        }
+
+        if(this->rules.resignMoveCount > 0){
+            resignCounts[mover] = (result.score <= -this->rules.resignScore) ? resignCounts[mover] + 1 : 0;
+            if(resignCounts[mover] >= this->rules.resignMoveCount){
+                winner = 1 - mover;
+                game.termination = "adjudication: resign";
+                break;
+            }
+        }
+        int moveNumber = pos.getTurnCount() / 2 + 1;
+        bool drawn = this->rules.drawMoveNumber > 0 && moveNumber >= this->rules.drawMoveNumber && abs(result.score) <= this->rules.drawScore;
+        drawCount = drawn ? drawCount + 1 : 0;
+
+        keys.push_back(pos.getKey());
+        pos.makeMove(result.bestMove);
+        game.moves.push_back(result.bestMove);
+        if(this->rules.drawMoveNumber > 0 && drawCount >= 2 * this->rules.drawMoveCount){
+            game.termination = "adjudication: draw";
+            break;
+        }
+    }
+
+    if(winner < 0){
+        game.result = "1/2-1/2";
+    }
+    else{
+        game.result = (winner == game.redEngine) ? "1-0" : "0-1";
+    }
+    return game;
+}
+
+/*
+    Private method
+    Append a finished game to the PGN file, if there is one. Called with resultMutex held.
+*/
+void Match::writeGame(const MatchGame& game){
+    if( !this->pgnFile.is_open()){
+        return;
+    }
+    time_t now = time(NULL);
+    tm local;
+    localtime_r(&now, &local);
+    char date[16];
+    strftime(date, sizeof(date), "%Y.%m.%d", &local);
+
+    PgnGame pgn;
+    pgn.setTag("Event", "match");
+    pgn.setTag("Site", "console_chess");
+    pgn.setTag("Date", date);
+    pgn.setTag("Round", to_string(game.round + 1));
+    pgn.setTag("White", this->engines[game.redEngine].name);
+    pgn.setTag("Black", this->engines[1 - game.redEngine].name);
+    pgn.setTag("Result", game.result);
+    if(game.fen != START_FEN){
+        pgn.setTag("FEN", game.fen);
+        pgn.setTag("SetUp", "1");
+    }
+    pgn.setTag("Termination", game.termination);
+    pgn.setTag("PlyCount", to_string(game.moves.size()));
+    pgn.result = game.result;
+    PgnWriter::writeGame(this->pgnFile, pgn, game.moves);
+    this->pgnFile.flush();
+    if( !this->pgnFile){
+        throw ChessException("Match.cpp: Could not write PGN file");
+    }
+}
+
+/*
+    Private method
+    Neither team can mate: only kings, and at most one bishop or knight between them
+*/
+bool Match::isInsufficientMaterial(Position& pos){
+    if(pos.getPieces(Pawn) || pos.getPieces(Rook) || pos.getPieces(Queen)){
+        return false;
+    }
+    return Bitboards::popCount(pos.getPieces(Bishop) | pos.getPieces(Knight)) <= 1;
+}
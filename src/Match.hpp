@@ -0,0 +1,133 @@
+#ifndef Match_H
+#define Match_H
+
+#include "Pgn.hpp"
+#include "Position.hpp"
+#include "Search.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/*
+    Engine-vs-engine games played inside this process, several at a time.
+
+    Each worker thread plays one game at a time with a Search and a transposition table for each
+     side, both made fresh for every game. Both sides are this engine, so they share the network and
+     the tablebases. What tells them apart is the limits their searches run with (clock, time per
+     move, depth or nodes), their table sizes, and their SearchOptions: the evaluation they use and
+     their contempt. The book isn't loaded by the match tool, so games start from the openings given.
+    Openings are read from an EPD file, one position per line. Every opening is played twice, once
+     with each engine as Red. Without openings, every game starts from the standard position.
+    A game ends on checkmate, stalemate, the 50 move rule, repetition, insufficient material, a
+     loss on time, or adjudication:
+        draw     both engines' scores stayed within drawScore for drawMoveCount moves in a row,
+                  starting at move drawMoveNumber
+        resign   an engine's score stayed at -resignScore or below for resignMoveCount of its moves
+        maxMoves the game reached this many moves
+    Scores are counted for the first engine.
+*/
+const int MATCH_DEFAULT_GAMES = 100;
+
+struct MatchEngine {
+    string name;
+    int64_t time = 0;           // milliseconds on the clock at the start of the game. 0 means no clock.
+    int64_t increment = 0;      // milliseconds added after each move
+    int64_t moveTime = 0;       // milliseconds per move
+    int depth = 0;
+    uint64_t nodes = 0;
+    size_t hashMB = TT_DEFAULT_MB;  // size of the engine's transposition table
+    SearchOptions options;
+};
+
+struct MatchRules {
+    int drawMoveNumber = 0;     // 0 turns draw adjudication off
+    int drawMoveCount = 8;
+    int drawScore = 10;         // centipawns
+    int resignMoveCount = 0;    // 0 turns resign adjudication off
+    int resignScore = 1000;
+    int maxMoves = 0;           // 0 means no limit
+};
+
+/*
+    Sequential probability ratio test of H0: the Elo difference is elo0, against H1: it is elo1.
+     alpha and beta are the chances of accepting H1 when H0 holds, and H0 when H1 holds.
+*/
+struct MatchSprt {
+    bool enabled = false;
+    double elo0 = 0;
+    double elo1 = 5;
+    double alpha = 0.05;
+    double beta = 0.05;
+};
+
+enum SprtResult {
+    SprtContinue,
+    SprtAcceptH0,
+    SprtAcceptH1
+};
+
+/*
+    Wins, draws and losses of the first engine
+*/
+struct MatchScore {
+    uint64_t wins = 0;
+    uint64_t draws = 0;
+    uint64_t losses = 0;
+
+    uint64_t getGames() const;
+    double getScore() const;
+    double getElo() const;
+    double getEloError() const;
+    double getLlr(double, double) const;
+};
+
+/*
+    A finished game
+*/
+struct MatchGame {
+    int round;                  // 0 based, in the order games were started
+    int redEngine;              // index of the engine playing Red
+    string fen;                 // starting position
+    string result;              // "1-0", "0-1" or "1/2-1/2"
+    string termination;         // why the game ended
+    vector<PackedMove> moves;
+    uint64_t nodes;             // nodes searched by both engines
+};
+
+class Match {
+    MatchEngine engines[2];
+    MatchRules rules;
+    MatchSprt sprt;
+    int threadCount;
+    vector<string> openings;    // FENs
+    ofstream pgnFile;
+    function<void(const MatchGame&, const MatchScore&)> gameCallback;
+    mutex resultMutex;          // guards score, pgnFile and the callback
+    MatchScore score;
+
+    public:
+        Match(MatchEngine, MatchEngine, MatchRules, int);
+        size_t loadOpenings(string);
+        void setSprt(MatchSprt);
+        void setPgnOutput(string);
+        void setGameCallback(function<void(const MatchGame&, const MatchScore&)>);
+        MatchScore run(int);
+        SprtResult getSprtResult();
+        double getLowerBound();
+        double getUpperBound();
+        static string epdToFen(string_view);
+
+    private:
+        MatchGame playGame(int, Search*[2]);
+        void writeGame(const MatchGame&);
+        static bool isInsufficientMaterial(Position&);
+};
+
+#endif
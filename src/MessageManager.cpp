@@ -55,6 +55,18 @@ void MessageManager::displayBottom(){
     this->displayWrapper(this->bottom, BELOW);
 }
 
+/**
+ * Same as displayTop, but the lines are added to a vector instead of being printed
+ * @param lines Every line of every message is appended to it
+*/
+void MessageManager::collectTop(vector<string>& lines){
+    this->collectWrapper(this->top, ABOVE, lines);
+}
+
+void MessageManager::collectBottom(vector<string>& lines){
+    this->collectWrapper(this->bottom, BELOW, lines);
+}
+
 /* ==================== Setters ==================== */
 
 /**
@@ -118,4 +130,28 @@ void MessageManager::displayWrapper(queue<Message> &q, MHeight mh){
         q.front().print();
         q.pop();
     }
-}
\ No newline at end of file
+}
+
+/** Wrapper for collecting the lines of the top and bottom Message queues */
+void MessageManager::collectWrapper(queue<Message> &q, MHeight mh, vector<string> &lines){
+    auto addLines = [&lines](string content) -> void {
+        size_t start = 0;
+        size_t end;
+        while((end = content.find('\n', start)) != string::npos){
+            lines.push_back(content.substr(start, end - start));
+            start = end + 1;
+        }
+        lines.push_back(content.substr(start));
+    };
+    // Continuous messages are displayed first
+    for(int i=0; i<this->recurringMessages.size(); i++){
+        if(this->recurringMessages.at(i).getMHeight() == mh){
+            addLines(this->recurringMessages.at(i).getContent());
+        }
+    }
+    // Collect once off messages
+    while( !q.empty()){
+        addLines(q.front().getContent());
+        q.pop();
+    }
+}
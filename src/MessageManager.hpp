@@ -4,6 +4,8 @@
 #include "Message.hpp"
 
 #include <queue>
+#include <string>
+#include <vector>
 
 
 class MessageManager
@@ -23,12 +25,15 @@ class MessageManager
         void displayAll();
         void displayTop();
         void displayBottom();
+        void collectTop(vector<string>&);
+        void collectBottom(vector<string>&);
         // setters
         void addMessage(Message);
 
     private:
         void clearWrapper(queue<Message>&, MHeight);
-        void displayWrapper(queue<Message>&, MHeight);        
+        void displayWrapper(queue<Message>&, MHeight);
+        void collectWrapper(queue<Message>&, MHeight, vector<string>&);        
 };
 
 #endif
@@ -4,6 +4,8 @@
 #include "ChessException.hpp"
 #include "Util.hpp"
 #include "Debug.hpp"
+#include "Stats.hpp"
+#include "Position.hpp"
 
 #include <regex>
 #include <vector>
@@ -15,16 +17,19 @@ using namespace std;
 
 
 Move::Move(TeamColor tc){
+    Stats::count(MoveAllocStat);
     this->reset(tc);
 }
 
 Move::Move(TeamColor tc, int src, int dest){
+    Stats::count(MoveAllocStat);
     this->reset(tc);
     this->sourceIndex = src;
     this->destIndex = dest;
 }
 
 Move::Move(TeamColor tc, int src, int dest, SpecialMove spec){
+    Stats::count(MoveAllocStat);
     this->reset(tc);
     this->sourceIndex = src;
     this->destIndex = dest;
@@ -100,12 +105,11 @@ bool Move::getOpponentCapture(){
     return this->opponentCapture;
 }
 
-int* Move::getAllDestIndices(){
-    int* arr[this->allDestIndices.size()];
-    for(int i=0; i < this->allDestIndices.size(); i++){
-        arr[i] = &this->allDestIndices.at(i);
-    }
-    return *arr;
+/**
+ * @returns Every square in allDestIndices, as a mask
+*/
+Bitboard Move::getAllDestMask(){
+    return this->allDestMask;
 }
 
 int Move::getAllDestIndexAt(int ind){
@@ -128,6 +132,13 @@ map<int, SpecialMove> Move::getAllSpecialIndices(){
     return this->allSpecialIndices;
 }
 
+/**
+ * @returns Squares of special moves that the board highlights: Castling, En Passant and promotion
+*/
+Bitboard Move::getSpecialHighlightMask(){
+    return this->specialHighlightMask;
+}
+
 // Calculations ===================================
 
 /*
@@ -269,6 +280,7 @@ void Move::validateMoveset(string mvset){
  * @returns Nothing. But Move.allDestIndices member will be updated.
 */
 vector<Move*> Move::calcAllMoves(Board* board, bool determineCheck){
+    StatTimer timer(MoveGenStat);
     // determine if selection is valid since this method is call when finding potential moves to display to user.
     this->isValidSelection(board);    
     // Determine if the king is already in check
@@ -368,7 +380,7 @@ vector<Move*> Move::calcAllMoves(Board* board, bool determineCheck){
          
         // add potentialCheckingMoves from potentialBoardState to board! This lets the isCheckmate() method in Board
         //  highlight all pieces that contribute to a checkmate
-        board->appendPotentialCheckingIndices(potentialBoardState->getPotentialCheckingIndices(), false);
+        board->appendPotentialCheckingMask(potentialBoardState->getPotentialCheckingMask());
 
         if(DEBUG_MODE && POTENTIAL_STATE_DEBUG){
             string threatLevel = m->getKingChecked() ? "CHECK" : "SAFE";
@@ -389,13 +401,17 @@ vector<Move*> Move::calcAllMoves(Board* board, bool determineCheck){
                 if(!this->allSpecialIndices.count(loc)){
                     // map for highlighting
                     this->allSpecialIndices.insert( {loc, m->getSpecial()} );
+                    if(m->getSpecial() == Castling || m->getSpecial() == EnPassant || m->getSpecial() == PawnPromo){
+                        this->specialHighlightMask |= Bitboards::squareBB(loc);
+                    }
                     // add to returned vector
                     finalValidMoves.push_back(m);
                 }
             }
-            else if( !count(begin(this->allDestIndices), end(this->allDestIndices), loc)){
-                // array for highlighting
+            else if( !(this->allDestMask & Bitboards::squareBB(loc))){
+                // array and mask for highlighting
                 this->allDestIndices.push_back(loc);
+                this->allDestMask |= Bitboards::squareBB(loc);
                 // add to returned vector
                 finalValidMoves.push_back(m);
             }
@@ -423,6 +439,7 @@ vector<Move*> Move::calcAllMoves(Board* board, bool determineCheck){
     4) Set value for numBranchIndices
 */
 vector<Move*> Move::calcMovesetMoves(string moveset, Board* board){
+    StatTimer timer(MovesetStat);
     /*
         Remember that H1 is index 0 in the array.
                       A8 is 63 in the array.
@@ -885,6 +902,23 @@ vector<Move*> Move::calcEnPassant(Board* board){
     return mvs;
 }
 
+/**
+ * Static exchange evaluation of this move. Cheaper than cloning the board and simulating each
+ *  recapture since it only looks at attacker bitboards.
+ * @param board The Board the move would be made on
+ * @returns Material gained by this move's team in centipawns after all recaptures on the destination.
+ *           Negative if the destination is defended well enough that the move loses material.
+*/
+int Move::see(Board* board){
+    this->isValidSelection(board);
+    if(this->destIndex < 0 || this->destIndex > 63){
+        throw MissingDestinationException();
+    }
+    Position pos(board, this->team);
+    PieceType promo = (this->special == PawnPromo) ? Queen : NoPiece;
+    return pos.see(packMove(this->sourceIndex, this->destIndex, this->special, promo));
+}
+
 void Move::reset(TeamColor tc){
     this->special = NonSpecial;
     this->team = tc;
@@ -897,7 +931,8 @@ void Move::reset(TeamColor tc){
     this->allDestIndices.clear();
     this->obstructedIndices.clear();
     this->allSpecialIndices.clear();
-
+    this->allDestMask = EMPTY_BB;
+    this->specialHighlightMask = EMPTY_BB;
 }
 
 /**
@@ -936,6 +971,7 @@ int* Move::generateBounds(int index, int* bounds){
 void Move::appendAllDestIndices(int* newIndices, int size){
     for(int i=0; i < size; i++){
         this->allDestIndices.push_back(newIndices[i]);
+        this->allDestMask |= Bitboards::squareBB(newIndices[i]);
     }
 }  
 
@@ -21,6 +21,8 @@ class Move {
     bool areMovesCalculated; // True if all valid moves have been calculated already
     map<int, SpecialMove> allSpecialIndices; // <destination, special> All special moves. Used for highlighting in board.
     vector<int> allDestIndices; // all board indexes that the selected piece can move to.
+    Bitboard allDestMask; // allDestIndices as a set of squares. Used for highlighting in board.
+    Bitboard specialHighlightMask; // Castling, En Passant and promotion squares in allSpecialIndices
     vector<int> obstructedIndices; // All board values that have a non-null piece occupying that position.
 
     public:
@@ -42,8 +44,9 @@ class Move {
         int getDestIndex();
         TeamColor getTeamColor();
         bool getOpponentCapture();
-        int* getAllDestIndices();
+        Bitboard getAllDestMask();
         map<int, SpecialMove> getAllSpecialIndices();
+        Bitboard getSpecialHighlightMask();
         int getAllDestIndexAt(int);
         int getSizeofAllDestIndices();
         bool getAreMovesCalculated();
@@ -61,6 +64,7 @@ class Move {
         vector<Move*> calcCastling(Board*); // Calculate castling moves starting from specificed PieceType
         vector<Move*> calcEnPassant(Board*);
         void enPassantCapture(Board*);
+        int see(Board*);
     
     private:
         // Calculations
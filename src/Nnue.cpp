@@ -0,0 +1,289 @@
+#include "Nnue.hpp"
+#include "Position.hpp"
+#include "Bitboard.hpp"
+#include "ChessException.hpp"
+#include "Debug.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NNUE_X86 true
+#endif
+
+using namespace std;
+
+/*
+    All methods are static in Nnue. The network is shared by every Position and thread, and is
+     read-only once loaded.
+*/
+
+// Network memory. Points into a read-only mapping of the network file.
+static const uint8_t* mappedFile = NULL;
+static size_t mappedSize = 0;
+static const int16_t* ftBiases = NULL;
+static const int16_t* ftWeights = NULL;
+static const int16_t* outWeights = NULL;
+static int32_t outBias = 0;
+
+// SIMD kernels ===================================
+
+static void addColumnScalar(int16_t* acc, const int16_t* column){
+    for(int i=0; i < NNUE_HIDDEN; i++){
+        acc[i] += column[i];
+    }
+}
+
+static void subColumnScalar(int16_t* acc, const int16_t* column){
+    for(int i=0; i < NNUE_HIDDEN; i++){
+        acc[i] -= column[i];
+    }
+}
+
+// Dot product of both clipped accumulator halves with the output weights
+static int32_t outputScalar(const int16_t* us, const int16_t* them, const int16_t* weights){
+    int32_t sum = 0;
+    for(int i=0; i < NNUE_HIDDEN; i++){
+        int16_t a = us[i] < 0 ? 0 : (us[i] > 127 ? 127 : us[i]);
+        int16_t b = them[i] < 0 ? 0 : (them[i] > 127 ? 127 : them[i]);
+        sum += a * weights[i] + b * weights[NNUE_HIDDEN + i];
+    }
+    return sum;
+}
+
+#ifdef NNUE_X86
+static void addColumnSse2(int16_t* acc, const int16_t* column){
+    for(int i=0; i < NNUE_HIDDEN; i += 8){
+        __m128i a = _mm_load_si128((const __m128i*) (acc + i));
+        __m128i c = _mm_loadu_si128((const __m128i*) (column + i));
+        _mm_store_si128((__m128i*) (acc + i), _mm_add_epi16(a, c));
+    }
+}
+
+static void subColumnSse2(int16_t* acc, const int16_t* column){
+    for(int i=0; i < NNUE_HIDDEN; i += 8){
+        __m128i a = _mm_load_si128((const __m128i*) (acc + i));
+        __m128i c = _mm_loadu_si128((const __m128i*) (column + i));
+        _mm_store_si128((__m128i*) (acc + i), _mm_sub_epi16(a, c));
+    }
+}
+
+static int32_t outputSse2(const int16_t* us, const int16_t* them, const int16_t* weights){
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(127);
+    __m128i sum = _mm_setzero_si128();
+    for(int i=0; i < NNUE_HIDDEN; i += 8){
+        __m128i a = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((const __m128i*) (us + i)), zero), max);
+        __m128i b = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((const __m128i*) (them + i)), zero), max);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(a, _mm_loadu_si128((const __m128i*) (weights + i))));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(b, _mm_loadu_si128((const __m128i*) (weights + NNUE_HIDDEN + i))));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("avx2")))
+static void addColumnAvx2(int16_t* acc, const int16_t* column){
+    for(int i=0; i < NNUE_HIDDEN; i += 16){
+        __m256i a = _mm256_load_si256((const __m256i*) (acc + i));
+        __m256i c = _mm256_loadu_si256((const __m256i*) (column + i));
+        _mm256_store_si256((__m256i*) (acc + i), _mm256_add_epi16(a, c));
+    }
+}
+
+__attribute__((target("avx2")))
+static void subColumnAvx2(int16_t* acc, const int16_t* column){
+    for(int i=0; i < NNUE_HIDDEN; i += 16){
+        __m256i a = _mm256_load_si256((const __m256i*) (acc + i));
+        __m256i c = _mm256_loadu_si256((const __m256i*) (column + i));
+        _mm256_store_si256((__m256i*) (acc + i), _mm256_sub_epi16(a, c));
+    }
+}
+
+__attribute__((target("avx2")))
+static int32_t outputAvx2(const int16_t* us, const int16_t* them, const int16_t* weights){
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(127);
+    __m256i sum = _mm256_setzero_si256();
+    for(int i=0; i < NNUE_HIDDEN; i += 16){
+        __m256i a = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*) (us + i)), zero), max);
+        __m256i b = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*) (them + i)), zero), max);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, _mm256_loadu_si256((const __m256i*) (weights + i))));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(b, _mm256_loadu_si256((const __m256i*) (weights + NNUE_HIDDEN + i))));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+}
+#endif
+
+/*
+    Kernels used by the evaluator, chosen once at startup based on what the CPU supports
+*/
+struct NnueKernels {
+    void (*addColumn)(int16_t*, const int16_t*);
+    void (*subColumn)(int16_t*, const int16_t*);
+    int32_t (*output)(const int16_t*, const int16_t*, const int16_t*);
+    const char* name;
+};
+
+static NnueKernels selectKernels(){
+#ifdef NNUE_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        return { addColumnAvx2, subColumnAvx2, outputAvx2, "AVX2" };
+    }
+    if(__builtin_cpu_supports("sse2")){
+        return { addColumnSse2, subColumnSse2, outputSse2, "SSE2" };
+    }
+#endif
+    return { addColumnScalar, subColumnScalar, outputScalar, "scalar" };
+}
+
+static const NnueKernels kernels = selectKernels();
+
+// Loading ===================================
+
+/**
+    Map a network file into memory. The file is mapped read-only, so processes using the same file
+     share its pages. Replaces any network that was already loaded.
+    @param path Location of the network file. See Nnue.hpp for the layout.
+    @returns nothing. Throws ChessException if the file can't be used.
+*/
+void Nnue::load(string path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw ChessException("Nnue.cpp: Could not open network file");
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        close(fd);
+        throw ChessException("Nnue.cpp: Could not read network file size");
+    }
+    size_t expected = NNUE_HEADER_SIZE + sizeof(int16_t) * (NNUE_HIDDEN + (size_t) NNUE_INPUTS * NNUE_HIDDEN + 2 * NNUE_HIDDEN) + sizeof(int32_t);
+    if((size_t) st.st_size != expected){
+        close(fd);
+        throw ChessException("Nnue.cpp: Network file has the wrong size");
+    }
+    void* mem = mmap(NULL, expected, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping stays valid after the file is closed
+    if(mem == MAP_FAILED){
+        throw ChessException("Nnue.cpp: Could not map network file");
+    }
+    const uint8_t* data = (const uint8_t*) mem;
+    uint32_t header[3];
+    memcpy(header, data + 4, sizeof(header));
+    if(memcmp(data, "CCNN", 4) != 0 || header[0] != NNUE_VERSION || header[1] != NNUE_INPUTS || header[2] != NNUE_HIDDEN){
+        munmap(mem, expected);
+        throw ChessException("Nnue.cpp: Network file header doesn't match this evaluator");
+    }
+    madvise(mem, expected, MADV_WILLNEED);
+
+    unload();
+    mappedFile = data;
+    mappedSize = expected;
+    ftBiases = (const int16_t*) (data + NNUE_HEADER_SIZE);
+    ftWeights = ftBiases + NNUE_HIDDEN;
+    outWeights = ftWeights + (size_t) NNUE_INPUTS * NNUE_HIDDEN;
+    memcpy(&outBias, outWeights + 2 * NNUE_HIDDEN, sizeof(outBias));
+
+    if(DEBUG_MODE) cout << "Nnue.cpp: Loaded network " << path << " using " << kernels.name << " kernels" << endl;
+}
+
+void Nnue::unload(){
+    if(mappedFile != NULL){
+        munmap((void*) mappedFile, mappedSize);
+    }
+    mappedFile = NULL;
+    mappedSize = 0;
+    ftBiases = NULL;
+    ftWeights = NULL;
+    outWeights = NULL;
+    outBias = 0;
+}
+
+bool Nnue::isLoaded(){
+    return mappedFile != NULL;
+}
+
+// Name of the SIMD instruction set the kernels were chosen for
+const char* Nnue::getSimdName(){
+    return kernels.name;
+}
+
+// Calculations ===================================
+
+/**
+    HalfKP feature index of a piece. Black's perspective is flipped vertically so both teams see
+     their own pieces starting at the bottom of the board.
+    @param perspective The team whose accumulator the feature belongs to
+    @param king Index of the perspective team's king
+    @param tc Team of the piece
+    @param pt Type of the piece. Kings are not features.
+    @param index Index of the piece
+    @returns Row of the first layer weight matrix
+*/
+int Nnue::featureIndex(TeamColor perspective, int king, TeamColor tc, PieceType pt, int index){
+    if(perspective == Black){
+        king ^= 56;
+        index ^= 56;
+    }
+    int kind = (Pawn - pt) * 2 + (tc != perspective);  // pawns first, queens last
+    return king * NNUE_PIECE_FEATURES + kind * 64 + index + 1;
+}
+
+void Nnue::addFeature(Accumulator& acc, TeamColor perspective, int feature){
+    kernels.addColumn(acc.values[perspective - 1], ftWeights + (size_t) feature * NNUE_HIDDEN);
+}
+
+void Nnue::removeFeature(Accumulator& acc, TeamColor perspective, int feature){
+    kernels.subColumn(acc.values[perspective - 1], ftWeights + (size_t) feature * NNUE_HIDDEN);
+}
+
+/**
+    Rebuild one perspective of an accumulator from every piece on the board
+    @param pos The Position the accumulator belongs to
+    @param acc The accumulator to rebuild
+    @param perspective Which half of the accumulator to rebuild
+    @returns nothing
+*/
+void Nnue::refresh(Position& pos, Accumulator& acc, TeamColor perspective){
+    int16_t* values = acc.values[perspective - 1];
+    memcpy(values, ftBiases, sizeof(int16_t) * NNUE_HIDDEN);
+    int king = pos.getKingIndex(perspective);
+    if(king != -1){
+        Bitboard pieces = pos.getOccupied() & ~pos.getPieces(King);
+        while(pieces){
+            int index = Bitboards::popLsb(pieces);
+            addFeature(acc, perspective, featureIndex(perspective, king, pos.getTeam(index), pos.getType(index), index));
+        }
+    }
+    acc.computed[perspective - 1] = true;
+}
+
+/**
+    Network evaluation of a position. Rebuilds any accumulator half invalidated by a king move.
+    @param pos The Position to evaluate
+    @param acc The Position's accumulator
+    @returns Score in centipawns from the point of view of the team to move
+*/
+int Nnue::evaluate(Position& pos, Accumulator& acc){
+    if( !isLoaded()){
+        throw ChessException("Nnue.cpp: No network loaded");
+    }
+    for(int tc = Red; tc <= Black; tc++){
+        if( !acc.computed[tc - 1]){
+            refresh(pos, acc, (TeamColor) tc);
+        }
+    }
+    int us = pos.getSideToMove() == Black ? 1 : 0;
+    int32_t sum = outBias + kernels.output(acc.values[us], acc.values[1 - us], outWeights);
+    return sum / NNUE_OUTPUT_SCALE;
+}
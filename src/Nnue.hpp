@@ -0,0 +1,62 @@
+#ifndef Nnue_H
+#define Nnue_H
+
+#include "Piece.hpp"
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+class Position;
+
+/*
+    Efficiently updatable neural network (NNUE) evaluation with HalfKP inputs.
+
+    Every input feature is a (king index, piece, index) triple seen from one team's perspective: the
+     position of that team's king together with one non-king piece. Each team has its own accumulator,
+     the sum of the first layer weight columns of all active features. Moving a non-king piece only
+     adds and subtracts a couple of columns, so Position keeps both accumulators updated on every
+     putPiece()/removePiece(). A king move changes every feature of its own perspective, so that
+     accumulator is rebuilt the next time the position is evaluated.
+
+    Network file layout (little endian, no padding):
+        char     magic[4]                       "CCNN"
+        uint32   version                        NNUE_VERSION
+        uint32   inputs                         NNUE_INPUTS
+        uint32   hidden                         NNUE_HIDDEN
+        int16    ftBiases[NNUE_HIDDEN]
+        int16    ftWeights[NNUE_INPUTS][NNUE_HIDDEN]
+        int16    outWeights[2 * NNUE_HIDDEN]    team to move half first
+        int32    outBias
+    The output is (outBias + sum(clamp(acc, 0, 127) * outWeights)) / NNUE_OUTPUT_SCALE centipawns.
+*/
+const int NNUE_VERSION = 1;
+const int NNUE_PIECE_FEATURES = 10 * 64 + 1;    // 5 piece types * 2 teams * 64 indices. Index 0 is unused.
+const int NNUE_INPUTS = 64 * NNUE_PIECE_FEATURES;
+const int NNUE_HIDDEN = 256;
+const int NNUE_OUTPUT_SCALE = 64;
+const int NNUE_HEADER_SIZE = 16;
+
+/*
+    First layer output for both perspectives. [0] is Red's perspective, [1] is Black's.
+*/
+struct Accumulator {
+    alignas(32) int16_t values[2][NNUE_HIDDEN];
+    bool computed[2];
+};
+
+class Nnue {
+    public:
+        static void load(string);
+        static void unload();
+        static bool isLoaded();
+        static const char* getSimdName();
+        static int featureIndex(TeamColor, int, TeamColor, PieceType, int);
+        static void addFeature(Accumulator&, TeamColor, int);
+        static void removeFeature(Accumulator&, TeamColor, int);
+        static void refresh(Position&, Accumulator&, TeamColor);
+        static int evaluate(Position&, Accumulator&);
+};
+
+#endif
@@ -0,0 +1,519 @@
+#include "PatternScan.hpp"
+#include "ChessException.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PS_X86 true
+#endif
+
+using namespace std;
+
+// Letter used for each PieceType in queries
+const char psPieceLetter[7] = { ' ', 'K', 'Q', 'R', 'B', 'N', 'P' };
+
+// SIMD kernels ===================================
+
+/*
+    Plane values of a team's pieces of a type, inverted: a square holds the piece when every plane
+     XORed with its value is set
+*/
+struct PsPlaneKey {
+    uint64_t inverted[4];
+};
+
+static PsPlaneKey planeKey(TeamColor team, PieceType type){
+    PsPlaneKey key;
+    for(int k=0; k < 3; k++){
+        key.inverted[k] = ((type >> k) & 1) ? 0 : ~0ULL;
+    }
+    key.inverted[3] = (team == Black) ? 0 : ~0ULL;
+    return key;
+}
+
+static void pieceColumnScalar(const PsBlock& block, const PsPlaneKey& key, uint64_t* out){
+    for(int i=0; i < PS_BLOCK_ROWS; i++){
+        out[i] = (block.planes[0][i] ^ key.inverted[0]) & (block.planes[1][i] ^ key.inverted[1])
+               & (block.planes[2][i] ^ key.inverted[2]) & (block.planes[3][i] ^ key.inverted[3]);
+    }
+}
+
+// Clear the rows of 'match' whose popCount(column & mask) is outside [low, high]
+static void countRangeScalar(const uint64_t* column, Bitboard mask, int low, int high, uint8_t* match){
+    for(int i=0; i < PS_BLOCK_ROWS; i++){
+        int count = Bitboards::popCount(column[i] & mask);
+        match[i] &= (count >= low && count <= high) ? 0xFF : 0;
+    }
+}
+
+#ifdef PS_X86
+// Row bytes to keep for each 4 bit mask of rows that failed
+static const uint32_t keepRows[16] = {
+    0xFFFFFFFF, 0xFFFFFF00, 0xFFFF00FF, 0xFFFF0000, 0xFF00FFFF, 0xFF00FF00, 0xFF0000FF, 0xFF000000,
+    0x00FFFFFF, 0x00FFFF00, 0x00FF00FF, 0x00FF0000, 0x0000FFFF, 0x0000FF00, 0x000000FF, 0x00000000
+};
+
+__attribute__((target("avx2")))
+static void pieceColumnAvx2(const PsBlock& block, const PsPlaneKey& key, uint64_t* out){
+    const __m256i k0 = _mm256_set1_epi64x(key.inverted[0]);
+    const __m256i k1 = _mm256_set1_epi64x(key.inverted[1]);
+    const __m256i k2 = _mm256_set1_epi64x(key.inverted[2]);
+    const __m256i k3 = _mm256_set1_epi64x(key.inverted[3]);
+    for(int i=0; i < PS_BLOCK_ROWS; i += 4){
+        __m256i p0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (block.planes[0] + i)), k0);
+        __m256i p1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (block.planes[1] + i)), k1);
+        __m256i p2 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (block.planes[2] + i)), k2);
+        __m256i p3 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (block.planes[3] + i)), k3);
+        __m256i pieces = _mm256_and_si256(_mm256_and_si256(p0, p1), _mm256_and_si256(p2, p3));
+        _mm256_storeu_si256((__m256i*) (out + i), pieces);
+    }
+}
+
+// popCount of 4 rows at a time: count the bits of each nibble with a lookup, then add the bytes up
+__attribute__((target("avx2")))
+static void countRangeAvx2(const uint64_t* column, Bitboard mask, int low, int high, uint8_t* match){
+    const __m256i nibbleBits = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowNibbles = _mm256_set1_epi8(0x0F);
+    const __m256i squares = _mm256_set1_epi64x(mask);
+    const __m256i lowBound = _mm256_set1_epi64x(low);
+    const __m256i highBound = _mm256_set1_epi64x(high);
+    const __m256i zero = _mm256_setzero_si256();
+    for(int i=0; i < PS_BLOCK_ROWS; i += 4){
+        __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i*) (column + i)), squares);
+        __m256i bits = _mm256_add_epi8(_mm256_shuffle_epi8(nibbleBits, _mm256_and_si256(v, lowNibbles)),
+                                       _mm256_shuffle_epi8(nibbleBits, _mm256_and_si256(_mm256_srli_epi16(v, 4), lowNibbles)));
+        __m256i count = _mm256_sad_epu8(bits, zero);
+        __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(lowBound, count), _mm256_cmpgt_epi64(count, highBound));
+        int failed = _mm256_movemask_pd(_mm256_castsi256_pd(outside));
+        if(failed){
+            uint32_t rows;
+            memcpy(&rows, match + i, 4);
+            rows &= keepRows[failed];
+            memcpy(match + i, &rows, 4);
+        }
+    }
+}
+#endif
+
+/*
+    Kernels used by queries, chosen once at startup based on what the CPU supports
+*/
+struct PsKernels {
+    void (*pieceColumn)(const PsBlock&, const PsPlaneKey&, uint64_t*);
+    void (*countRange)(const uint64_t*, Bitboard, int, int, uint8_t*);
+    const char* name;
+};
+
+static PsKernels selectKernels(){
+#ifdef PS_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        return { pieceColumnAvx2, countRangeAvx2, "AVX2" };
+    }
+#endif
+    return { pieceColumnScalar, countRangeScalar, "scalar" };
+}
+
+static const PsKernels kernels = selectKernels();
+
+// Queries ===================================
+
+static TeamColor parseTeam(char c){
+    if(c == 'w' || c == 'r') return Red;
+    if(c == 'b') return Black;
+    return NoColor;
+}
+
+/**
+    @param text Terms separated by spaces. See PatternScan.hpp for the syntax.
+    @returns nothing. Throws ChessException if a term can't be parsed.
+*/
+void PatternQuery::parse(string text){
+    this->terms.clear();
+    istringstream words(text);
+    string word;
+    while(words >> word){
+        PsTerm term = { PsMaterial, NoColor, NoPiece, 0, 64 };
+        if(word == "opposite-bishops"){
+            term.kind = PsOppositeBishops;
+        }
+        else if(word.size() == 5 && word.compare(0, 4, "stm=") == 0 && parseTeam(word[4]) != NoColor){
+            term.kind = PsSideToMove;
+            term.team = parseTeam(word[4]);
+        }
+        else if(word.size() > 2 && word[1] == ':' && parseTeam(word[0]) != NoColor){
+            term.team = parseTeam(word[0]);
+            string name = word.substr(2);
+            if(name == "bishop-pair") term.kind = PsBishopPair;
+            else if(name == "rook-behind-7th-pawn") term.kind = PsRookBehindPawn;
+            else throw ChessException("PatternScan.cpp: Unknown pattern " + word);
+        }
+        else{
+            term.team = parseTeam(word[0]);
+            for(int pt = King; pt <= Pawn && word.size() > 1; pt++){
+                if(psPieceLetter[pt] == word[1]){
+                    term.type = (PieceType) pt;
+                }
+            }
+            if(term.team == NoColor || term.type == NoPiece){
+                throw ChessException("PatternScan.cpp: Unknown term " + word);
+            }
+            size_t opLength = (word.size() > 3 && word[3] == '=') ? 2 : 1;
+            string op = word.substr(2, opLength);
+            int n;
+            try{
+                size_t used;
+                n = stoi(word.substr(2 + opLength), &used);
+                if(used != word.size() - 2 - opLength || n < 0 || n > 64){
+                    throw invalid_argument(word);
+                }
+            }
+            catch(const exception &ex){
+                throw ChessException("PatternScan.cpp: Missing count in " + word);
+            }
+            if(op == "=") { term.low = n; term.high = n; }
+            else if(op == ">=") term.low = n;
+            else if(op == "<=") term.high = n;
+            else if(op == ">") term.low = n + 1;
+            else if(op == "<") term.high = n - 1;
+            else throw ChessException("PatternScan.cpp: Unknown comparison in " + word);
+        }
+        this->terms.push_back(term);
+    }
+}
+
+int PatternQuery::getTermCount(){
+    return (int) this->terms.size();
+}
+
+/**
+    Find the rows of a block that match every term
+    @param block Block to test
+    @param match Set to 0xFF for the rows that match and 0 for the others. PS_BLOCK_ROWS bytes.
+    @param a Scratch column of PS_BLOCK_ROWS bitboards
+    @param b Scratch column of PS_BLOCK_ROWS bitboards
+    @returns nothing
+*/
+void PatternQuery::evaluate(const PsBlock& block, uint8_t* match, uint64_t* a, uint64_t* b){
+    memset(match, 0xFF, block.rows);
+    memset(match + block.rows, 0, PS_BLOCK_ROWS - block.rows);
+    for(PsTerm& t : this->terms){
+        switch(t.kind){
+            case PsMaterial:
+                kernels.pieceColumn(block, planeKey(t.team, t.type), a);
+                kernels.countRange(a, ~EMPTY_BB, t.low, t.high, match);
+                break;
+            case PsBishopPair:
+                kernels.pieceColumn(block, planeKey(t.team, Bishop), a);
+                kernels.countRange(a, LIGHT_SQUARES_BB, 1, 64, match);
+                kernels.countRange(a, ~LIGHT_SQUARES_BB, 1, 64, match);
+                break;
+            case PsOppositeBishops:
+                kernels.pieceColumn(block, planeKey(Red, Bishop), a);
+                kernels.countRange(a, ~EMPTY_BB, 1, 1, match);
+                kernels.pieceColumn(block, planeKey(Black, Bishop), b);
+                kernels.countRange(b, ~EMPTY_BB, 1, 1, match);
+                // With one bishop each, they're on different colors when both colors have one
+                for(int i=0; i < PS_BLOCK_ROWS; i++){
+                    a[i] |= b[i];
+                }
+                kernels.countRange(a, LIGHT_SQUARES_BB, 1, 64, match);
+                kernels.countRange(a, ~LIGHT_SQUARES_BB, 1, 64, match);
+                break;
+            case PsRookBehindPawn: {
+                kernels.pieceColumn(block, planeKey(t.team, Pawn), a);
+                kernels.pieceColumn(block, planeKey(t.team, Rook), b);
+                bool red = (t.team == Red);
+                Bitboard seventh = red ? ROW_0_BB << 8 : ROW_0_BB << 48;
+                // Fill from the pawns towards their own side through empty squares, then step once
+                //  more onto the first piece behind them
+                for(int i=0; i < PS_BLOCK_ROWS; i++){
+                    Bitboard empty = ~(block.planes[0][i] | block.planes[1][i] | block.planes[2][i]);
+                    Bitboard fill = a[i] & seventh;
+                    if(red){
+                        fill |= empty & (fill << 8);
+                        empty &= empty << 8;
+                        fill |= empty & (fill << 16);
+                        empty &= empty << 16;
+                        fill |= empty & (fill << 32);
+                        a[i] = (fill << 8) & b[i];
+                    }
+                    else{
+                        fill |= empty & (fill >> 8);
+                        empty &= empty >> 8;
+                        fill |= empty & (fill >> 16);
+                        empty &= empty >> 16;
+                        fill |= empty & (fill >> 32);
+                        a[i] = (fill >> 8) & b[i];
+                    }
+                }
+                kernels.countRange(a, ~EMPTY_BB, 1, 64, match);
+                break;
+            }
+            case PsSideToMove: {
+                uint8_t black = (t.team == Black) ? 1 : 0;
+                for(int i=0; i < PS_BLOCK_ROWS; i++){
+                    match[i] &= (block.black[i] == black) ? 0xFF : 0;
+                }
+                break;
+            }
+        }
+    }
+}
+
+// Scanning ===================================
+
+PatternColumns::PatternColumns(){
+    this->mapped = NULL;
+    this->mappedSize = 0;
+    this->rowCount = 0;
+}
+
+PatternColumns::~PatternColumns(){
+    this->unmap();
+}
+
+/**
+    Map a column file into memory. Replaces any file that was already mapped.
+    @param path Location of the .ccps file
+    @returns nothing. Throws ChessException if the file can't be used.
+*/
+void PatternColumns::map(string path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw ChessException("PatternScan.cpp: Could not open column file");
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        close(fd);
+        throw ChessException("PatternScan.cpp: Could not read column file size");
+    }
+    size_t size = st.st_size;
+    if(size < (size_t) PS_HEADER_SIZE){
+        close(fd);
+        throw ChessException("PatternScan.cpp: Column file is too short");
+    }
+    void* mem = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mem == MAP_FAILED){
+        throw ChessException("PatternScan.cpp: Could not map column file");
+    }
+    const uint8_t* data = (const uint8_t*) mem;
+    uint32_t version, blockRows;
+    uint64_t rows;
+    memcpy(&version, data + 4, sizeof(version));
+    memcpy(&rows, data + 8, sizeof(rows));
+    memcpy(&blockRows, data + 16, sizeof(blockRows));
+    uint64_t blocks = (rows + PS_BLOCK_ROWS - 1) / PS_BLOCK_ROWS;
+    if(memcmp(data, "CCPS", 4) != 0 || version != PS_VERSION || blockRows != PS_BLOCK_ROWS
+        || size != PS_HEADER_SIZE + blocks * PS_BLOCK_SIZE){
+        munmap(mem, size);
+        throw ChessException("PatternScan.cpp: Column file header doesn't match its size");
+    }
+    // Scans read the file from start to end
+    madvise(mem, size, MADV_SEQUENTIAL);
+
+    this->unmap();
+    this->mapped = data;
+    this->mappedSize = size;
+    this->rowCount = rows;
+}
+
+void PatternColumns::unmap(){
+    if(this->mapped != NULL){
+        munmap((void*) this->mapped, this->mappedSize);
+    }
+    this->mapped = NULL;
+    this->mappedSize = 0;
+    this->rowCount = 0;
+}
+
+uint64_t PatternColumns::getRowCount(){
+    return this->rowCount;
+}
+
+uint64_t PatternColumns::getBlockCount(){
+    return (this->rowCount + PS_BLOCK_ROWS - 1) / PS_BLOCK_ROWS;
+}
+
+/**
+    @param i Block number, 0 to getBlockCount() - 1
+    @returns The block's columns
+*/
+PsBlock PatternColumns::getBlock(uint64_t i){
+    const uint8_t* data = this->mapped + PS_HEADER_SIZE + i * PS_BLOCK_SIZE;
+    PsBlock block;
+    for(int k=0; k < 4; k++){
+        block.planes[k] = (const uint64_t*) (data + k * PS_BLOCK_ROWS * sizeof(uint64_t));
+    }
+    data += 4 * PS_BLOCK_ROWS * sizeof(uint64_t);
+    block.game = (const uint32_t*) data;
+    block.ply = (const uint16_t*) (data + PS_BLOCK_ROWS * sizeof(uint32_t));
+    block.black = data + PS_BLOCK_ROWS * (sizeof(uint32_t) + sizeof(uint16_t));
+    block.rows = (int) min((uint64_t) PS_BLOCK_ROWS, this->rowCount - i * PS_BLOCK_ROWS);
+    return block;
+}
+
+/**
+    Test every row against a query. Threads take blocks one at a time.
+    @param query Query to run
+    @param threadCount Number of threads to scan with
+    @param matches Set to the first matching rows, in archive order
+    @param maxMatches Most matches to return in 'matches'
+    @returns Number of matching rows
+*/
+uint64_t PatternColumns::scan(PatternQuery& query, int threadCount, vector<PsMatch>& matches, size_t maxMatches){
+    atomic<uint64_t> nextBlock(0);
+    atomic<uint64_t> total(0);
+    mutex lock;
+    matches.clear();
+    auto work = [this, &query, &nextBlock, &total, &lock, &matches, maxMatches](){
+        vector<uint8_t> match(PS_BLOCK_ROWS);
+        vector<uint64_t> a(PS_BLOCK_ROWS), b(PS_BLOCK_ROWS);
+        // Blocks are taken in order, so a thread's first matches are the only ones that can be among
+        //  the first overall
+        vector<PsMatch> found;
+        uint64_t count = 0;
+        for(uint64_t i = nextBlock++; i < this->getBlockCount(); i = nextBlock++){
+            PsBlock block = this->getBlock(i);
+            query.evaluate(block, match.data(), a.data(), b.data());
+            for(int row=0; row < block.rows; row++){
+                if(match[row]){
+                    count++;
+                    if(found.size() < maxMatches){
+                        found.push_back(PsMatch{block.game[row], block.ply[row]});
+                    }
+                }
+            }
+        }
+        total += count;
+        lock_guard<mutex> guard(lock);
+        matches.insert(matches.end(), found.begin(), found.end());
+    };
+
+    vector<thread> threads;
+    for(int t=1; t < threadCount; t++){
+        threads.emplace_back(work);
+    }
+    work();
+    for(thread& t : threads){
+        t.join();
+    }
+    sort(matches.begin(), matches.end(), [](const PsMatch& x, const PsMatch& y){
+        return (x.game != y.game) ? x.game < y.game : x.ply < y.ply;
+    });
+    if(matches.size() > maxMatches){
+        matches.resize(maxMatches);
+    }
+    return total;
+}
+
+/**
+    Static method
+    @returns Name of the instruction set the query kernels use
+*/
+const char* PatternColumns::getKernelName(){
+    return kernels.name;
+}
+
+// Writing ===================================
+
+PatternColumnsWriter::PatternColumnsWriter(){
+    this->blockRows = 0;
+    this->rows = 0;
+}
+
+/**
+    Create a column file. The header is only complete after close().
+    @param path Location of the .ccps file
+    @returns nothing. Throws ChessException if the file can't be created.
+*/
+void PatternColumnsWriter::open(string path){
+    this->out.open(path, ios::binary | ios::trunc);
+    if(!this->out){
+        throw ChessException("PatternScan.cpp: Could not create column file");
+    }
+    char header[PS_HEADER_SIZE] = { 0 };
+    this->out.write(header, PS_HEADER_SIZE);
+    this->block.assign(PS_BLOCK_SIZE, 0);
+    this->blockRows = 0;
+    this->rows = 0;
+}
+
+/**
+    Add a row
+    @param pos The position
+    @param game Game number in the archive
+    @param ply Plies played before the position was reached
+    @returns nothing
+*/
+void PatternColumnsWriter::add(Position& pos, uint32_t game, uint16_t ply){
+    uint64_t planes[4] = { 0, 0, 0, pos.getPieces(Black) };
+    for(int pt = King; pt <= Pawn; pt++){
+        Bitboard pieces = pos.getPieces((PieceType) pt);
+        for(int k=0; k < 3; k++){
+            if((pt >> k) & 1){
+                planes[k] |= pieces;
+            }
+        }
+    }
+    uint8_t* data = this->block.data();
+    int row = this->blockRows;
+    for(int k=0; k < 4; k++){
+        memcpy(data + (k * PS_BLOCK_ROWS + row) * sizeof(uint64_t), &planes[k], sizeof(uint64_t));
+    }
+    data += 4 * PS_BLOCK_ROWS * sizeof(uint64_t);
+    memcpy(data + row * sizeof(uint32_t), &game, sizeof(game));
+    memcpy(data + PS_BLOCK_ROWS * sizeof(uint32_t) + row * sizeof(uint16_t), &ply, sizeof(ply));
+    data[PS_BLOCK_ROWS * (sizeof(uint32_t) + sizeof(uint16_t)) + row] = (pos.getSideToMove() == Black) ? 1 : 0;
+
+    this->rows++;
+    if(++this->blockRows == PS_BLOCK_ROWS){
+        this->flush();
+    }
+}
+
+/**
+    Write the last block and the header
+    @returns Number of rows written. Throws ChessException if the file can't be written.
+*/
+uint64_t PatternColumnsWriter::close(){
+    if(this->blockRows > 0){
+        this->flush();
+    }
+    char header[PS_HEADER_SIZE] = { 0 };
+    uint32_t version = PS_VERSION;
+    uint32_t blockRows = PS_BLOCK_ROWS;
+    memcpy(header, "CCPS", 4);
+    memcpy(header + 4, &version, sizeof(version));
+    memcpy(header + 8, &this->rows, sizeof(this->rows));
+    memcpy(header + 16, &blockRows, sizeof(blockRows));
+    this->out.seekp(0);
+    this->out.write(header, PS_HEADER_SIZE);
+    this->out.close();
+    if(this->out.fail()){
+        throw ChessException("PatternScan.cpp: Could not write column file");
+    }
+    return this->rows;
+}
+
+/*
+    Private method
+    Write the current block, padded with empty rows, and start a new one
+*/
+void PatternColumnsWriter::flush(){
+    this->out.write((const char*) this->block.data(), this->block.size());
+    this->block.assign(PS_BLOCK_SIZE, 0);
+    this->blockRows = 0;
+}
@@ -0,0 +1,129 @@
+#ifndef PatternScan_H
+#define PatternScan_H
+
+#include "Position.hpp"
+#include "Bitboard.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+    Material and pattern search over every position of a game archive.
+
+    Positions are stored in columns, PS_BLOCK_ROWS positions (rows) per block, so a query reads
+     each column it needs as one contiguous array and tests 4 rows per instruction with AVX2. The
+     board of a row is 4 bitboards ("planes"): planes 0-2 hold the bits of the PieceType on each
+     square and plane 3 is set on squares holding a Black piece. Any team and type's pieces are a
+     few ANDs of the planes away.
+
+    File layout (little endian):
+        char     magic[4]           "CCPS"
+        uint32   version            PS_VERSION
+        uint64   rows
+        uint32   blockRows          PS_BLOCK_ROWS
+        uint32   reserved
+        blocks, the last one padded with empty rows:
+            uint64   planes[4][blockRows]
+            uint32   game[blockRows]        game number in the archive
+            uint16   ply[blockRows]         plies played before the position was reached
+            uint8    black[blockRows]       1 if Black is to move
+            uint8    reserved[blockRows]
+    Files are written by PatternColumnsWriter and mapped read-only by PatternColumns.
+*/
+const int PS_VERSION = 1;
+const int PS_HEADER_SIZE = 24;
+const int PS_BLOCK_ROWS = 4096;
+const size_t PS_BLOCK_SIZE = PS_BLOCK_ROWS * (4 * sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint16_t) + 2);
+
+const Bitboard LIGHT_SQUARES_BB = 0xAA55AA55AA55AA55ULL;    // A8 is a light square
+
+/*
+    Columns of one block, pointing into the mapped file
+*/
+struct PsBlock {
+    const uint64_t* planes[4];
+    const uint32_t* game;
+    const uint16_t* ply;
+    const uint8_t* black;
+    int rows;       // rows in use. Only the last block has fewer than PS_BLOCK_ROWS.
+};
+
+struct PsMatch {
+    uint32_t game;
+    uint16_t ply;
+};
+
+enum PsTermKind {
+    PsMaterial,         // number of a team's pieces of a type, e.g. "wB>=2"
+    PsBishopPair,       // a team has bishops on both square colors
+    PsRookBehindPawn,   // a team has a pawn on its 7th rank with its own rook behind it on the file
+    PsOppositeBishops,  // each team has one bishop, on different square colors
+    PsSideToMove        // "stm=w" or "stm=b"
+};
+
+struct PsTerm {
+    PsTermKind kind;
+    TeamColor team;
+    PieceType type;
+    int low;            // PsMaterial: the count must be in [low, high]
+    int high;
+};
+
+/*
+    All of a query's terms have to hold for a position to match.
+    Terms are separated by spaces:
+        <team><piece><op><n>    material, e.g. "wB>=2". team is w or b, piece is one of KQRBNP and
+                                 op is one of = < > <= >=
+        <team>:bishop-pair
+        <team>:rook-behind-7th-pawn
+        opposite-bishops
+        stm=<team>              team to move
+    e.g. "wB>=2 wN=0 bN>=2 bB=0" is White's bishop pair against Black's knight pair.
+*/
+class PatternQuery {
+    vector<PsTerm> terms;
+
+    public:
+        void parse(string);
+        void evaluate(const PsBlock&, uint8_t*, uint64_t*, uint64_t*);
+        int getTermCount();
+};
+
+class PatternColumns {
+    const uint8_t* mapped;
+    size_t mappedSize;
+    uint64_t rowCount;
+
+    public:
+        PatternColumns();
+        ~PatternColumns();
+        void map(string);
+        void unmap();
+        uint64_t getRowCount();
+        uint64_t getBlockCount();
+        PsBlock getBlock(uint64_t);
+        uint64_t scan(PatternQuery&, int, vector<PsMatch>&, size_t);
+        static const char* getKernelName();
+};
+
+class PatternColumnsWriter {
+    ofstream out;
+    vector<uint8_t> block;
+    int blockRows;      // rows written to the current block
+    uint64_t rows;
+
+    public:
+        PatternColumnsWriter();
+        void open(string);
+        void add(Position&, uint32_t, uint16_t);
+        uint64_t close();
+
+    private:
+        void flush();
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "PawnTable.hpp"
+#include "Position.hpp"
+#include "Bitboard.hpp"
+#include "Evaluation.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+/**
+    @param size Number of entries. Rounded down to a power of 2.
+*/
+PawnTable::PawnTable(int size){
+    int entryCount = 1;
+    while(entryCount * 2 <= size){
+        entryCount *= 2;
+    }
+    this->entries.resize(entryCount);
+    this->clear();
+}
+
+PawnTable::~PawnTable() = default;
+
+/*
+    Remove all entries and reset the statistics
+*/
+void PawnTable::clear(){
+    for(PawnEntry& e : this->entries){
+        e.key = 0;
+        e.score = { 0, 0 };
+        e.passed[NoColor] = e.passed[Red] = e.passed[Black] = EMPTY_BB;
+    }
+    // Key 0 is a position without pawns. Empty entries already hold its correct (empty) evaluation.
+    this->resetStats();
+}
+
+/**
+    The pawn table used by the calling thread
+    @returns The thread's PawnTable, created on first use
+*/
+PawnTable& PawnTable::local(){
+    thread_local PawnTable table(PAWN_TABLE_ENTRIES);
+    return table;
+}
+
+/**
+    Find the pawn structure evaluation of a Position, calculating and storing it if it is not cached
+    @param pos The Position to look up
+    @returns The entry for the Position's pawns. Valid until the next probe on this table.
+*/
+PawnEntry* PawnTable::probe(Position& pos){
+    uint64_t key = pos.getPawnKey();
+    PawnEntry* entry = &this->entries[key & (this->entries.size() - 1)];
+    this->probes++;
+    if(entry->key == key){
+        this->hits++;
+        return entry;
+    }
+    entry->key = key;
+    entry->score = evaluatePawns(pos, entry->passed);
+    return entry;
+}
+
+/**
+    Evaluate doubled, isolated and passed pawns
+    @param pos The Position to evaluate
+    @param passed Array of 3 Bitboards, indexed by TeamColor, that receives each team's passed pawns
+    @returns Score from Red's point of view
+*/
+Score PawnTable::evaluatePawns(Position& pos, Bitboard* passed){
+    Score total = { 0, 0 };
+    passed[NoColor] = EMPTY_BB;
+    for(int t = Red; t <= Black; t++){
+        TeamColor tc = (TeamColor) t;
+        TeamColor enemy = (tc == Red) ? Black : Red;
+        Bitboard ours = pos.getPieces(tc, Pawn);
+        Bitboard theirs = pos.getPieces(enemy, Pawn);
+        Score teamScore = { 0, 0 };
+        passed[tc] = EMPTY_BB;
+
+        Bitboard pawns = ours;
+        while(pawns){
+            int index = Bitboards::popLsb(pawns);
+            int row = index / 8;
+            int col = index % 8;
+            Direction forward = (tc == Red) ? North : South;
+
+            Bitboard fileBB = FILE_A_BB << col;
+            Bitboard adjacentFiles = EMPTY_BB;
+            if(col > 0) adjacentFiles |= FILE_A_BB << (col - 1);
+            if(col < 7) adjacentFiles |= FILE_A_BB << (col + 1);
+
+            // Squares in front of the pawn on its own and neighbouring files
+            Bitboard front = Bitboards::ray(forward, index);
+            Bitboard span = EMPTY_BB;
+            for(int r=0; r < 8; r++){
+                bool ahead = (tc == Red) ? r < row : r > row;
+                if(ahead){
+                    span |= ROW_0_BB << (8 * r);
+                }
+            }
+            span &= fileBB | adjacentFiles;
+
+            if(front & ours){
+                teamScore += DOUBLED_PAWN;
+            }
+            if(!(adjacentFiles & ours)){
+                teamScore += ISOLATED_PAWN;
+            }
+            // Only the front pawn of a doubled pair can be passed
+            if(!(span & theirs) && !(front & ours)){
+                passed[tc] |= Bitboards::squareBB(index);
+                int rank = (tc == Red) ? 8 - row : row + 1;
+                teamScore += passedPawnBonus[rank - 1];
+            }
+        }
+        if(tc == Red){
+            total += teamScore;
+        }
+        else{
+            total -= teamScore;
+        }
+    }
+    return total;
+}
+
+uint64_t PawnTable::getProbes(){
+    return this->probes;
+}
+
+uint64_t PawnTable::getHits(){
+    return this->hits;
+}
+
+/**
+    @returns Fraction of probes that found a cached entry, 0 if there were no probes
+*/
+double PawnTable::getHitRate(){
+    if(this->probes == 0){
+        return 0;
+    }
+    return (double) this->hits / this->probes;
+}
+
+void PawnTable::resetStats(){
+    this->probes = 0;
+    this->hits = 0;
+}
+
+/*
+    Print the hit rate of this table
+*/
+void PawnTable::printStats(){
+    cout << "Pawn table: " << this->hits << " hits / " << this->probes << " probes (";
+    cout << fixed << setprecision(1) << this->getHitRate() * 100 << "%)" << endl;
+}
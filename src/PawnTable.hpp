@@ -0,0 +1,60 @@
+#ifndef PawnTable_H
+#define PawnTable_H
+
+#include "Bitboard.hpp"
+#include "Evaluation.hpp"
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+class Position;
+
+// Pawn structure terms from Red's point of view. Indexed by the pawn's rank for its own team, 1-8.
+const Score DOUBLED_PAWN = { -11, -51 };
+const Score ISOLATED_PAWN = { -5, -15 };
+const Score passedPawnBonus[8] = {
+    { 0, 0 }, { 0, 0 }, { 10, 28 }, { 17, 33 }, { 15, 41 }, { 62, 72 }, { 168, 177 }, { 276, 260 }
+};
+
+/*
+    Cached pawn structure evaluation for one set of pawns.
+    'passed' holds the passed pawns of each team so later evaluation terms can use them without
+     recalculating.
+*/
+struct PawnEntry {
+    uint64_t key;
+    Score score;            // from Red's point of view
+    Bitboard passed[3];     // [TeamColor]
+};
+
+/*
+    Hash table of pawn structure evaluations, indexed by Position's pawn-only Zobrist key.
+    Pawns move rarely compared to other pieces, so most positions in a search share their pawn
+     structure with positions already evaluated and the result can be looked up instead of recalculated.
+    Each thread has its own table so no locking is needed.
+*/
+class PawnTable {
+    vector<PawnEntry> entries;  // size is a power of 2
+    uint64_t probes;
+    uint64_t hits;
+
+    public:
+        PawnTable(int);
+        ~PawnTable();
+        PawnEntry* probe(Position&);
+        void clear();
+        static PawnTable& local();
+        static Score evaluatePawns(Position&, Bitboard*);
+        // statistics
+        uint64_t getProbes();
+        uint64_t getHits();
+        double getHitRate();
+        void resetStats();
+        void printStats();
+};
+
+const int PAWN_TABLE_ENTRIES = 16384;
+
+#endif
@@ -0,0 +1,413 @@
+#include "Pgn.hpp"
+#include "ChessException.hpp"
+
+#include <vector>
+
+using namespace std;
+
+
+/**
+    @param name Tag name, e.g. "White"
+    @returns The tag's value, or an empty string if the game doesn't have the tag
+*/
+string PgnGame::getTag(string_view name) const {
+    for(auto const& [key, value] : this->tags){
+        if(key == name){
+            return value;
+        }
+    }
+    return "";
+}
+
+/**
+    Set a tag's value, adding the tag at the end if the game doesn't have it yet
+    @param name Tag name
+    @param value New value
+    @returns nothing
+*/
+void PgnGame::setTag(string_view name, string_view value){
+    for(auto& [key, old] : this->tags){
+        if(key == name){
+            old = value;
+            return;
+        }
+    }
+    this->tags.emplace_back(name, value);
+}
+
+
+// Characters that end a move text symbol
+static bool endsSymbol(char c){
+    switch(c){
+        case ' ': case '\t': case '\r': case '\n':
+        case '{': case '}': case '(': case ')': case '[': case ']': case ';':
+            return true;
+        default:
+            return false;
+    }
+}
+
+PgnReader::PgnReader(){
+    this->reset();
+}
+
+/**
+    @param callback Called for every legal move, with the position before the move is made
+*/
+void PgnReader::setMoveCallback(function<void(PgnGame&, Position&, PackedMove)> callback){
+    this->moveCallback = callback;
+}
+
+/**
+    @param callback Called at the end of every game, with the position after its last legal move
+*/
+void PgnReader::setGameCallback(function<void(PgnGame&, Position&)> callback){
+    this->gameCallback = callback;
+}
+
+/**
+    Forget any partly read game and start over at offset 0
+*/
+void PgnReader::reset(){
+    this->state = PgnBetween;
+    this->lineStart = true;
+    this->variationDepth = 0;
+    this->symbolLength = 0;
+    this->tagText.clear();
+    this->offset = 0;
+    this->inGame = false;
+    this->inMoves = false;
+    this->game.tags.clear();
+    this->game.result.clear();
+    this->game.plies = 0;
+    this->game.error.clear();
+    this->game.offset = 0;
+    this->gameCount = 0;
+}
+
+/**
+    Read the next part of the input. Tokens may be split across calls.
+    @param data Next bytes of the input
+    @param length Number of bytes
+    @returns nothing
+*/
+void PgnReader::feed(const char* data, size_t length){
+    for(size_t i=0; i < length; i++, this->offset++){
+        char c = data[i];
+        bool atLineStart = this->lineStart;
+        this->lineStart = (c == '\n');
+        switch(this->state){
+            case PgnSymbol:
+                if( !endsSymbol(c)){
+                    // Overlong symbols are cut off. They can't be moves, so they fail to parse.
+                    if(this->symbolLength < PGN_MAX_SYMBOL){
+                        this->symbol[this->symbolLength++] = c;
+                    }
+                    continue;
+                }
+                this->endSymbol();
+                this->state = PgnBetween;
+                break;  // 'c' still has to be handled
+            case PgnTag:
+                if(c == ']'){
+                    this->endTag();
+                    this->state = PgnBetween;
+                    continue;
+                }
+                if(c == '"'){
+                    this->state = PgnTagString;
+                }
+                if(this->tagText.size() < PGN_MAX_TAG) this->tagText += c;
+                continue;
+            case PgnTagString:
+                if(c == '\\') this->state = PgnTagEscape;
+                else if(c == '"') this->state = PgnTag;
+                if(this->tagText.size() < PGN_MAX_TAG) this->tagText += c;
+                continue;
+            case PgnTagEscape:
+                this->state = PgnTagString;
+                if(this->tagText.size() < PGN_MAX_TAG) this->tagText += c;
+                continue;
+            case PgnBraceComment:
+                if(c == '}') this->state = PgnBetween;
+                continue;
+            case PgnLineComment:
+            case PgnEscapeLine:
+                if(c == '\n') this->state = PgnBetween;
+                continue;
+            case PgnBetween:
+                break;
+        }
+
+        switch(c){
+            case ' ': case '\t': case '\r': case '\n':
+            case ']': case '}':     // stray closing brackets
+                break;
+            case '%':
+                if(atLineStart){
+                    this->state = PgnEscapeLine;
+                    break;
+                }
+                this->beginGame();
+                this->symbolLength = 0;
+                this->symbol[this->symbolLength++] = c;
+                this->state = PgnSymbol;
+                break;
+            case '{':
+                this->state = PgnBraceComment;
+                break;
+            case ';':
+                this->state = PgnLineComment;
+                break;
+            case '(':
+                this->variationDepth++;
+                break;
+            case ')':
+                if(this->variationDepth > 0) this->variationDepth--;
+                break;
+            case '[':
+                // Tags only come before the move text. A game without a result ends here.
+                if(this->inMoves){
+                    this->endGame("*");
+                }
+                this->variationDepth = 0;
+                this->beginGame();
+                this->tagText.clear();
+                this->state = PgnTag;
+                break;
+            default:
+                this->beginGame();
+                this->symbolLength = 0;
+                this->symbol[this->symbolLength++] = c;
+                this->state = PgnSymbol;
+        }
+    }
+}
+
+/**
+    End of the input. A game without a result is reported with the result "*".
+*/
+void PgnReader::finish(){
+    if(this->state == PgnSymbol){
+        this->endSymbol();
+    }
+    this->state = PgnBetween;
+    this->lineStart = true;
+    if(this->inGame){
+        this->endGame("*");
+    }
+}
+
+/**
+    Read a whole stream in PGN_CHUNK_SIZE chunks
+    @param in Stream to read until its end
+    @returns Number of games read
+*/
+uint64_t PgnReader::read(istream& in){
+    vector<char> chunk(PGN_CHUNK_SIZE);
+    uint64_t before = this->gameCount;
+    while(in.read(chunk.data(), chunk.size()) || in.gcount() > 0){
+        this->feed(chunk.data(), (size_t) in.gcount());
+    }
+    this->finish();
+    return this->gameCount - before;
+}
+
+uint64_t PgnReader::getGameCount(){
+    return this->gameCount;
+}
+
+/*
+    Private method
+    The first tag or symbol of a game was found
+*/
+void PgnReader::beginGame(){
+    if( !this->inGame){
+        this->inGame = true;
+        this->game.offset = this->offset;
+    }
+}
+
+/*
+    Private method
+    Handle a complete move text symbol: a result, a move number, a NAG or a move
+*/
+void PgnReader::endSymbol(){
+    string_view token(this->symbol, this->symbolLength);
+    this->symbolLength = 0;
+    if(this->variationDepth > 0 || token.empty()){
+        return;
+    }
+    if(token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*"){
+        this->endGame(token);
+        return;
+    }
+    if(token[0] == '$'){
+        return;
+    }
+    // Move numbers are "12.", "12..." or glued to the move as in "12.e4". "0-0" is castling.
+    size_t digits = 0;
+    while(digits < token.size() && token[digits] >= '0' && token[digits] <= '9'){
+        digits++;
+    }
+    if(digits == token.size()){
+        return;
+    }
+    if(token[digits] == '.'){
+        token.remove_prefix(digits);
+    }
+    while( !token.empty() && token[0] == '.'){
+        token.remove_prefix(1);
+    }
+    if(token.empty()){
+        return;
+    }
+
+    if( !this->inMoves){
+        this->startMoves();
+    }
+    if( !this->game.error.empty()){
+        return;
+    }
+    PackedMove m = this->pos.parseSan(token);
+    if(m == NULL_MOVE){
+        this->game.error = "Illegal or ambiguous move " + string(token) + " at ply " + to_string(this->game.plies + 1);
+        return;
+    }
+    if(this->moveCallback){
+        this->moveCallback(this->game, this->pos, m);
+    }
+    this->pos.makeMove(m);
+    this->game.plies++;
+}
+
+/*
+    Private method
+    Split the text between '[' and ']' into a tag name and its unescaped value
+*/
+void PgnReader::endTag(){
+    const string& text = this->tagText;
+    size_t i = 0;
+    while(i < text.size() && (text[i] == ' ' || text[i] == '\t')) i++;
+    size_t nameStart = i;
+    while(i < text.size() && text[i] != ' ' && text[i] != '\t' && text[i] != '"') i++;
+    if(i == nameStart){
+        return;
+    }
+    string name = text.substr(nameStart, i - nameStart);
+    string value;
+    i = text.find('"', i);
+    if(i != string::npos){
+        for(i++; i < text.size() && text[i] != '"'; i++){
+            if(text[i] == '\\' && i + 1 < text.size()){
+                i++;
+            }
+            value += text[i];
+        }
+    }
+    this->game.tags.emplace_back(std::move(name), std::move(value));
+}
+
+/*
+    Private method
+    The first move of a game was found. Set up the position it starts from.
+*/
+void PgnReader::startMoves(){
+    this->inMoves = true;
+    string fen = this->game.getTag("FEN");
+    try{
+        this->pos.loadFen(fen.empty() ? START_FEN : fen);
+    }
+    catch(const ChessException &ex){
+        this->game.error = ex.what();
+        this->pos.loadFen(START_FEN);
+    }
+}
+
+/*
+    Private method
+    Report the game and get ready for the next one
+*/
+void PgnReader::endGame(string_view result){
+    if( !this->inMoves){
+        this->startMoves();
+    }
+    this->game.result = result;
+    this->gameCount++;
+    if(this->gameCallback){
+        this->gameCallback(this->game, this->pos);
+    }
+    this->game.tags.clear();
+    this->game.result.clear();
+    this->game.plies = 0;
+    this->game.error.clear();
+    this->variationDepth = 0;
+    this->inGame = false;
+    this->inMoves = false;
+}
+
+
+/**
+    Static method
+    Write one game. The moves are replayed from the game's FEN tag, or from the standard starting
+     position if it has none, to write them in Standard Algebraic Notation.
+    @param out Stream to write to
+    @param game Tags and result of the game. Tags are written in order, so the Seven Tag Roster
+        should come first.
+    @param moves Legal moves of the game
+    @returns nothing
+    @throws ChessException if the FEN tag can't be parsed
+*/
+void PgnWriter::writeGame(ostream& out, const PgnGame& game, const vector<PackedMove>& moves){
+    for(auto const& [name, value] : game.tags){
+        out << '[' << name << " \"" << escapeTag(value) << "\"]\n";
+    }
+    out << '\n';
+
+    Position pos;
+    string fen = game.getTag("FEN");
+    pos.loadFen(fen.empty() ? START_FEN : fen);
+    string line;
+    auto add = [&out, &line](const string& word){
+        if( !line.empty() && line.size() + 1 + word.size() > (size_t) PGN_LINE_LENGTH){
+            out << line << '\n';
+            line.clear();
+        }
+        if( !line.empty()){
+            line += ' ';
+        }
+        line += word;
+    };
+    int moveNumber = pos.getTurnCount() / 2 + 1;
+    for(size_t i=0; i < moves.size(); i++){
+        if(pos.getSideToMove() == Red){
+            add(to_string(moveNumber) + ".");
+        }
+        else if(i == 0){
+            add(to_string(moveNumber) + "...");
+        }
+        add(pos.moveToSan(moves[i]));
+        pos.makeMove(moves[i]);
+        if(pos.getSideToMove() == Red){
+            moveNumber++;
+        }
+    }
+    add(game.result.empty() ? "*" : game.result);
+    out << line << "\n\n";
+}
+
+/**
+    Static method
+    @param value A tag value
+    @returns The value with '\' and '"' escaped
+*/
+string PgnWriter::escapeTag(string_view value){
+    string escaped;
+    for(char c : value){
+        if(c == '\\' || c == '"'){
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
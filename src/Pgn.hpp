@@ -0,0 +1,100 @@
+#ifndef Pgn_H
+#define Pgn_H
+
+#include "Position.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+const size_t PGN_CHUNK_SIZE = 64 * 1024;   // bytes read from a stream at a time
+const int PGN_MAX_SYMBOL = 64;              // longer move text symbols are cut off, and fail to parse as moves
+const size_t PGN_MAX_TAG = 4096;            // longer tag pairs are cut off
+const int PGN_LINE_LENGTH = 80;             // the writer wraps move text at this column
+
+/*
+    One game of a PGN file, without its moves. Moves are handed to the reader's move callback one at
+     a time, so a game never has to be held in memory.
+*/
+struct PgnGame {
+    vector<pair<string, string>> tags;  // tag pairs in the order they appear
+    string result;                      // game termination marker: "1-0", "0-1", "1/2-1/2" or "*"
+    int plies;                          // moves replayed
+    string error;                       // first problem found in the game. Empty if every move was legal.
+    uint64_t offset;                    // byte offset of the game's first character in the input
+
+    string getTag(string_view) const;
+    void setTag(string_view, string_view);
+};
+
+/*
+    Streaming Portable Game Notation reader.
+    Input is fed in chunks of any size and split into tokens by a state machine that keeps its state
+     between chunks, so files of any size are read with a fixed amount of memory. Each move is
+     resolved against the legal move generator and handed to the move callback, along with the
+     position it is played in. The game callback gets every game once its result is read.
+    Comments, NAGs, variations and '%' escape lines are skipped. A game that starts with a FEN tag
+     is replayed from that position. After an illegal move, the rest of the game is skipped and
+     PgnGame::error says why.
+*/
+class PgnReader {
+    enum PgnState {
+        PgnBetween,         // between tokens
+        PgnSymbol,          // move, move number, NAG or result
+        PgnTag,             // inside [ ]
+        PgnTagString,       // inside the quotes of a tag value
+        PgnTagEscape,       // after a backslash in a tag value
+        PgnBraceComment,    // inside { }
+        PgnLineComment,     // after ';' until the end of the line
+        PgnEscapeLine       // line starting with '%'
+    };
+
+    PgnState state;
+    bool lineStart;             // no characters read yet on this line
+    int variationDepth;         // number of unclosed '('
+    char symbol[PGN_MAX_SYMBOL];
+    int symbolLength;
+    string tagText;             // text between '[' and ']'
+    uint64_t offset;            // bytes fed so far
+    bool inGame;                // a tag or move of the current game has been read
+    bool inMoves;               // the current game's move text has started
+    PgnGame game;
+    Position pos;
+    uint64_t gameCount;
+    function<void(PgnGame&, Position&, PackedMove)> moveCallback;
+    function<void(PgnGame&, Position&)> gameCallback;
+
+    public:
+        PgnReader();
+        void setMoveCallback(function<void(PgnGame&, Position&, PackedMove)>);
+        void setGameCallback(function<void(PgnGame&, Position&)>);
+        void feed(const char*, size_t);
+        void finish();
+        uint64_t read(istream&);
+        void reset();
+        uint64_t getGameCount();
+
+    private:
+        void beginGame();
+        void endSymbol();
+        void endTag();
+        void startMoves();
+        void endGame(string_view);
+};
+
+/*
+    Portable Game Notation writer
+*/
+class PgnWriter {
+    public:
+        static void writeGame(ostream&, const PgnGame&, const vector<PackedMove>&);
+        static string escapeTag(string_view);
+};
+
+#endif
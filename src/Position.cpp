@@ -0,0 +1,949 @@
+#include "Position.hpp"
+#include "Bitboard.hpp"
+#include "Nnue.hpp"
+#include "Board.hpp"
+#include "Piece.hpp"
+#include "ChessException.hpp"
+#include "StateFactory.hpp"
+#include "Debug.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+
+Position::Position(){
+    this->clear();
+}
+
+/**
+    Build a Position that mirrors a Board
+    @param board The Board to copy pieces from
+    @param turn The team whose turn it is
+*/
+Position::Position(Board* board, TeamColor turn){
+    this->load(board, turn);
+}
+
+Position::~Position() = default;
+
+/*
+    Remove all pieces and reset all state
+*/
+void Position::clear(){
+    for(int i=0; i < 3; i++){
+        this->teamBB[i] = EMPTY_BB;
+    }
+    for(int i=0; i < 7; i++){
+        this->typeBB[i] = EMPTY_BB;
+    }
+    for(int i=0; i < 64; i++){
+        this->squareTeam[i] = NoColor;
+        this->squareType[i] = NoPiece;
+    }
+    this->sideToMove = Red;
+    this->enPassantIndex = -1;
+    this->castlingRights = 0;
+    this->halfmoveClock = 0;
+    this->turnCount = 0;
+    this->psqScore = { 0, 0 };
+    this->phase = 0;
+    this->history.clear();
+    this->accumulator.computed[0] = false;
+    this->accumulator.computed[1] = false;
+    this->key = 0;
+    this->pawnKey = 0;
+}
+
+/**
+    Copy the pieces of a Board into this Position
+    @param board The Board to copy pieces from
+    @param turn The team whose turn it is
+    @returns nothing
+*/
+void Position::load(Board* board, TeamColor turn){
+    this->clear();
+    this->setSideToMove(turn);
+    this->turnCount = board->getTurnCount();
+    TeamColor opponent = (turn == Red) ? Black : Red;
+    for(int i=0; i < 64; i++){
+        Piece p = board->getPiece(i);
+        if(p.getNull()){
+            continue;
+        }
+        this->putPiece(i, p.getTeam(), p.getType());
+        // A pawn marked for En Passant can only be captured by the opponent on the turn right after it moved
+        if(p.getType() == Pawn && p.getEnPassantCapture() && p.getTeam() == opponent){
+            this->setEnPassantIndex((opponent == Black) ? i - 8 : i + 8);
+        }
+    }
+    // Board has no castling flags. A king or rook that has never moved can still castle.
+    auto unmoved = [board](int index, TeamColor tc, PieceType pt) -> bool {
+        Piece p = board->getPiece(index);
+        return p.getTeam() == tc && p.getType() == pt && p.getNumMoves() == 0;
+    };
+    int rights = 0;
+    if(unmoved(60, Red, King)){
+        if(unmoved(63, Red, Rook)) rights |= RED_KINGSIDE;
+        if(unmoved(56, Red, Rook)) rights |= RED_QUEENSIDE;
+    }
+    if(unmoved(4, Black, King)){
+        if(unmoved(7, Black, Rook)) rights |= BLACK_KINGSIDE;
+        if(unmoved(0, Black, Rook)) rights |= BLACK_QUEENSIDE;
+    }
+    this->setCastlingRights(rights);
+}
+
+/**
+    Set up a position from Forsyth-Edwards Notation. Red plays the white pieces (upper case).
+    @param fen The FEN record. The move counters may be left out.
+    @returns nothing
+    @throws ChessException if the record can't be parsed
+*/
+void Position::loadFen(string_view fen){
+    FenRecord record;
+    StateFactory::parseFen(fen, record);
+
+    this->clear();
+    for(int i=0; i < 64; i++){
+        if(record.squareType[i] != NoPiece){
+            this->putPiece(i, record.squareTeam[i], record.squareType[i]);
+        }
+    }
+    if(Bitboards::popCount(this->getPieces(Red, King)) != 1 || Bitboards::popCount(this->getPieces(Black, King)) != 1){
+        throw ChessException("Position.cpp: FEN doesn't describe a legal board: " + string(fen));
+    }
+    this->setSideToMove(record.turn);
+
+    // Drop rights the pieces on the board can't have
+    int rights = record.castlingRights;
+    if(this->getType(60) != King || this->getTeam(60) != Red) rights &= ~(RED_KINGSIDE | RED_QUEENSIDE);
+    if(this->getType(63) != Rook || this->getTeam(63) != Red) rights &= ~RED_KINGSIDE;
+    if(this->getType(56) != Rook || this->getTeam(56) != Red) rights &= ~RED_QUEENSIDE;
+    if(this->getType(4) != King || this->getTeam(4) != Black) rights &= ~(BLACK_KINGSIDE | BLACK_QUEENSIDE);
+    if(this->getType(7) != Rook || this->getTeam(7) != Black) rights &= ~BLACK_KINGSIDE;
+    if(this->getType(0) != Rook || this->getTeam(0) != Black) rights &= ~BLACK_QUEENSIDE;
+    this->setCastlingRights(rights);
+
+    // Like makeMove, only keep an En Passant square that a pawn can actually capture on
+    int ep = record.enPassantIndex;
+    if(ep >= 0 && ep / 8 == ((this->sideToMove == Red) ? 2 : 5)){
+        TeamColor us = this->sideToMove;
+        TeamColor them = (us == Red) ? Black : Red;
+        if(Bitboards::pawnAttacks(them, ep) & this->getPieces(us, Pawn)){
+            this->setEnPassantIndex(ep);
+        }
+    }
+    this->setHalfmoveClock(record.halfmoveClock);
+    this->setTurnCount(max(0, 2 * (record.fullmoveNumber - 1) + (this->sideToMove == Black)));
+}
+
+/**
+    @returns This position in Forsyth-Edwards Notation
+*/
+string Position::toFen(){
+    FenRecord record;
+    for(int i=0; i < 64; i++){
+        record.squareTeam[i] = this->squareTeam[i];
+        record.squareType[i] = this->squareType[i];
+    }
+    record.turn = this->sideToMove;
+    record.castlingRights = this->castlingRights;
+    record.enPassantIndex = this->enPassantIndex;
+    record.halfmoveClock = this->halfmoveClock;
+    record.fullmoveNumber = this->turnCount / 2 + 1;
+    return StateFactory::toFen(record);
+}
+
+void Position::putPiece(int index, TeamColor tc, PieceType pt){
+    Bitboard b = Bitboards::squareBB(index);
+    this->teamBB[tc] |= b;
+    this->typeBB[pt] |= b;
+    this->squareTeam[index] = tc;
+    this->squareType[index] = pt;
+    this->psqScore += PSQ_TABLES.psq[tc][pt][index];
+    this->phase += phaseWeight[pt];
+    this->key ^= ZOBRIST_KEYS.pieces[tc][pt][index];
+    if(pt == Pawn){
+        this->pawnKey ^= ZOBRIST_KEYS.pieces[tc][pt][index];
+    }
+    if(Nnue::isLoaded()){
+        this->updateAccumulator(index, tc, pt, true);
+    }
+}
+
+void Position::removePiece(int index){
+    Bitboard b = Bitboards::squareBB(index);
+    TeamColor tc = this->squareTeam[index];
+    PieceType pt = this->squareType[index];
+    this->teamBB[tc] &= ~b;
+    this->typeBB[pt] &= ~b;
+    this->squareTeam[index] = NoColor;
+    this->squareType[index] = NoPiece;
+    this->psqScore -= PSQ_TABLES.psq[tc][pt][index];
+    this->phase -= phaseWeight[pt];
+    this->key ^= ZOBRIST_KEYS.pieces[tc][pt][index];
+    if(pt == Pawn){
+        this->pawnKey ^= ZOBRIST_KEYS.pieces[tc][pt][index];
+    }
+    if(Nnue::isLoaded()){
+        this->updateAccumulator(index, tc, pt, false);
+    }
+}
+
+/*
+    Private method
+    Add or remove one piece from both NNUE accumulator halves. A king changes every feature of its
+     own perspective, so that half is marked for a full refresh instead.
+*/
+void Position::updateAccumulator(int index, TeamColor tc, PieceType pt, bool add){
+    if(pt == King){
+        this->accumulator.computed[tc - 1] = false;
+        return;
+    }
+    for(int perspective = Red; perspective <= Black; perspective++){
+        if( !this->accumulator.computed[perspective - 1]){
+            continue;
+        }
+        int king = this->getKingIndex((TeamColor) perspective);
+        if(king == -1){
+            this->accumulator.computed[perspective - 1] = false;
+            continue;
+        }
+        int feature = Nnue::featureIndex((TeamColor) perspective, king, tc, pt, index);
+        if(add){
+            Nnue::addFeature(this->accumulator, (TeamColor) perspective, feature);
+        }
+        else{
+            Nnue::removeFeature(this->accumulator, (TeamColor) perspective, feature);
+        }
+    }
+}
+
+/*
+    Private method
+    Move a piece to an empty square
+*/
+void Position::movePiece(int src, int dest){
+    TeamColor tc = this->squareTeam[src];
+    PieceType pt = this->squareType[src];
+    this->removePiece(src);
+    this->putPiece(dest, tc, pt);
+}
+
+/**
+    Execute a move without any error checking. The move must come from generateLegalMoves().
+    All incremental state (bitboards, piece-square score, phase) is updated here.
+    @param m The move to make
+    @returns nothing
+*/
+void Position::makeMove(PackedMove m){
+    int src = moveSource(m);
+    int dest = moveDest(m);
+    SpecialMove special = moveSpecial(m);
+    TeamColor us = this->sideToMove;
+    TeamColor them = (us == Red) ? Black : Red;
+    PieceType pt = this->squareType[src];
+
+    UndoState undo = { m, NoPiece, this->castlingRights, this->enPassantIndex, this->halfmoveClock, this->key, this->pawnKey };
+    this->halfmoveClock++;
+
+    if(special == EnPassant){
+        undo.captured = Pawn;
+        this->removePiece((us == Red) ? dest + 8 : dest - 8);
+    }
+    else if(this->squareTeam[dest] != NoColor){
+        undo.captured = this->squareType[dest];
+        this->removePiece(dest);
+    }
+    this->movePiece(src, dest);
+
+    if(special == PawnPromo){
+        this->removePiece(dest);
+        this->putPiece(dest, us, movePromotion(m));
+    }
+    else if(special == Castling){
+        // The king moves 2 squares. The rook ends up on the square the king passed over.
+        if(dest > src){
+            this->movePiece(src + 3, src + 1);
+        }
+        else{
+            this->movePiece(src - 4, src - 1);
+        }
+    }
+
+    if(pt == Pawn || undo.captured != NoPiece){
+        this->halfmoveClock = 0;
+    }
+    // Only record the En Passant square when an opponent pawn can actually capture onto it
+    this->setEnPassantIndex(-1);
+    if(pt == Pawn && abs(dest - src) == 16){
+        int passed = (src + dest) / 2;
+        if(Bitboards::pawnAttacks(us, passed) & this->getPieces(them, Pawn)){
+            this->setEnPassantIndex(passed);
+        }
+    }
+    // A king or rook leaving (or a rook being captured on) its starting square removes castling rights
+    auto castleMask = [](int index) -> int {
+        switch(index){
+            case(60): return ~(RED_KINGSIDE | RED_QUEENSIDE);
+            case(63): return ~RED_KINGSIDE;
+            case(56): return ~RED_QUEENSIDE;
+            case(4): return ~(BLACK_KINGSIDE | BLACK_QUEENSIDE);
+            case(7): return ~BLACK_KINGSIDE;
+            case(0): return ~BLACK_QUEENSIDE;
+            default: return ALL_CASTLING;
+        }
+    };
+    this->setCastlingRights(this->castlingRights & castleMask(src) & castleMask(dest));
+
+    this->setSideToMove(them);
+    this->turnCount++;
+    this->history.push_back(undo);
+}
+
+/**
+    Take back the last move made with makeMove()
+    @returns nothing
+*/
+void Position::unmakeMove(){
+    if(this->history.empty()){
+        throw ChessException("Position.cpp: unmakeMove(): No move to take back");
+    }
+    UndoState undo = this->history.back();
+    this->history.pop_back();
+
+    PackedMove m = undo.move;
+    int src = moveSource(m);
+    int dest = moveDest(m);
+    SpecialMove special = moveSpecial(m);
+    TeamColor them = this->sideToMove;
+    TeamColor us = (them == Red) ? Black : Red;
+
+    if(special == Castling){
+        if(dest > src){
+            this->movePiece(src + 1, src + 3);
+        }
+        else{
+            this->movePiece(src - 1, src - 4);
+        }
+    }
+    else if(special == PawnPromo){
+        this->removePiece(dest);
+        this->putPiece(dest, us, Pawn);
+    }
+    this->movePiece(dest, src);
+    if(undo.captured != NoPiece){
+        if(special == EnPassant){
+            this->putPiece((us == Red) ? dest + 8 : dest - 8, them, Pawn);
+        }
+        else{
+            this->putPiece(dest, them, undo.captured);
+        }
+    }
+
+    this->castlingRights = undo.castlingRights;
+    this->enPassantIndex = undo.enPassantIndex;
+    this->halfmoveClock = undo.halfmoveClock;
+    this->sideToMove = us;
+    this->turnCount--;
+    this->key = undo.key;
+    this->pawnKey = undo.pawnKey;
+}
+
+// Calculations ===================================
+
+/**
+    Find every piece, of both teams, that attacks a square
+    @param index The square being attacked
+    @param occupied Squares treated as occupied. Sliding attacks stop at these squares.
+    @returns Bitboard of all attacking pieces
+*/
+Bitboard Position::attackersTo(int index, Bitboard occupied){
+    Bitboard rooks = this->typeBB[Rook] | this->typeBB[Queen];
+    Bitboard bishops = this->typeBB[Bishop] | this->typeBB[Queen];
+    // A Red pawn attacks 'index' from the squares a Black pawn on 'index' would attack, and vice versa
+    return (Bitboards::pawnAttacks(Black, index) & this->teamBB[Red] & this->typeBB[Pawn])
+         | (Bitboards::pawnAttacks(Red, index) & this->teamBB[Black] & this->typeBB[Pawn])
+         | (Bitboards::knightAttacks(index) & this->typeBB[Knight])
+         | (Bitboards::kingAttacks(index) & this->typeBB[King])
+         | (Bitboards::rookAttacks(index, occupied) & rooks)
+         | (Bitboards::bishopAttacks(index, occupied) & bishops);
+}
+
+/**
+    @param index The square to examine
+    @param by The attacking team
+    @returns True if any piece of team 'by' attacks the square
+*/
+bool Position::isAttacked(int index, TeamColor by){
+    return (this->attackersTo(index, this->getOccupied()) & this->teamBB[by]) != EMPTY_BB;
+}
+
+// True if the king of the team to move is attacked
+bool Position::inCheck(){
+    int king = this->getKingIndex(this->sideToMove);
+    return king != -1 && this->isAttacked(king, (this->sideToMove == Red) ? Black : Red);
+}
+
+/**
+    Draw by the 50 move rule, or by repetition. A single repetition of a position since the last
+     capture or pawn move counts, since the team that could avoid it would already have done so.
+    @returns true if the position is a draw
+*/
+bool Position::isDraw(){
+    if(this->halfmoveClock >= 100){
+        return true;
+    }
+    int size = this->history.size();
+    // Only positions with the same team to move can repeat
+    for(int i=2; i <= this->halfmoveClock && i <= size; i += 2){
+        if(this->history[size - i].key == this->key){
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+    Generate all pseudo-legal moves for the team to move. Moves may leave the king in check, use
+     isLegal() or generateLegalMoves() to remove them.
+    @param list The list to add moves to
+    @returns nothing
+*/
+void Position::generateMoves(MoveList& list){
+    TeamColor us = this->sideToMove;
+    TeamColor them = (us == Red) ? Black : Red;
+    Bitboard occupied = this->getOccupied();
+    Bitboard targets = ~this->teamBB[us];   // empty squares and opponent pieces
+
+    // Pawns
+    int push = (us == Red) ? -8 : 8;
+    Bitboard startRow = (us == Red) ? (ROW_7_BB >> 8) : (ROW_0_BB << 8);
+    Bitboard pawns = this->getPieces(us, Pawn);
+    while(pawns){
+        int src = Bitboards::popLsb(pawns);
+        int one = src + push;
+        if( !(occupied & Bitboards::squareBB(one))){
+            this->addPawnMoves(list, src, one);
+            int two = one + push;
+            if((startRow & Bitboards::squareBB(src)) && !(occupied & Bitboards::squareBB(two))){
+                list.add(packMove(src, two));
+            }
+        }
+        Bitboard captures = Bitboards::pawnAttacks(us, src) & this->teamBB[them];
+        while(captures){
+            this->addPawnMoves(list, src, Bitboards::popLsb(captures));
+        }
+        if(this->enPassantIndex != -1 && (Bitboards::pawnAttacks(us, src) & Bitboards::squareBB(this->enPassantIndex))){
+            list.add(packMove(src, this->enPassantIndex, EnPassant));
+        }
+    }
+
+    // Pieces
+    for(int pt = King; pt < Pawn; pt++){
+        Bitboard pieces = this->getPieces(us, (PieceType) pt);
+        while(pieces){
+            int src = Bitboards::popLsb(pieces);
+            Bitboard moves = Bitboards::attacks((PieceType) pt, us, src, occupied) & targets;
+            while(moves){
+                list.add(packMove(src, Bitboards::popLsb(moves)));
+            }
+        }
+    }
+
+    this->addCastlingMoves(list);
+}
+
+/**
+    Generate all legal moves for the team to move
+    @param list The list to add moves to
+    @returns nothing
+*/
+void Position::generateLegalMoves(MoveList& list){
+    MoveList pseudo;
+    this->generateMoves(pseudo);
+    for(int i=0; i < pseudo.size; i++){
+        if(this->isLegal(pseudo.moves[i])){
+            list.add(pseudo.moves[i]);
+        }
+    }
+}
+
+/**
+    Check that a pseudo-legal move doesn't leave the moving team's king in check. The board after
+     the move is simulated with bitboards only, so the Position isn't changed.
+    @param m A move from generateMoves()
+    @returns True if the move is legal
+*/
+bool Position::isLegal(PackedMove m){
+    TeamColor us = this->sideToMove;
+    TeamColor them = (us == Red) ? Black : Red;
+    int src = moveSource(m);
+    int dest = moveDest(m);
+    int king = this->getKingIndex(us);
+    if(king == -1){
+        return true;    // debug positions without a king can't be in check
+    }
+    // Castling moves are only generated when the king doesn't pass through check
+    if(moveSpecial(m) == Castling){
+        return true;
+    }
+    Bitboard captured = Bitboards::squareBB(dest);
+    Bitboard occupied = (this->getOccupied() ^ Bitboards::squareBB(src)) | Bitboards::squareBB(dest);
+    if(moveSpecial(m) == EnPassant){
+        captured = Bitboards::squareBB((us == Red) ? dest + 8 : dest - 8);
+        occupied ^= captured;
+    }
+    if(src == king){
+        king = dest;
+    }
+    return !(this->attackersTo(king, occupied) & this->teamBB[them] & ~captured);
+}
+
+/**
+    Find the legal move written in coordinate notation, e.g. "e2e4" or "e7e8q"
+    @param str The move. Castling is written as the king moving two squares.
+    @returns The move, or NULL_MOVE if it isn't legal in this position
+*/
+PackedMove Position::parseMove(string str){
+    if(str.size() < 4 || str.size() > 5){
+        return NULL_MOVE;
+    }
+    auto square = [](char file, char rank) -> int {
+        if(file < 'a' || file > 'h' || rank < '1' || rank > '8') return -1;
+        return ('8' - rank) * 8 + (file - 'a');
+    };
+    int src = square(str[0], str[1]);
+    int dest = square(str[2], str[3]);
+    PieceType promo = NoPiece;
+    if(str.size() == 5){
+        const string promoLetters = "  qrbn";
+        size_t pt = promoLetters.find(tolower(str[4]));
+        if(pt == string::npos || pt < 2){
+            return NULL_MOVE;
+        }
+        promo = (PieceType) pt;
+    }
+    MoveList legal;
+    this->generateLegalMoves(legal);
+    for(int i=0; i < legal.size; i++){
+        PackedMove m = legal.moves[i];
+        if(moveSource(m) == src && moveDest(m) == dest && movePromotion(m) == promo){
+            return m;
+        }
+    }
+    return NULL_MOVE;
+}
+
+/**
+    @param m A move
+    @returns The move in coordinate notation, e.g. "e2e4" or "e7e8q". "0000" for NULL_MOVE.
+*/
+string Position::moveToString(PackedMove m){
+    if(m == NULL_MOVE){
+        return "0000";
+    }
+    auto square = [](int index) -> string {
+        return string(1, (char) ('a' + index % 8)) + (char) ('8' - index / 8);
+    };
+    string str = square(moveSource(m)) + square(moveDest(m));
+    if(moveSpecial(m) == PawnPromo){
+        str += " kqrbnp"[movePromotion(m)];
+    }
+    return str;
+}
+
+// Upper case SAN letters for each PieceType. Indexed by PieceType.
+const char SAN_PIECE_LETTERS[7] = { ' ', 'K', 'Q', 'R', 'B', 'N', 'P' };
+
+static PieceType sanPieceType(char c){
+    switch(c){
+        case 'K': return King;
+        case 'Q': return Queen;
+        case 'R': return Rook;
+        case 'B': return Bishop;
+        case 'N': return Knight;
+        default: return NoPiece;
+    }
+}
+
+/**
+    Find the legal move written in Standard Algebraic Notation, e.g. "Nf3", "exd5", "O-O" or "e8=Q+".
+    Check, mate and annotation suffixes are ignored. Doesn't allocate.
+    @param san The move
+    @returns The move, or NULL_MOVE if it isn't legal or is ambiguous in this position
+*/
+PackedMove Position::parseSan(string_view san){
+    while( !san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?')){
+        san.remove_suffix(1);
+    }
+    MoveList legal;
+    this->generateLegalMoves(legal);
+
+    if(san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0"){
+        int destFile = (san.size() == 5) ? 2 : 6;
+        for(int i=0; i < legal.size; i++){
+            if(moveSpecial(legal.moves[i]) == Castling && moveDest(legal.moves[i]) % 8 == destFile){
+                return legal.moves[i];
+            }
+        }
+        return NULL_MOVE;
+    }
+
+    size_t start = 0;
+    PieceType piece = Pawn;
+    if( !san.empty() && sanPieceType(san[0]) != NoPiece){
+        piece = sanPieceType(san[0]);
+        start = 1;
+    }
+    // Promotion is written "e8=Q", but "e8Q" is common too
+    size_t end = san.size();
+    PieceType promo = NoPiece;
+    if(piece == Pawn && end >= 2 && san[end - 2] == '='){
+        promo = sanPieceType(san[end - 1]);
+        end -= 2;
+    }
+    else if(piece == Pawn && end >= 1 && sanPieceType(san[end - 1]) != NoPiece){
+        promo = sanPieceType(san[end - 1]);
+        end -= 1;
+    }
+    if(end < start + 2 || promo == King){
+        return NULL_MOVE;
+    }
+    char destFile = san[end - 2];
+    char destRank = san[end - 1];
+    if(destFile < 'a' || destFile > 'h' || destRank < '1' || destRank > '8'){
+        return NULL_MOVE;
+    }
+    int dest = ('8' - destRank) * 8 + (destFile - 'a');
+    // Whatever is between the piece and the destination narrows down the source square
+    int fromFile = -1;
+    int fromRow = -1;
+    for(size_t i = start; i < end - 2; i++){
+        char c = san[i];
+        if(c >= 'a' && c <= 'h') fromFile = c - 'a';
+        else if(c >= '1' && c <= '8') fromRow = '8' - c;
+        else if(c != 'x' && c != ':' && c != '-') return NULL_MOVE;
+    }
+
+    PackedMove found = NULL_MOVE;
+    for(int i=0; i < legal.size; i++){
+        PackedMove m = legal.moves[i];
+        int src = moveSource(m);
+        if(moveDest(m) != dest || this->squareType[src] != piece || moveSpecial(m) == Castling){
+            continue;
+        }
+        if((fromFile >= 0 && src % 8 != fromFile) || (fromRow >= 0 && src / 8 != fromRow)){
+            continue;
+        }
+        if(movePromotion(m) != promo){
+            continue;
+        }
+        if(found != NULL_MOVE){
+            return NULL_MOVE;
+        }
+        found = m;
+    }
+    return found;
+}
+
+/**
+    Write a legal move in Standard Algebraic Notation, including '+' or '#'
+    @param m A legal move in this position
+    @returns The move, e.g. "Nbd7", "exd6", "O-O-O" or "a8=Q#"
+*/
+string Position::moveToSan(PackedMove m){
+    int src = moveSource(m);
+    int dest = moveDest(m);
+    PieceType piece = this->squareType[src];
+    string san;
+    if(moveSpecial(m) == Castling){
+        san = (dest % 8 == 2) ? "O-O-O" : "O-O";
+    }
+    else{
+        bool capture = this->squareType[dest] != NoPiece || moveSpecial(m) == EnPassant;
+        if(piece == Pawn){
+            if(capture){
+                san += (char) ('a' + src % 8);
+            }
+        }
+        else{
+            san += SAN_PIECE_LETTERS[piece];
+            // Name the file, rank or both if another piece of the same type can move to the same square
+            MoveList legal;
+            this->generateLegalMoves(legal);
+            bool sameFile = false;
+            bool sameRow = false;
+            bool ambiguous = false;
+            for(int i=0; i < legal.size; i++){
+                int other = moveSource(legal.moves[i]);
+                if(other == src || moveDest(legal.moves[i]) != dest || this->squareType[other] != piece){
+                    continue;
+                }
+                ambiguous = true;
+                sameFile |= (other % 8 == src % 8);
+                sameRow |= (other / 8 == src / 8);
+            }
+            if(ambiguous && ( !sameFile || sameRow)){
+                san += (char) ('a' + src % 8);
+            }
+            if(ambiguous && sameFile){
+                san += (char) ('8' - src / 8);
+            }
+        }
+        if(capture){
+            san += 'x';
+        }
+        san += (char) ('a' + dest % 8);
+        san += (char) ('8' - dest / 8);
+        if(moveSpecial(m) == PawnPromo){
+            san += '=';
+            san += SAN_PIECE_LETTERS[movePromotion(m)];
+        }
+    }
+    this->makeMove(m);
+    if(this->inCheck()){
+        MoveList replies;
+        this->generateLegalMoves(replies);
+        san += (replies.size == 0) ? '#' : '+';
+    }
+    this->unmakeMove();
+    return san;
+}
+
+/*
+    Private method
+    Add a pawn move, or all four promotions if the pawn reaches the last row
+*/
+void Position::addPawnMoves(MoveList& list, int src, int dest){
+    if(dest < 8 || dest >= 56){
+        list.add(packMove(src, dest, PawnPromo, Queen));
+        list.add(packMove(src, dest, PawnPromo, Rook));
+        list.add(packMove(src, dest, PawnPromo, Bishop));
+        list.add(packMove(src, dest, PawnPromo, Knight));
+    }
+    else{
+        list.add(packMove(src, dest));
+    }
+}
+
+/*
+    Private method
+    Add castling moves for the team to move. The king can't castle out of, through, or into check.
+*/
+void Position::addCastlingMoves(MoveList& list){
+    TeamColor us = this->sideToMove;
+    TeamColor them = (us == Red) ? Black : Red;
+    int kingSide = (us == Red) ? RED_KINGSIDE : BLACK_KINGSIDE;
+    int queenSide = (us == Red) ? RED_QUEENSIDE : BLACK_QUEENSIDE;
+    if( !(this->castlingRights & (kingSide | queenSide))){
+        return;
+    }
+    int king = (us == Red) ? 60 : 4;
+    if(this->squareType[king] != King || this->squareTeam[king] != us || this->isAttacked(king, them)){
+        return;
+    }
+    Bitboard occupied = this->getOccupied();
+    if((this->castlingRights & kingSide) && !(occupied & (Bitboards::squareBB(king + 1) | Bitboards::squareBB(king + 2)))){
+        if( !this->isAttacked(king + 1, them) && !this->isAttacked(king + 2, them)){
+            list.add(packMove(king, king + 2, Castling));
+        }
+    }
+    Bitboard queenSideGap = Bitboards::squareBB(king - 1) | Bitboards::squareBB(king - 2) | Bitboards::squareBB(king - 3);
+    if((this->castlingRights & queenSide) && !(occupied & queenSideGap)){
+        if( !this->isAttacked(king - 1, them) && !this->isAttacked(king - 2, them)){
+            list.add(packMove(king, king - 2, Castling));
+        }
+    }
+}
+
+/**
+    Static exchange evaluation. Resolves the full sequence of captures on the destination square
+     of a move, with both teams always recapturing with their least valuable attacker. Sliding
+     pieces hidden behind other attackers (x-rays) join the sequence once the pieces in front of
+     them have captured.
+    @param m The move that starts the capture sequence. The source square must hold a piece.
+    @returns The material gained by the moving team in centipawns, assuming both teams stop capturing
+              when continuing would lose material. Negative if the move loses material.
+*/
+int Position::see(PackedMove m){
+    int src = moveSource(m);
+    int dest = moveDest(m);
+    SpecialMove special = moveSpecial(m);
+    if(special == Castling){
+        return 0;
+    }
+    TeamColor side = this->squareTeam[src];
+    if(side == NoColor){
+        throw ChessException("Position.cpp: see(): No piece on the source square");
+    }
+
+    int gain[32];
+    int depth = 0;
+    Bitboard occupied = this->getOccupied() ^ Bitboards::squareBB(src);
+    PieceType onDest = this->squareType[src];   // piece that will be standing on dest after each capture
+
+    gain[0] = seeValue[this->squareType[dest]];
+    if(special == EnPassant){
+        // The captured pawn is not on the destination square
+        int capturedIndex = (side == Red) ? dest + 8 : dest - 8;
+        occupied ^= Bitboards::squareBB(capturedIndex);
+        gain[0] = seeValue[Pawn];
+    }
+    if(special == PawnPromo){
+        onDest = movePromotion(m);
+        gain[0] += seeValue[onDest] - seeValue[Pawn];
+    }
+
+    Bitboard rooks = this->typeBB[Rook] | this->typeBB[Queen];
+    Bitboard bishops = this->typeBB[Bishop] | this->typeBB[Queen];
+    Bitboard attackers = this->attackersTo(dest, occupied) & occupied;
+    const PieceType captureOrder[6] = { Pawn, Knight, Bishop, Rook, Queen, King };
+
+    // gain[depth] is the score for the team making capture 'depth' if the piece it captured with is
+    //  never recaptured. The king's value is large enough that a king capturing onto a defended square
+    //  always scores as a loss, so no separate legality check is needed.
+    while(true){
+        depth++;
+        gain[depth] = seeValue[onDest] - gain[depth - 1];
+        side = (side == Red) ? Black : Red;
+        Bitboard sideAttackers = attackers & this->teamBB[side];
+        if( !sideAttackers){
+            break;
+        }
+        // find the least valuable attacker
+        PieceType attacker = NoPiece;
+        Bitboard attackerBB = EMPTY_BB;
+        for(int i=0; i < 6; i++){
+            attackerBB = sideAttackers & this->typeBB[captureOrder[i]];
+            if(attackerBB){
+                attacker = captureOrder[i];
+                break;
+            }
+        }
+        occupied ^= attackerBB & (0 - attackerBB); // remove only the lowest attacker of that type
+        // reveal x-ray attackers behind the piece that just captured
+        if(attacker == Pawn || attacker == Bishop || attacker == Queen){
+            attackers |= Bitboards::bishopAttacks(dest, occupied) & bishops;
+        }
+        if(attacker == Rook || attacker == Queen){
+            attackers |= Bitboards::rookAttacks(dest, occupied) & rooks;
+        }
+        attackers &= occupied;
+        onDest = attacker;
+    }
+
+    // Negamax the gains back to the first capture. The last entry was never played.
+    while(--depth > 0){
+        gain[depth - 1] = -max(-gain[depth - 1], gain[depth]);
+    }
+    return gain[0];
+}
+
+// Getters ===================================
+
+Bitboard Position::getPieces(TeamColor tc){
+    return this->teamBB[tc];
+}
+
+Bitboard Position::getPieces(TeamColor tc, PieceType pt){
+    return this->teamBB[tc] & this->typeBB[pt];
+}
+
+Bitboard Position::getPieces(PieceType pt){
+    return this->typeBB[pt];
+}
+
+Bitboard Position::getOccupied(){
+    return this->teamBB[Red] | this->teamBB[Black];
+}
+
+TeamColor Position::getTeam(int index){
+    return this->squareTeam[index];
+}
+
+PieceType Position::getType(int index){
+    return this->squareType[index];
+}
+
+TeamColor Position::getSideToMove(){
+    return this->sideToMove;
+}
+
+int Position::getEnPassantIndex(){
+    return this->enPassantIndex;
+}
+
+// return index of the king. -1 if the team has no king
+int Position::getKingIndex(TeamColor tc){
+    Bitboard b = this->getPieces(tc, King);
+    return b ? Bitboards::lsb(b) : -1;
+}
+
+int Position::getCastlingRights(){
+    return this->castlingRights;
+}
+
+int Position::getHalfmoveClock(){
+    return this->halfmoveClock;
+}
+
+int Position::getTurnCount(){
+    return this->turnCount;
+}
+
+Score Position::getPsqScore(){
+    return this->psqScore;
+}
+
+int Position::getPhase(){
+    return this->phase;
+}
+
+Accumulator& Position::getAccumulator(){
+    return this->accumulator;
+}
+
+uint64_t Position::getKey(){
+    return this->key;
+}
+
+uint64_t Position::getPawnKey(){
+    return this->pawnKey;
+}
+
+// Setters ===================================
+
+// Setters keep the Zobrist key in sync with the value they change
+
+void Position::setSideToMove(TeamColor tc){
+    if((this->sideToMove == Black) != (tc == Black)){
+        this->key ^= ZOBRIST_KEYS.blackToMove;
+    }
+    this->sideToMove = tc;
+}
+
+void Position::setEnPassantIndex(int index){
+    if(this->enPassantIndex != -1){
+        this->key ^= ZOBRIST_KEYS.enPassant[this->enPassantIndex % 8];
+    }
+    if(index != -1){
+        this->key ^= ZOBRIST_KEYS.enPassant[index % 8];
+    }
+    this->enPassantIndex = index;
+}
+
+void Position::setCastlingRights(int rights){
+    this->key ^= ZOBRIST_KEYS.castling[this->castlingRights] ^ ZOBRIST_KEYS.castling[rights];
+    this->castlingRights = rights;
+}
+
+void Position::setHalfmoveClock(int clock){
+    this->halfmoveClock = clock;
+}
+
+void Position::setTurnCount(int count){
+    this->turnCount = count;
+}
@@ -0,0 +1,161 @@
+#ifndef Position_H
+#define Position_H
+
+#include "Piece.hpp"
+#include "Board.hpp"
+#include "Bitboard.hpp"
+#include "Evaluation.hpp"
+#include "Nnue.hpp"
+#include "Zobrist.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/*
+    A PackedMove stores a move for a Position in a single integer.
+      bits  0-5  : source index
+      bits  6-11 : destination index
+      bits 12-14 : SpecialMove. Only NonSpecial, Castling, EnPassant and PawnPromo are used.
+      bits 15-17 : PieceType a pawn is promoted to
+    The value 0 is never a valid move and is used as the null move.
+*/
+typedef uint32_t PackedMove;
+
+const PackedMove NULL_MOVE = 0;
+
+inline PackedMove packMove(int src, int dest, SpecialMove special = NonSpecial, PieceType promo = NoPiece){
+    return (PackedMove) (src | (dest << 6) | (special << 12) | (promo << 15));
+}
+inline int moveSource(PackedMove m){ return m & 0x3F; }
+inline int moveDest(PackedMove m){ return (m >> 6) & 0x3F; }
+inline SpecialMove moveSpecial(PackedMove m){ return (SpecialMove) ((m >> 12) & 0x7); }
+inline PieceType movePromotion(PackedMove m){ return (PieceType) ((m >> 15) & 0x7); }
+
+// Piece values in centipawns used by static exchange evaluation. Indexed by PieceType.
+const int seeValue[7] = { 0, 20000, 900, 500, 330, 320, 100 };
+
+// Castling rights are stored as bit flags
+const int RED_KINGSIDE = 1;
+const int RED_QUEENSIDE = 2;
+const int BLACK_KINGSIDE = 4;
+const int BLACK_QUEENSIDE = 8;
+const int ALL_CASTLING = 15;
+
+const string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+const int MAX_MOVES = 256;  // No legal chess position has more moves than this
+
+/*
+    Fixed size list of moves so move generation never allocates
+*/
+struct MoveList {
+    PackedMove moves[MAX_MOVES];
+    int size = 0;
+
+    void add(PackedMove m){ moves[size++] = m; }
+    bool contains(PackedMove m) const {
+        for(int i=0; i < size; i++){
+            if(moves[i] == m) return true;
+        }
+        return false;
+    }
+};
+
+/*
+    Everything makeMove() changes that can't be recalculated when the move is taken back
+*/
+struct UndoState {
+    PackedMove move;
+    PieceType captured;
+    int castlingRights;
+    int enPassantIndex;
+    int halfmoveClock;
+    uint64_t key;
+    uint64_t pawnKey;
+};
+
+/*
+    Bitboard representation of a chess position.
+    The Board class stores Piece objects for the UI. Position is built from a Board and is the
+     representation used for engine calculations, where speed matters more than per-piece state.
+    Indices are the same as the Board's internal board. 0 is A8, 63 is H1.
+*/
+class Position
+{
+    Bitboard teamBB[3];         // [TeamColor] all squares occupied by a team. NoColor is unused.
+    Bitboard typeBB[7];         // [PieceType] all squares occupied by a piece type, both teams. NoPiece is unused.
+    TeamColor squareTeam[64];
+    PieceType squareType[64];
+    TeamColor sideToMove;
+    int enPassantIndex;         // square a pawn can capture onto with En Passant. -1 if unavailable.
+    int castlingRights;
+    int halfmoveClock;          // moves since the last capture or pawn move
+    int turnCount;              // same meaning as Board::turnCount. Increases by 1 every move.
+    Score psqScore;             // material and piece-square score from Red's point of view. See Evaluation.hpp
+    int phase;                  // sum of phaseWeight for all pieces on the board
+    Accumulator accumulator;    // NNUE first layer. Only updated while a network is loaded. See Nnue.hpp
+    uint64_t key;               // Zobrist hash of the whole position. See Zobrist.hpp
+    uint64_t pawnKey;           // Zobrist hash of the pawns only. Used by the pawn hash table.
+    vector<UndoState> history;  // one entry for every move made with makeMove()
+
+    public:
+        Position();
+        Position(Board*, TeamColor);
+        ~Position();
+        void clear();
+        void load(Board*, TeamColor);
+        void loadFen(string_view);
+        string toFen();
+        void putPiece(int, TeamColor, PieceType);
+        void removePiece(int);
+        void makeMove(PackedMove);
+        void unmakeMove();
+        // Calculations
+        Bitboard attackersTo(int, Bitboard);
+        bool isAttacked(int, TeamColor);
+        bool inCheck();
+        bool isDraw();
+        int see(PackedMove);
+        void generateMoves(MoveList&);
+        void generateLegalMoves(MoveList&);
+        bool isLegal(PackedMove);
+        PackedMove parseMove(string);
+        static string moveToString(PackedMove);
+        PackedMove parseSan(string_view);
+        string moveToSan(PackedMove);
+        // getters
+        Bitboard getPieces(TeamColor);
+        Bitboard getPieces(TeamColor, PieceType);
+        Bitboard getPieces(PieceType);
+        Bitboard getOccupied();
+        TeamColor getTeam(int);
+        PieceType getType(int);
+        TeamColor getSideToMove();
+        int getEnPassantIndex();
+        int getKingIndex(TeamColor);
+        int getCastlingRights();
+        int getHalfmoveClock();
+        int getTurnCount();
+        Score getPsqScore();
+        int getPhase();
+        Accumulator& getAccumulator();
+        uint64_t getKey();
+        uint64_t getPawnKey();
+        // setters
+        void setSideToMove(TeamColor);
+        void setEnPassantIndex(int);
+        void setCastlingRights(int);
+        void setHalfmoveClock(int);
+        void setTurnCount(int);
+
+    private:
+        void movePiece(int, int);
+        void updateAccumulator(int, TeamColor, PieceType, bool);
+        void addPawnMoves(MoveList&, int, int);
+        void addCastlingMoves(MoveList&);
+};
+
+#endif
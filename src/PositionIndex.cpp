@@ -0,0 +1,331 @@
+#include "PositionIndex.hpp"
+#include "ChessException.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+static_assert(sizeof(PiEntry) == 16, "PiEntry is written to files as is");
+
+const size_t PI_IO_ENTRIES = 4096;  // entries read or written at a time while merging runs
+
+
+PositionIndex::PositionIndex(){
+    this->mapped = NULL;
+    this->mappedSize = 0;
+    this->bloom = NULL;
+    this->bloomMask = 0;
+    this->entries = NULL;
+    this->entryCount = 0;
+}
+
+PositionIndex::~PositionIndex(){
+    this->unmap();
+}
+
+// Loading ===================================
+
+/**
+    Map an index file into memory. Replaces any index that was already mapped.
+    @param path Location of the .ccpi file
+    @returns nothing. Throws ChessException if the file can't be used.
+*/
+void PositionIndex::map(string path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw ChessException("PositionIndex.cpp: Could not open index file");
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        close(fd);
+        throw ChessException("PositionIndex.cpp: Could not read index file size");
+    }
+    size_t size = st.st_size;
+    if(size < (size_t) PI_HEADER_SIZE){
+        close(fd);
+        throw ChessException("PositionIndex.cpp: Index file is too short");
+    }
+    void* mem = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mem == MAP_FAILED){
+        throw ChessException("PositionIndex.cpp: Could not map index file");
+    }
+    const uint8_t* data = (const uint8_t*) mem;
+    uint32_t version;
+    uint64_t entries, bloomBytes;
+    memcpy(&version, data + 4, sizeof(version));
+    memcpy(&entries, data + 8, sizeof(entries));
+    memcpy(&bloomBytes, data + 16, sizeof(bloomBytes));
+    bool powerOfTwo = bloomBytes >= 8 && (bloomBytes & (bloomBytes - 1)) == 0;
+    if(memcmp(data, "CCPI", 4) != 0 || version != PI_VERSION || !powerOfTwo
+        || size != PI_HEADER_SIZE + bloomBytes + entries * sizeof(PiEntry)){
+        munmap(mem, size);
+        throw ChessException("PositionIndex.cpp: Index file header doesn't match its size");
+    }
+    // Lookups jump around the file, so don't read ahead
+    madvise(mem, size, MADV_RANDOM);
+
+    this->unmap();
+    this->mapped = data;
+    this->mappedSize = size;
+    this->bloom = data + PI_HEADER_SIZE;
+    this->bloomMask = bloomBytes * 8 - 1;
+    this->entries = (const PiEntry*) (data + PI_HEADER_SIZE + bloomBytes);
+    this->entryCount = entries;
+}
+
+void PositionIndex::unmap(){
+    if(this->mapped != NULL){
+        munmap((void*) this->mapped, this->mappedSize);
+    }
+    this->mapped = NULL;
+    this->mappedSize = 0;
+    this->bloom = NULL;
+    this->bloomMask = 0;
+    this->entries = NULL;
+    this->entryCount = 0;
+}
+
+uint64_t PositionIndex::getEntryCount(){
+    return this->entryCount;
+}
+
+// Lookups ===================================
+
+/**
+    Check the Bloom filter only
+    @param key Zobrist key of a position
+    @returns false if the position is certainly not in the index
+*/
+bool PositionIndex::mayContain(uint64_t key){
+    if(this->bloom == NULL){
+        return false;
+    }
+    for(int i=0; i < PI_BLOOM_HASHES; i++){
+        uint64_t bit = bloomBit(key, i, this->bloomMask);
+        if(!(this->bloom[bit / 8] & (1 << (bit % 8)))){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+    Find every game that reached a position
+    @param key Zobrist key of the position
+    @param found Set to the entries for the position, by game
+    @returns Number of entries found
+*/
+size_t PositionIndex::find(uint64_t key, vector<PiEntry>& found){
+    found.clear();
+    if(!this->mayContain(key)){
+        return 0;
+    }
+    const PiEntry* end = this->entries + this->entryCount;
+    const PiEntry* first = lower_bound(this->entries, end, key, [](const PiEntry& e, uint64_t k){ return e.key < k; });
+    for(const PiEntry* e = first; e < end && e->key == key; e++){
+        found.push_back(*e);
+    }
+    return found.size();
+}
+
+/**
+    @param pos The position to look up
+    @param found Set to the entries for the position, by game
+    @returns Number of entries found
+*/
+size_t PositionIndex::find(Position& pos, vector<PiEntry>& found){
+    return this->find(pos.getKey(), found);
+}
+
+/**
+    Static method
+    @param key Zobrist key of a position
+    @param i Which of the PI_BLOOM_HASHES bits
+    @param mask Bloom filter bits - 1
+    @returns Bit of the filter to set or test
+*/
+uint64_t PositionIndex::bloomBit(uint64_t key, int i, uint64_t mask){
+    // Double hashing. The second hash is odd so every bit can be reached.
+    uint64_t step = ((key >> 32) | (key << 32)) | 1;
+    return (key + i * step) & mask;
+}
+
+
+/*
+    Sorted run spilled to a temporary file, read back a block at a time while merging
+*/
+struct PiRun {
+    ifstream in;
+    vector<PiEntry> block;
+    size_t next;
+
+    PiRun(string path) : in(path, ios::binary), next(0) {}
+
+    bool read(PiEntry& e){
+        if(this->next == this->block.size()){
+            this->block.resize(PI_IO_ENTRIES);
+            this->in.read((char*) this->block.data(), PI_IO_ENTRIES * sizeof(PiEntry));
+            this->block.resize(this->in.gcount() / sizeof(PiEntry));
+            this->next = 0;
+            if(this->block.empty()){
+                return false;
+            }
+        }
+        e = this->block[this->next++];
+        return true;
+    }
+};
+
+/**
+    @param runEntries Entries sorted in memory before they are spilled to a temporary file
+*/
+PositionIndexWriter::PositionIndexWriter(size_t runEntries){
+    this->runEntries = max(runEntries, PI_IO_ENTRIES);
+    this->added = 0;
+}
+
+/**
+    Start an index. Nothing is written until close().
+    @param path Location of the .ccpi file
+    @returns nothing
+*/
+void PositionIndexWriter::open(string path){
+    this->path = path;
+    this->buffer.clear();
+    this->runs.clear();
+    this->added = 0;
+}
+
+/**
+    @param key Zobrist key of a position
+    @param game Game number in the archive
+    @param ply Plies played in the game before the position was reached
+    @returns nothing. Throws ChessException if a run can't be spilled.
+*/
+void PositionIndexWriter::add(uint64_t key, uint32_t game, uint16_t ply){
+    this->buffer.push_back(PiEntry{key, game, ply, 0});
+    this->added++;
+    if(this->buffer.size() >= this->runEntries){
+        this->writeRun();
+    }
+}
+
+/**
+    Sort and merge the positions added, build the Bloom filter and write the index
+    @returns Number of entries written. Throws ChessException if the file can't be written.
+*/
+uint64_t PositionIndexWriter::close(){
+    uint64_t bloomBits = 64;
+    while(bloomBits < this->added * PI_BLOOM_BITS_PER_ENTRY){
+        bloomBits *= 2;
+    }
+    vector<uint8_t> bloom(bloomBits / 8);
+    ofstream out(this->path, ios::binary | ios::trunc);
+    if(!out){
+        throw ChessException("PositionIndex.cpp: Could not create index file");
+    }
+    char header[PI_HEADER_SIZE] = { 0 };
+    out.write(header, PI_HEADER_SIZE);
+    out.write((const char*) bloom.data(), bloom.size());
+
+    // Keep the first ply of every game a position appears in
+    uint64_t written = 0;
+    PiEntry last = { 0, 0, 0, 0 };
+    vector<PiEntry> block;
+    auto emit = [&](const PiEntry& e){
+        if(written > 0 && e.key == last.key && e.game == last.game){
+            return;
+        }
+        last = e;
+        written++;
+        for(int i=0; i < PI_BLOOM_HASHES; i++){
+            uint64_t bit = PositionIndex::bloomBit(e.key, i, bloomBits - 1);
+            bloom[bit / 8] |= 1 << (bit % 8);
+        }
+        block.push_back(e);
+        if(block.size() == PI_IO_ENTRIES){
+            out.write((const char*) block.data(), block.size() * sizeof(PiEntry));
+            block.clear();
+        }
+    };
+
+    if(this->runs.empty()){
+        sort(this->buffer.begin(), this->buffer.end());
+        for(const PiEntry& e : this->buffer){
+            emit(e);
+        }
+    }
+    else{
+        if(!this->buffer.empty()){
+            this->writeRun();
+        }
+        vector<unique_ptr<PiRun>> readers;
+        auto later = [](const pair<PiEntry, size_t>& a, const pair<PiEntry, size_t>& b){ return b.first < a.first; };
+        priority_queue<pair<PiEntry, size_t>, vector<pair<PiEntry, size_t>>, decltype(later)> heads(later);
+        for(size_t r=0; r < this->runs.size(); r++){
+            readers.emplace_back(new PiRun(this->runs[r]));
+            PiEntry e;
+            if(readers[r]->read(e)){
+                heads.push({e, r});
+            }
+        }
+        while(!heads.empty()){
+            auto [e, r] = heads.top();
+            heads.pop();
+            emit(e);
+            PiEntry next;
+            if(readers[r]->read(next)){
+                heads.push({next, r});
+            }
+        }
+        readers.clear();
+        for(string& run : this->runs){
+            remove(run.c_str());
+        }
+        this->runs.clear();
+    }
+    out.write((const char*) block.data(), block.size() * sizeof(PiEntry));
+    this->buffer.clear();
+    this->buffer.shrink_to_fit();
+
+    uint32_t version = PI_VERSION;
+    uint64_t bloomBytes = bloom.size();
+    memcpy(header, "CCPI", 4);
+    memcpy(header + 4, &version, sizeof(version));
+    memcpy(header + 8, &written, sizeof(written));
+    memcpy(header + 16, &bloomBytes, sizeof(bloomBytes));
+    out.seekp(0);
+    out.write(header, PI_HEADER_SIZE);
+    out.write((const char*) bloom.data(), bloom.size());
+    out.close();
+    if(out.fail()){
+        throw ChessException("PositionIndex.cpp: Could not write index file");
+    }
+    return written;
+}
+
+/*
+    Private method
+    Sort the buffered entries and spill them to a temporary file next to the index
+*/
+void PositionIndexWriter::writeRun(){
+    sort(this->buffer.begin(), this->buffer.end());
+    string runPath = this->path + ".run" + to_string(this->runs.size());
+    ofstream run(runPath, ios::binary | ios::trunc);
+    run.write((const char*) this->buffer.data(), this->buffer.size() * sizeof(PiEntry));
+    if(!run){
+        throw ChessException("PositionIndex.cpp: Could not write temporary file " + runPath);
+    }
+    this->runs.push_back(runPath);
+    this->buffer.clear();
+}
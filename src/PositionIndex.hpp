@@ -0,0 +1,90 @@
+#ifndef PositionIndex_H
+#define PositionIndex_H
+
+#include "Position.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+    Index of every position reached in a game archive, keyed by Zobrist hash.
+
+    Entries are sorted by key, then game, then ply, and a game is only listed once for a position
+     it repeats. Lookups binary search the mapped file. A Bloom filter in front of the entries
+     answers most lookups for positions that aren't in the index without touching the entries: each
+     key sets PI_BLOOM_HASHES bits, derived from the key itself since Zobrist keys are already random.
+    Any position can be looked up: one from a FEN with Position::loadFen, or a Board set up by
+     StateFactory with Position(Board*, TeamColor).
+
+    File layout (little endian):
+        char     magic[4]       "CCPI"
+        uint32   version        PI_VERSION
+        uint64   entries
+        uint64   bloomBytes     a power of two, at least 8
+        uint64   reserved
+        uint8    bloom[bloomBytes]
+        PiEntry  entries[entries]
+    Files are written by PositionIndexWriter, which sorts in runs of bounded size and merges them,
+     so archives of any size can be indexed.
+*/
+const int PI_VERSION = 1;
+const int PI_HEADER_SIZE = 32;
+const int PI_BLOOM_HASHES = 7;
+const int PI_BLOOM_BITS_PER_ENTRY = 10;            // about 1% false positives
+const size_t PI_DEFAULT_RUN_ENTRIES = 1 << 24;      // entries sorted in memory at a time, 256 MB
+
+struct PiEntry {
+    uint64_t key;
+    uint32_t game;      // game number in the archive
+    uint16_t ply;       // plies played before the position was reached
+    uint16_t reserved;
+};
+
+inline bool operator<(const PiEntry& a, const PiEntry& b){
+    if(a.key != b.key) return a.key < b.key;
+    if(a.game != b.game) return a.game < b.game;
+    return a.ply < b.ply;
+}
+
+class PositionIndex {
+    const uint8_t* mapped;
+    size_t mappedSize;
+    const uint8_t* bloom;
+    uint64_t bloomMask;     // bloom filter bits - 1
+    const PiEntry* entries;
+    uint64_t entryCount;
+
+    public:
+        PositionIndex();
+        ~PositionIndex();
+        void map(string);
+        void unmap();
+        bool mayContain(uint64_t);
+        size_t find(uint64_t, vector<PiEntry>&);
+        size_t find(Position&, vector<PiEntry>&);
+        uint64_t getEntryCount();
+        // Bloom filter bit positions, shared with the writer
+        static uint64_t bloomBit(uint64_t, int, uint64_t);
+};
+
+class PositionIndexWriter {
+    string path;
+    size_t runEntries;
+    vector<PiEntry> buffer;
+    vector<string> runs;    // temporary files holding sorted runs
+    uint64_t added;
+
+    public:
+        PositionIndexWriter(size_t runEntries = PI_DEFAULT_RUN_ENTRIES);
+        void open(string);
+        void add(uint64_t, uint32_t, uint16_t);
+        uint64_t close();
+
+    private:
+        void writeRun();
+};
+
+#endif
@@ -5,6 +5,7 @@
 
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <regex>
 #include <string>
 
@@ -14,6 +15,8 @@ using namespace std;
 Prompt::Prompt(){
     this->cmdArgs = new int[MAX_ARGS];
     this->input = new char[MAX_INPUT_SIZE];
+    this->source = &cin;
+    this->showPrompt = true;
     this->resetCmdArgs();
     this->resetInputArray();
     this->resetPromoArg();
@@ -29,23 +32,40 @@ Prompt::~Prompt(){
 */
 void Prompt::promptInput(string promptStr){
     this->resetInputArray();
-    cout << promptStr << ": ";
+    if(this->showPrompt){
+        cout << promptStr << ": ";
+    }
 
-    cin.getline(this->input, MAX_INPUT_SIZE);
+    this->readLine();
 
     this->cmdArgs = Prompt::parseInput();
 }
 
+/*
+    Private method
+    Read one line into 'input'. A line longer than the buffer is cut short instead of leaving the
+     stream in a failed state.
+*/
+void Prompt::readLine(){
+    this->source->getline(this->input, MAX_INPUT_SIZE);
+    if(this->source->fail() && !this->source->eof()){
+        this->source->clear();
+        this->source->ignore(numeric_limits<streamsize>::max(), '\n');
+    }
+}
+
 /*
     Prompt user for input specific to pawn promotion
 */
 void Prompt::promotionInput(){
-    cout << "You can promote a pawn!\nOptions: Queen (q), Rook (r), Bishop (b), Knight (n)" << endl;
     string promptStr = "Enter a single character to choose: ";
     this->resetInputArray();
-    cout << promptStr;
-    
-    cin.getline(this->input, MAX_INPUT_SIZE);
+    if(this->showPrompt){
+        cout << "You can promote a pawn!\nOptions: Queen (q), Rook (r), Bishop (b), Knight (n)" << endl;
+        cout << promptStr;
+    }
+
+    this->readLine();
 
     try{
         this->promoArg = Prompt::parsePromotionInput();
@@ -190,6 +210,16 @@ int* Prompt::parseInput(){
                 this->cmdArgs[0] = ClearCmd;
                 break;
             }
+            else if(word == "go"){
+                // The computer plays a move for the team whose turn it is
+                this->cmdArgs[0] = GoCmd;
+                break;
+            }
+            else if(word == "stats"){
+                // Shows call counts and times of the hot paths
+                this->cmdArgs[0] = StatsCmd;
+                break;
+            }
             else if(word == "exit" || word == "q" || word == "quit"){
                 // Exits the game
                 this->cmdArgs[0] = ExitCmd;
@@ -352,4 +382,26 @@ int* Prompt::getCmdArgs(){
 
 int Prompt::getPromoArg(){
     return this->promoArg;
-}
\ No newline at end of file
+}
+/**
+    Read commands from a different stream
+    @param in Stream to read from. Must outlive the Prompt.
+    @returns nothing
+*/
+void Prompt::setInput(istream* in){
+    this->source = in;
+}
+
+/**
+    @param show false to read commands without printing prompts, e.g. when input is scripted
+*/
+void Prompt::setShowPrompt(bool show){
+    this->showPrompt = show;
+}
+
+/**
+    @returns true if the last read found the end of the input instead of a command
+*/
+bool Prompt::isEndOfInput(){
+    return (this->source->eof() || this->source->bad()) && this->input[0] == '\0';
+}
@@ -18,6 +18,8 @@ enum Command {
     TurnCmd,
     RemoveCmd,
     LoadCmd,
+    GoCmd,
+    StatsCmd,
     ExitCmd // Keep as LAST command in enum
 };
 const int MAX_CMDS = Command::ExitCmd - Command::InvalidCmd + 1;
@@ -29,6 +31,8 @@ class Prompt
         int* cmdArgs;
         char* input;
         int promoArg;
+        istream* source;    // where commands are read from. cin by default.
+        bool showPrompt;    // print prompt strings before reading
         // TODO: stack for error messages
 
     public:
@@ -39,6 +43,9 @@ class Prompt
         bool testRegex(string);
         int* getCmdArgs();
         int getPromoArg();
+        void setInput(istream*);
+        void setShowPrompt(bool);
+        bool isEndOfInput();
 
     private:
         int* parseInput();
@@ -49,6 +56,7 @@ class Prompt
         void resetCmdArgs();
         void resetPromoArg();
         void resetInputArray();
+        void readLine();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "Renderer.hpp"
+#include "Stats.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char CLEAR_SCREEN[] = "\033[H\033[2J\033[3J";
+static const char CLEAR_LINE_END[] = "\033[K";
+static const char CLEAR_SCREEN_END[] = "\033[J";
+
+
+Renderer::Renderer(){
+    const char* term = getenv("TERM");
+    this->cursorAddressing = isatty(STDOUT_FILENO) && term != NULL && strcmp(term, "dumb") != 0;
+    this->terminalRows = 0;
+    this->terminalCols = 0;
+    this->invalidate();
+}
+
+Renderer::~Renderer() = default;
+
+/**
+    Draw a frame, redrawing as little as possible
+    @param board The Board to draw
+    @param top Lines shown above the board
+    @param bottom Lines shown below the board
+    @returns nothing
+*/
+void Renderer::draw(Board* board, vector<string>& top, vector<string>& bottom){
+    StatTimer timer(DrawStat);
+    int rows = 0;
+    int cols = 0;
+    bool sized = this->readTerminalSize(rows, cols);
+    int frameLines = (int) (top.size() + board->getDisplayLineCount() + bottom.size());
+    size_t widest = 0;
+    for(const string& line : top) widest = max(widest, line.size());
+    for(const string& line : bottom) widest = max(widest, line.size());
+    // Cursor addressing only works while the whole frame fits on the screen without wrapping or scrolling
+    bool diffable = this->cursorAddressing && this->drawn && sized && rows == this->terminalRows
+        && cols == this->terminalCols && frameLines + 2 < rows && (int) widest < cols
+        && top.size() == this->lastTop.size();
+    this->terminalRows = rows;
+    this->terminalCols = cols;
+
+    if(diffable){
+        this->drawChanges(board, top, bottom);
+    }
+    else{
+        this->drawFull(board, top, bottom);
+    }
+    // Anything printed through cout has to reach the terminal before the frame
+    cout.flush();
+    this->frame.flush(STDOUT_FILENO);
+    this->remember(board, top, bottom);
+    this->drawn = this->cursorAddressing;
+}
+
+/**
+    Draw the next frame in full, e.g. after something else wrote over the screen
+*/
+void Renderer::invalidate(){
+    this->drawn = false;
+}
+
+/*
+    Private method
+    Clear the screen and compose every line of the frame
+*/
+void Renderer::drawFull(Board* board, vector<string>& top, vector<string>& bottom){
+    this->frame.clear();
+    if(this->cursorAddressing){
+        this->frame.append(CLEAR_SCREEN);
+    }
+    for(const string& line : top){
+        this->appendLine(line);
+    }
+    board->render(this->frame);
+    for(const string& line : bottom){
+        this->appendLine(line);
+    }
+}
+
+/*
+    Private method
+    Compose only what changed since the last frame. The layout above the board is the same, so
+     every square is still on the same terminal row.
+*/
+void Renderer::drawChanges(Board* board, vector<string>& top, vector<string>& bottom){
+    this->frame.clear();
+    int row = 1;
+    for(size_t i=0; i < top.size(); i++, row++){
+        if(top[i] != this->lastTop[i]){
+            this->frame.moveCursor(row, 1);
+            this->frame.append(top[i]);
+            this->frame.append(CLEAR_LINE_END);
+        }
+    }
+    int boardRow = row;
+    for(int i=0; i < 64; i++){
+        Piece p = board->getPiece(i);
+        const char* bg = board->squareBackground(i);
+        if(bg == this->lastBackground[i] && p.getTeam() == this->lastTeam[i] && p.getType() == this->lastType[i]){
+            continue;
+        }
+        this->frame.moveCursor(boardRow + Board::getSquareLine(i), Board::getSquareColumn(i) + 1);
+        board->renderSquare(this->frame, i);
+    }
+    // Lines below the board, then wipe whatever was printed under the last frame
+    row = boardRow + board->getDisplayLineCount();
+    for(size_t i=0; i < bottom.size(); i++, row++){
+        if(i >= this->lastBottom.size() || bottom[i] != this->lastBottom[i]){
+            this->frame.moveCursor(row, 1);
+            this->frame.append(bottom[i]);
+            this->frame.append(CLEAR_LINE_END);
+        }
+    }
+    this->frame.moveCursor(row, 1);
+    this->frame.append(CLEAR_SCREEN_END);
+}
+
+/*
+    Private method
+    Keep what is on screen so the next frame can be compared to it
+*/
+void Renderer::remember(Board* board, vector<string>& top, vector<string>& bottom){
+    this->lastTop = top;
+    this->lastBottom = bottom;
+    for(int i=0; i < 64; i++){
+        Piece p = board->getPiece(i);
+        this->lastBackground[i] = board->squareBackground(i);
+        this->lastTeam[i] = p.getTeam();
+        this->lastType[i] = p.getType();
+    }
+}
+
+// Private method
+void Renderer::appendLine(const string& line){
+    this->frame.append(line);
+    this->frame.append('\n');
+}
+
+/*
+    Private method
+    Get the size of the terminal in characters. Returns false if it isn't known.
+*/
+bool Renderer::readTerminalSize(int& rows, int& cols){
+    struct winsize ws;
+    if(ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != 0 || ws.ws_row == 0){
+        return false;
+    }
+    rows = ws.ws_row;
+    cols = ws.ws_col;
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef Renderer_H
+#define Renderer_H
+
+#include "Board.hpp"
+#include "FrameBuffer.hpp"
+#include "Piece.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+    Draws the game screen: messages above the board, the board, and messages below it.
+    Every frame is composed in one FrameBuffer and written with a single write().
+    On a terminal that understands ANSI cursor addressing, only the parts of the screen that
+     changed since the last frame are redrawn: message lines that differ and squares whose piece or
+     background changed. The whole screen is redrawn when the layout changes, e.g. the number of
+     message lines above the board or the terminal size. Output that isn't a terminal gets every
+     frame in full, without escape sequences for clearing or moving the cursor.
+*/
+class Renderer {
+    FrameBuffer frame;
+    bool cursorAddressing;          // output is a terminal that understands ANSI cursor movement
+    bool drawn;                     // the last frame is on screen and can be diffed against
+    int terminalRows;
+    int terminalCols;
+    vector<string> lastTop;
+    vector<string> lastBottom;
+    const char* lastBackground[64];
+    TeamColor lastTeam[64];
+    PieceType lastType[64];
+
+    public:
+        Renderer();
+        ~Renderer();
+        void draw(Board*, vector<string>&, vector<string>&);
+        void invalidate();
+
+    private:
+        void drawFull(Board*, vector<string>&, vector<string>&);
+        void drawChanges(Board*, vector<string>&, vector<string>&);
+        void remember(Board*, vector<string>&, vector<string>&);
+        void appendLine(const string&);
+        bool readTerminalSize(int&, int&);
+};
+
+#endif
@@ -0,0 +1,461 @@
+#include "Search.hpp"
+#include "Position.hpp"
+#include "Evaluation.hpp"
+#include "Bitboard.hpp"
+#include "Book.hpp"
+#include "TranspositionTable.hpp"
+#include "Debug.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+// Move ordering scores
+const int ORDER_BEST = 1 << 30;
+const int ORDER_CAPTURE = 1 << 24;
+const int ORDER_PROMOTION = 1 << 23;
+const int ORDER_KILLER = 1 << 22;
+const int HISTORY_MAX = 1 << 20;    // history scores are halved when one reaches this
+// Capture order: most valuable victim first, then least valuable attacker. Indexed by PieceType.
+const int orderValue[7] = { 0, 6, 5, 4, 3, 2, 1 };
+
+
+/**
+    @param table Where results are stored. Searches on the same position should share one.
+*/
+Search::Search(TranspositionTable* table){
+    this->table = table;
+    this->stopped = false;
+    this->ponderhitPending = false;
+    this->nodes = 0;
+    this->nodeLimit = 0;
+    this->threadIndex = 0;
+    this->rootBest = NULL_MOVE;
+    this->clearHeuristics();
+}
+
+Search::~Search() = default;
+
+/**
+    Find the best move in a position
+    @param root The Position to search. It isn't changed.
+    @param tc Time and depth limits
+    @returns The best move found and its score. bestMove is NULL_MOVE if there are no legal moves.
+*/
+SearchResult Search::think(Position& root, TimeControl tc){
+    this->pos = root;
+    this->nodes = 0;
+    this->nodeLimit = tc.nodes;
+    this->stopped = false;
+    this->ponderhitPending = false;
+    this->rootBest = NULL_MOVE;
+    this->clearHeuristics();
+    this->timer.start(tc);
+    if(this->threadIndex == 0){
+        this->table->newSearch();
+    }
+
+    SearchResult result;
+    if(Book::isLoaded() && this->threadIndex == 0){
+        PackedMove bookMove = Book::probe(this->pos, false);
+        if(bookMove != NULL_MOVE){
+            result.bestMove = bookMove;
+            result.fromBook = true;
+            return result;
+        }
+    }
+
+    MoveList legal;
+    this->pos.generateLegalMoves(legal);
+    if(legal.size == 0){
+        return result;
+    }
+    result.bestMove = legal.moves[0];
+
+    int maxDepth = (tc.depth > 0) ? min(tc.depth, MAX_PLY - 1) : MAX_PLY - 1;
+    // Nothing to decide with a single legal move, but still find a score and a reply to ponder on
+    if(legal.size == 1 && !tc.infinite){
+        maxDepth = min(maxDepth, 4);
+    }
+    int changes = 0;    // bit 'i' is set if the best move changed 'i' iterations ago
+
+    // Helper threads start one ply deeper every other thread, so they don't all search the same tree
+    for(int depth = 1 + (this->threadIndex & 1); depth <= maxDepth; depth++){
+        int score = this->negamax(depth, -INF_SCORE, INF_SCORE, 0);
+        // An unfinished iteration can only be trusted for moves it completed, which the next
+        //  iteration would have searched first anyway. Keep the last completed result.
+        if(this->stopped && result.depth > 0){
+            break;
+        }
+        if(this->pvLength[0] == 0){
+            break;
+        }
+        PackedMove best = this->pv[0][0];
+        changes = ((changes << 1) | (depth > 1 && best != result.bestMove)) & 0xF;
+        this->rootBest = best;
+        result.bestMove = best;
+        result.ponderMove = (this->pvLength[0] > 1) ? this->pv[0][1] : NULL_MOVE;
+        result.score = score;
+        result.depth = depth;
+        result.pv.assign(this->pv[0], this->pv[0] + this->pvLength[0]);
+        // A transposition table cutoff right after the best move leaves no reply in the line
+        if(result.ponderMove == NULL_MOVE){
+            TTData tt;
+            MoveList replies;
+            this->pos.makeMove(best);
+            this->pos.generateLegalMoves(replies);
+            if(this->table->probe(this->pos.getKey(), tt, 1) && replies.contains(tt.move)){
+                result.ponderMove = tt.move;
+            }
+            this->pos.unmakeMove();
+        }
+        if(this->threadIndex == 0 && this->infoCallback){
+            result.nodes = this->nodes;
+            result.time = this->timer.elapsed();
+            this->infoCallback(result);
+        }
+
+        if(DEBUG_MODE){
+            cout << "Search.cpp: depth " << depth << " score " << score << " nodes " << this->nodes << " time " << this->timer.elapsed() << endl;
+        }
+        if(this->stopped){
+            break;
+        }
+        this->timer.updateStability(Bitboards::popCount(changes));
+        if(this->timer.softExpired()){
+            break;
+        }
+        // A forced mate won't get any shorter with deeper searches
+        if(abs(score) > MATE_BOUND && depth >= MATE_SCORE - abs(score)){
+            break;
+        }
+    }
+    result.nodes = this->nodes;
+    result.time = this->timer.elapsed();
+    return result;
+}
+
+/**
+    Stop the search as soon as possible. Safe to call from another thread.
+*/
+void Search::stop(){
+    this->stopped = true;
+}
+
+/**
+    The move that was pondered on has been played. A search started with TimeControl::ponder starts
+     keeping time. Safe to call from another thread.
+*/
+void Search::ponderhit(){
+    this->ponderhitPending = true;
+}
+
+bool Search::isStopped(){
+    return this->stopped;
+}
+
+uint64_t Search::getNodes(){
+    return this->nodes.load(memory_order_relaxed);
+}
+
+/**
+    Reset the node count before the search starts, so it isn't read from the last search
+*/
+void Search::clearNodes(){
+    this->nodes = 0;
+}
+
+/**
+    @param index 0 for the main search. Helper searches don't probe the book or report progress.
+*/
+void Search::setThreadIndex(int index){
+    this->threadIndex = index;
+}
+
+/**
+    @param callback Called by the main search after every completed iteration
+*/
+void Search::setInfoCallback(function<void(SearchResult&)> callback){
+    this->infoCallback = callback;
+}
+
+/**
+    @param options How the search evaluates and scores draws. Applies from the next think().
+*/
+void Search::setOptions(SearchOptions options){
+    this->options = options;
+}
+
+/*
+    Private method
+    Alpha-beta search to a fixed depth. Returns the score of the position from the point of view of
+     the team to move. Returns 0 once the search is stopped, which callers have to ignore.
+*/
+int Search::negamax(int depth, int alpha, int beta, int ply){
+    this->pvLength[ply] = 0;
+    if(ply > 0){
+        if(this->pos.isDraw()){
+            return this->drawScore(ply);
+        }
+        // A mate found closer to the root can't be improved on
+        alpha = max(alpha, -MATE_SCORE + ply);
+        beta = min(beta, MATE_SCORE - ply - 1);
+        if(alpha >= beta){
+            return alpha;
+        }
+    }
+    bool check = this->pos.inCheck();
+    if(check){
+        depth++;    // never stop searching while in check
+    }
+    if(depth <= 0){
+        return this->quiescence(alpha, beta, ply);
+    }
+    if(ply >= MAX_PLY - 1){
+        return this->evaluate();
+    }
+    this->countNode();
+    if(this->checkTime()){
+        return 0;
+    }
+
+    uint64_t key = this->pos.getKey();
+    TTData tt;
+    PackedMove hashMove = NULL_MOVE;
+    if(this->table->probe(key, tt, ply)){
+        hashMove = tt.move;
+        if(ply > 0 && tt.depth >= depth){
+            if(tt.bound == ExactBound
+                || (tt.bound == LowerBound && tt.score >= beta)
+                || (tt.bound == UpperBound && tt.score <= alpha)){
+                return tt.score;
+            }
+        }
+    }
+    if(ply == 0 && this->rootBest != NULL_MOVE){
+        hashMove = this->rootBest;
+    }
+
+    MoveList moves;
+    this->pos.generateLegalMoves(moves);
+    if(moves.size == 0){
+        return check ? -MATE_SCORE + ply : this->drawScore(ply);
+    }
+    int scores[MAX_MOVES];
+    this->scoreMoves(moves, scores, ply, hashMove);
+
+    int originalAlpha = alpha;
+    PackedMove bestMove = NULL_MOVE;
+    int bestScore = -INF_SCORE;
+    for(int i=0; i < moves.size; i++){
+        PackedMove m = this->pickMove(moves, scores, i);
+        this->pos.makeMove(m);
+        int score = -this->negamax(depth - 1, -beta, -alpha, ply + 1);
+        this->pos.unmakeMove();
+        if(this->stopped){
+            return 0;
+        }
+        if(score <= bestScore){
+            continue;
+        }
+        bestScore = score;
+        bestMove = m;
+        if(score <= alpha){
+            continue;
+        }
+        alpha = score;
+        // This move followed by the best line found after it
+        this->pv[ply][0] = m;
+        memcpy(&this->pv[ply][1], this->pv[ply + 1], this->pvLength[ply + 1] * sizeof(PackedMove));
+        this->pvLength[ply] = this->pvLength[ply + 1] + 1;
+
+        if(score >= beta){
+            if(!this->isCapture(m) && moveSpecial(m) != PawnPromo){
+                if(this->killers[ply][0] != m){
+                    this->killers[ply][1] = this->killers[ply][0];
+                    this->killers[ply][0] = m;
+                }
+                int& h = this->history[this->pos.getSideToMove()][moveSource(m)][moveDest(m)];
+                h += depth * depth;
+                if(h >= HISTORY_MAX){
+                    for(int tc=0; tc < 3; tc++) for(int s=0; s < 64; s++) for(int d=0; d < 64; d++){
+                        this->history[tc][s][d] /= 2;
+                    }
+                }
+            }
+            break;
+        }
+    }
+    Bound bound = (bestScore >= beta) ? LowerBound : (bestScore > originalAlpha) ? ExactBound : UpperBound;
+    // A move that failed low isn't known to be better than the others
+    this->table->store(key, (bound == UpperBound) ? NULL_MOVE : bestMove, bestScore, depth, bound, ply);
+    return bestScore;
+}
+
+/*
+    Private method
+    Search captures until the position is quiet, so the evaluation is never taken in the middle of an
+     exchange. Captures that lose material by static exchange evaluation are skipped.
+*/
+int Search::quiescence(int alpha, int beta, int ply){
+    this->pvLength[ply] = 0;
+    this->countNode();
+    if(this->checkTime()){
+        return 0;
+    }
+    if(ply >= MAX_PLY - 1){
+        return this->evaluate();
+    }
+    bool check = this->pos.inCheck();
+    int bestScore = -MATE_SCORE + ply;
+    // Without a check the team to move can decline every capture
+    if(!check){
+        bestScore = this->evaluate();
+        if(bestScore >= beta){
+            return bestScore;
+        }
+        alpha = max(alpha, bestScore);
+    }
+
+    MoveList moves;
+    if(check){
+        this->pos.generateLegalMoves(moves);   // every evasion has to be tried
+    }
+    else{
+        MoveList all;
+        this->pos.generateMoves(all);
+        for(int i=0; i < all.size; i++){
+            PackedMove m = all.moves[i];
+            if((this->isCapture(m) || movePromotion(m) == Queen) && this->pos.isLegal(m)){
+                moves.add(m);
+            }
+        }
+    }
+    int scores[MAX_MOVES];
+    this->scoreMoves(moves, scores, ply, NULL_MOVE);
+
+    for(int i=0; i < moves.size; i++){
+        PackedMove m = this->pickMove(moves, scores, i);
+        if(!check && this->isCapture(m) && this->pos.see(m) < 0){
+            continue;
+        }
+        this->pos.makeMove(m);
+        int score = -this->quiescence(-beta, -alpha, ply + 1);
+        this->pos.unmakeMove();
+        if(this->stopped){
+            return 0;
+        }
+        if(score > bestScore){
+            bestScore = score;
+            if(score > alpha){
+                alpha = score;
+                if(score >= beta){
+                    break;
+                }
+            }
+        }
+    }
+    return bestScore;
+}
+
+/*
+    Private method
+    Give every move a score so the moves most likely to be best are searched first
+*/
+void Search::scoreMoves(MoveList& moves, int* scores, int ply, PackedMove hashMove){
+    TeamColor us = this->pos.getSideToMove();
+    for(int i=0; i < moves.size; i++){
+        PackedMove m = moves.moves[i];
+        if(m == hashMove){
+            scores[i] = ORDER_BEST;
+        }
+        else if(this->isCapture(m)){
+            PieceType victim = (moveSpecial(m) == EnPassant) ? Pawn : this->pos.getType(moveDest(m));
+            scores[i] = ORDER_CAPTURE + orderValue[victim] * 8 - orderValue[this->pos.getType(moveSource(m))];
+        }
+        else if(moveSpecial(m) == PawnPromo){
+            scores[i] = ORDER_PROMOTION + orderValue[movePromotion(m)];
+        }
+        else if(m == this->killers[ply][0]){
+            scores[i] = ORDER_KILLER + 1;
+        }
+        else if(m == this->killers[ply][1]){
+            scores[i] = ORDER_KILLER;
+        }
+        else{
+            scores[i] = this->history[us][moveSource(m)][moveDest(m)];
+        }
+    }
+}
+
+/*
+    Private method
+    Move the best scored move from 'start' onwards to 'start' and return it. Cutoffs usually happen
+     after the first few moves, so this is cheaper than sorting the whole list.
+*/
+PackedMove Search::pickMove(MoveList& moves, int* scores, int start){
+    int best = start;
+    for(int i = start + 1; i < moves.size; i++){
+        if(scores[i] > scores[best]){
+            best = i;
+        }
+    }
+    swap(moves.moves[start], moves.moves[best]);
+    swap(scores[start], scores[best]);
+    return moves.moves[start];
+}
+
+// Private method
+bool Search::isCapture(PackedMove m){
+    return this->pos.getType(moveDest(m)) != NoPiece || moveSpecial(m) == EnPassant;
+}
+
+/*
+    Private method
+    Static evaluation of the current position with the evaluation the options ask for
+*/
+int Search::evaluate(){
+    return Evaluation::evaluate(this->pos, this->options.nnue);
+}
+
+/*
+    Private method
+    Score of a draw for the team to move 'ply' plies from the root. With contempt, the team to move
+     at the root counts a draw as a small loss, and its opponent as a small win.
+*/
+int Search::drawScore(int ply){
+    return (ply % 2 == 0) ? -this->options.contempt : this->options.contempt;
+}
+
+/*
+    Private method
+    Stop the search once the hard deadline passes
+*/
+bool Search::checkTime(){
+    if(this->ponderhitPending){
+        this->ponderhitPending = false;
+        this->timer.ponderhit();
+    }
+    uint64_t searched = this->nodes.load(memory_order_relaxed);
+    if(!this->stopped && (this->timer.hardExpired(searched) || (this->nodeLimit > 0 && searched >= this->nodeLimit))){
+        this->stopped = true;
+    }
+    return this->stopped;
+}
+
+/*
+    Private method
+    Only this thread writes 'nodes', so a plain load and store is enough for other threads to read it
+*/
+void Search::countNode(){
+    this->nodes.store(this->nodes.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+// Private method
+void Search::clearHeuristics(){
+    memset(this->killers, 0, sizeof(this->killers));
+    memset(this->history, 0, sizeof(this->history));
+    memset(this->pvLength, 0, sizeof(this->pvLength));
+}
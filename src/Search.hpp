@@ -0,0 +1,91 @@
+#ifndef Search_H
+#define Search_H
+
+#include "Position.hpp"
+#include "TimeManager.hpp"
+#include "TranspositionTable.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+using namespace std;
+
+const int MAX_PLY = 128;
+const int INF_SCORE = 32000;
+const int MATE_SCORE = 31000;                   // score for mating on this move. Mate in n plies is MATE_SCORE - n.
+const int MATE_BOUND = MATE_SCORE - MAX_PLY;    // scores above this are mates
+
+/*
+    Outcome of a search. Scores are in centipawns from the point of view of the team to move.
+*/
+struct SearchResult {
+    PackedMove bestMove = NULL_MOVE;
+    PackedMove ponderMove = NULL_MOVE;  // expected reply to bestMove
+    int score = 0;
+    int depth = 0;
+    uint64_t nodes = 0;
+    int64_t time = 0;                   // milliseconds
+    bool fromBook = false;
+    vector<PackedMove> pv;              // principal variation, starting with bestMove
+};
+
+/*
+    Settings that change how a Search plays, so engines built from the same code can be told apart
+*/
+struct SearchOptions {
+    bool nnue = true;       // evaluate with the network when one is loaded, otherwise the classical evaluation
+    int contempt = 0;       // centipawns the team to move at the root gives up to avoid a draw
+};
+
+/*
+    Alpha-beta search with iterative deepening and a quiescence search of captures.
+    A Search owns its own copy of the position, so one can run on each thread. Threads share their
+     results through the TranspositionTable they are given. stop() and ponderhit() can be called
+     from any thread.
+*/
+class Search {
+    Position pos;
+    TimeManager timer;
+    TranspositionTable* table;
+    SearchOptions options;
+    atomic<bool> stopped;
+    atomic<bool> ponderhitPending;
+    atomic<uint64_t> nodes;                 // only written by the searching thread
+    uint64_t nodeLimit;
+    int threadIndex;                        // 0 for the main thread. Helpers start at other depths.
+    function<void(SearchResult&)> infoCallback;
+    PackedMove rootBest;                    // best move of the last completed iteration, searched first
+    PackedMove killers[MAX_PLY][2];         // quiet moves that caused a beta cutoff at each ply
+    int history[3][64][64];                 // [TeamColor][source][destination] quiet move cutoff scores
+    PackedMove pv[MAX_PLY][MAX_PLY];        // principal variation found at each ply
+    int pvLength[MAX_PLY];
+
+    public:
+        Search(TranspositionTable*);
+        ~Search();
+        SearchResult think(Position&, TimeControl);
+        void stop();
+        void ponderhit();
+        bool isStopped();
+        uint64_t getNodes();
+        void clearNodes();
+        void setThreadIndex(int);
+        void setInfoCallback(function<void(SearchResult&)>);
+        void setOptions(SearchOptions);
+
+    private:
+        int negamax(int, int, int, int);
+        int quiescence(int, int, int);
+        void scoreMoves(MoveList&, int*, int, PackedMove);
+        PackedMove pickMove(MoveList&, int*, int);
+        bool isCapture(PackedMove);
+        int evaluate();
+        int drawScore(int);
+        bool checkTime();
+        void countNode();
+        void clearHeuristics();
+};
+
+#endif
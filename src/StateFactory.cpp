@@ -1,9 +1,10 @@
 #include "StateFactory.hpp"
 #include "Piece.hpp"
 #include "ChessException.hpp"
-#include "Gamestate.hpp"
 #include "Board.hpp"
+#include "Position.hpp"
 #include "Debug.hpp"
+#include "Stats.hpp"
 
 #include <vector>
 #include <iostream>
@@ -13,49 +14,6 @@
 
 using namespace std;
 
-/**
-    Static method
-    Loads a pre-constructed game state into a Gamestate object
-    @param gs The Gamestate object to load the state into
-    @param state The string vector that contains all values of the state to load
-    @returns nothing
-*/
-void StateFactory::loadState(Gamestate* gs, vector<string> state){
-    // parse turn, turn count, capture delta
-    if(state.size() != 4){
-        throw ChessException("StateFactory.cpp: State length is invalid");
-    }
-    if( !regex_match(state[0], STATE_REGEX_TURN_REP)){
-        throw ChessException("StateFactory.cpp: State TurnValue invalid");
-    }
-    if( !regex_match(state[1], STATE_REGEX_COUNT_REP)){
-        throw ChessException("StateFactory.cpp: State TurnCount invalid!");
-    }
-    if( !regex_match(state[2], STATE_REGEX_DELTA_REP)){
-        throw ChessException("StateFactory.cpp: State CaptureDelta invalid!");
-    }
-
-    TeamColor turnTeam = NoColor;
-    if(state[0] == "r"){
-        turnTeam = Red;
-    }
-    else if(state[0] == "b"){
-        turnTeam = Black;
-    }
-    else if(state[0] == "n"){
-        turnTeam = NoColor;
-    }
-
-    // pparse this from string to int
-    int turnCount = stoi(state[1]);
-    int captureDelta = stoi(state[2]);
-    // Update Gamestate board object
-    loadBoard(gs->getBoard(), state[3], turnCount);
-    // Update other members
-    gs->setCurrentTeamTurn(turnTeam);
-    gs->setCaptureDelta(captureDelta);
-}
-
 /**
     Static method
     Loads a pre-constructed board state into a Board object
@@ -88,6 +46,7 @@ Piece* StateFactory::build(string str, int count){
 
     // Examine each string representing a Piece and create the object then add to array
     Piece* pieces = new Piece[64]; // Internal board for Board object is 64. A chess board is 8*8 squares.
+    Stats::count(PieceAllocStat);
     // Board has 64 squares, the extra +1 is from the trailing ' ' included in the board state string.
     if(allSquares.size() != 65){
         /** DEBUG: */
@@ -161,4 +120,310 @@ Piece* StateFactory::build(string str, int count){
     }
 
     return pieces;
-}
\ No newline at end of file
+}
+
+// Letters for each PieceType in FEN, lower case. Indexed by PieceType.
+const char FEN_PIECE_LETTERS[7] = { ' ', 'k', 'q', 'r', 'b', 'n', 'p' };
+
+static bool isFenSpace(char c){
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static PieceType fenPieceType(char c){
+    switch(c){
+        case 'k': case 'K': return King;
+        case 'q': case 'Q': return Queen;
+        case 'r': case 'R': return Rook;
+        case 'b': case 'B': return Bishop;
+        case 'n': case 'N': return Knight;
+        case 'p': case 'P': return Pawn;
+        default: return NoPiece;
+    }
+}
+
+// Write a non-negative number and move 'out' past it
+static void writeFenNumber(char*& out, int value){
+    char digits[12];
+    int count = 0;
+    do{
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while(value > 0);
+    while(count > 0){
+        *out++ = digits[--count];
+    }
+}
+
+/**
+    Static method
+    Read a record in Forsyth-Edwards Notation in a single pass, without allocating.
+    The castling, En Passant and move counter fields may be left out.
+    @param fen The record
+    @param record Set to the contents of the record
+    @returns nothing
+    @throws ChessException if the record can't be parsed
+*/
+void StateFactory::parseFen(string_view fen, FenRecord& record){
+    size_t pos = 0;
+    size_t length = fen.size();
+    // Only builds the message when the record is bad, so good records never allocate
+    auto fail = [fen](const char* reason){
+        throw ChessException(string("StateFactory.cpp: ") + reason + ": " + string(fen));
+    };
+    auto skipSpaces = [&fen, &pos, length](){
+        while(pos < length && isFenSpace(fen[pos])) pos++;
+    };
+    auto fieldEnded = [&fen, &pos, length](){
+        return pos >= length || isFenSpace(fen[pos]);
+    };
+
+    // Piece placement, rank 8 first
+    for(int i=0; i < 64; i++){
+        record.squareTeam[i] = NoColor;
+        record.squareType[i] = NoPiece;
+    }
+    skipSpaces();
+    int index = 0;
+    int file = 0;
+    for(; !fieldEnded(); pos++){
+        char c = fen[pos];
+        if(c == '/'){
+            if(file != 8 || index >= 64) fail("FEN rank has the wrong number of squares");
+            file = 0;
+        }
+        else if(c >= '1' && c <= '8'){
+            int run = c - '0';
+            if(file + run > 8) fail("FEN rank has the wrong number of squares");
+            index += run;
+            file += run;
+        }
+        else{
+            PieceType pt = fenPieceType(c);
+            if(pt == NoPiece) fail("Invalid FEN piece placement");
+            if(file == 8) fail("FEN rank has the wrong number of squares");
+            record.squareTeam[index] = (c < 'a') ? Red : Black;
+            record.squareType[index] = pt;
+            index++;
+            file++;
+        }
+    }
+    if(index != 64 || file != 8) fail("FEN piece placement doesn't have 64 squares");
+
+    // Team to move
+    skipSpaces();
+    if(pos >= length) fail("FEN needs the team to move");
+    if(fen[pos] == 'w') record.turn = Red;
+    else if(fen[pos] == 'b') record.turn = Black;
+    else fail("FEN team to move must be 'w' or 'b'");
+    pos++;
+    if(!fieldEnded()) fail("FEN team to move must be 'w' or 'b'");
+
+    // Castling rights
+    record.castlingRights = 0;
+    skipSpaces();
+    if(pos < length && fen[pos] == '-'){
+        pos++;
+    }
+    else{
+        for(; !fieldEnded(); pos++){
+            switch(fen[pos]){
+                case 'K': record.castlingRights |= RED_KINGSIDE; break;
+                case 'Q': record.castlingRights |= RED_QUEENSIDE; break;
+                case 'k': record.castlingRights |= BLACK_KINGSIDE; break;
+                case 'q': record.castlingRights |= BLACK_QUEENSIDE; break;
+                default: fail("Invalid FEN castling rights");
+            }
+        }
+    }
+    if(!fieldEnded()) fail("Invalid FEN castling rights");
+
+    // En Passant square
+    record.enPassantIndex = -1;
+    skipSpaces();
+    if(pos < length && fen[pos] == '-'){
+        pos++;
+    }
+    else if(pos < length){
+        if(pos + 1 >= length || fen[pos] < 'a' || fen[pos] > 'h' || (fen[pos + 1] != '3' && fen[pos + 1] != '6')){
+            fail("Invalid FEN En Passant square");
+        }
+        record.enPassantIndex = ('8' - fen[pos + 1]) * 8 + (fen[pos] - 'a');
+        pos += 2;
+    }
+    if(!fieldEnded()) fail("Invalid FEN En Passant square");
+
+    // Move counters
+    int* counters[2] = { &record.halfmoveClock, &record.fullmoveNumber };
+    record.halfmoveClock = 0;
+    record.fullmoveNumber = 1;
+    for(int* counter : counters){
+        skipSpaces();
+        if(pos >= length){
+            break;
+        }
+        int value = 0;
+        for(; !fieldEnded(); pos++){
+            if(fen[pos] < '0' || fen[pos] > '9' || value > 100000000) fail("Invalid FEN move counter");
+            value = value * 10 + (fen[pos] - '0');
+        }
+        *counter = value;
+    }
+    skipSpaces();
+    if(pos < length) fail("Unexpected text after FEN record");
+}
+
+/**
+    Static method
+    Write a record in Forsyth-Edwards Notation without allocating
+    @param record The position to write
+    @param out Buffer of at least FEN_MAX_LENGTH chars. The record is terminated with '\0'.
+    @returns Length of the record, not counting the '\0'
+*/
+int StateFactory::writeFen(const FenRecord& record, char* out){
+    char* start = out;
+    for(int row=0; row < 8; row++){
+        int empty = 0;
+        for(int col=0; col < 8; col++){
+            int i = row*8 + col;
+            if(record.squareType[i] == NoPiece){
+                empty++;
+                continue;
+            }
+            if(empty > 0){
+                *out++ = '0' + empty;
+                empty = 0;
+            }
+            char letter = FEN_PIECE_LETTERS[record.squareType[i]];
+            *out++ = (record.squareTeam[i] == Red) ? letter - 'a' + 'A' : letter;
+        }
+        if(empty > 0){
+            *out++ = '0' + empty;
+        }
+        if(row < 7){
+            *out++ = '/';
+        }
+    }
+    *out++ = ' ';
+    *out++ = (record.turn == Black) ? 'b' : 'w';
+    *out++ = ' ';
+    if(record.castlingRights == 0){
+        *out++ = '-';
+    }
+    if(record.castlingRights & RED_KINGSIDE) *out++ = 'K';
+    if(record.castlingRights & RED_QUEENSIDE) *out++ = 'Q';
+    if(record.castlingRights & BLACK_KINGSIDE) *out++ = 'k';
+    if(record.castlingRights & BLACK_QUEENSIDE) *out++ = 'q';
+    *out++ = ' ';
+    if(record.enPassantIndex < 0){
+        *out++ = '-';
+    }
+    else{
+        *out++ = 'a' + record.enPassantIndex % 8;
+        *out++ = '8' - record.enPassantIndex / 8;
+    }
+    *out++ = ' ';
+    writeFenNumber(out, max(0, record.halfmoveClock));
+    *out++ = ' ';
+    writeFenNumber(out, max(1, record.fullmoveNumber));
+    *out = '\0';
+    return (int) (out - start);
+}
+
+/**
+    Static method
+    @param record The position to write
+    @returns The record in Forsyth-Edwards Notation
+*/
+string StateFactory::toFen(const FenRecord& record){
+    char buffer[FEN_MAX_LENGTH];
+    int length = writeFen(record, buffer);
+    return string(buffer, length);
+}
+
+/**
+    Static method
+    Builds an array of length 64 for use as a Board object's 'internalboard' member, like build().
+    FEN has no move counts, so they are made up from what the record does say: kings and rooks that
+     lost their castling rights and pawns off their starting row have moved, and a pawn that can be
+     captured En Passant has just made its first move.
+    @param record The position
+    @param count The Board's turn count for the position
+    @returns An array of Piece objects
+*/
+Piece* StateFactory::buildFen(const FenRecord& record, int count){
+    Piece* pieces = new Piece[64]; // Internal board for Board object is 64. A chess board is 8*8 squares.
+    Stats::count(PieceAllocStat);
+    for(int i=0; i < 64; i++){
+        if(record.squareType[i] == NoPiece){
+            pieces[i].setNull();
+        }
+        else{
+            pieces[i].init(record.squareTeam[i], record.squareType[i], 0);
+        }
+    }
+    auto markMoved = [pieces](int index, TeamColor tc, PieceType pt){
+        if(pieces[index].getTeam() == tc && pieces[index].getType() == pt){
+            pieces[index].init(tc, pt, 1);
+        }
+    };
+    if( !(record.castlingRights & (RED_KINGSIDE | RED_QUEENSIDE))) markMoved(60, Red, King);
+    if( !(record.castlingRights & RED_KINGSIDE)) markMoved(63, Red, Rook);
+    if( !(record.castlingRights & RED_QUEENSIDE)) markMoved(56, Red, Rook);
+    if( !(record.castlingRights & (BLACK_KINGSIDE | BLACK_QUEENSIDE))) markMoved(4, Black, King);
+    if( !(record.castlingRights & BLACK_KINGSIDE)) markMoved(7, Black, Rook);
+    if( !(record.castlingRights & BLACK_QUEENSIDE)) markMoved(0, Black, Rook);
+    for(int i=0; i < 64; i++){
+        // Red pawns start on row 6, Black pawns on row 1
+        if(record.squareType[i] == Pawn && i / 8 != ((record.squareTeam[i] == Red) ? 6 : 1)){
+            markMoved(i, record.squareTeam[i], Pawn);
+        }
+    }
+    if(record.enPassantIndex >= 0){
+        // The pawn that just moved is one row past the En Passant square
+        TeamColor moved = (record.turn == Red) ? Black : Red;
+        int pawnIndex = record.enPassantIndex + ((moved == Black) ? 8 : -8);
+        if(pawnIndex >= 0 && pawnIndex < 64 && pieces[pawnIndex].getTeam() == moved && pieces[pawnIndex].getType() == Pawn){
+            pieces[pawnIndex].setEnPassantCapture(true, count - 1);
+        }
+    }
+    return pieces;
+}
+
+/**
+    Static method
+    Describe a Board as a FEN record. Castling rights come from kings and rooks that never moved.
+    @param b The Board to read
+    @param turn The team whose turn it is
+    @param captureDelta Moves since the last capture, written as the halfmove clock
+    @param record Set to the position
+    @returns nothing
+*/
+void StateFactory::readBoard(Board* b, TeamColor turn, int captureDelta, FenRecord& record){
+    TeamColor opponent = (turn == Red) ? Black : Red;
+    record.enPassantIndex = -1;
+    for(int i=0; i < 64; i++){
+        Piece p = b->getPiece(i);
+        record.squareTeam[i] = p.getNull() ? NoColor : p.getTeam();
+        record.squareType[i] = p.getNull() ? NoPiece : p.getType();
+        // Same rule as Position::load: only the opponent's pawn that just moved can be captured
+        if( !p.getNull() && p.getType() == Pawn && p.getEnPassantCapture() && p.getTeam() == opponent){
+            record.enPassantIndex = (opponent == Black) ? i - 8 : i + 8;
+        }
+    }
+    auto unmoved = [b](int index, TeamColor tc, PieceType pt) -> bool {
+        Piece p = b->getPiece(index);
+        return p.getTeam() == tc && p.getType() == pt && p.getNumMoves() == 0;
+    };
+    record.castlingRights = 0;
+    if(unmoved(60, Red, King)){
+        if(unmoved(63, Red, Rook)) record.castlingRights |= RED_KINGSIDE;
+        if(unmoved(56, Red, Rook)) record.castlingRights |= RED_QUEENSIDE;
+    }
+    if(unmoved(4, Black, King)){
+        if(unmoved(7, Black, Rook)) record.castlingRights |= BLACK_KINGSIDE;
+        if(unmoved(0, Black, Rook)) record.castlingRights |= BLACK_QUEENSIDE;
+    }
+    record.turn = (turn == Black) ? Black : Red;
+    record.halfmoveClock = captureDelta;
+    record.fullmoveNumber = max(1, (b->getTurnCount() + 1) / 2);
+}
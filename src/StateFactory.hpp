@@ -2,10 +2,13 @@
 #define StateFactory_H
 
 #include "Piece.hpp"
-#include "Gamestate.hpp"
 #include "Board.hpp"
 
 #include <iostream>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
 
 using namespace std;
 
@@ -327,12 +330,35 @@ const vector<string> STATE_7 =
     "bp bp rp rp rp rp -- -- "
     "-- rn rb rq rk rb rn rr "};
 
+/*
+    A position in Forsyth-Edwards Notation, unpacked. Squares use the Board's indices, so index 0 is A8.
+    Red plays the white (upper case) pieces.
+    Nothing is checked beyond the syntax: an empty board or a castling right without a rook is kept
+     as written. Board and Position decide what they can use.
+*/
+struct FenRecord {
+    TeamColor squareTeam[64];
+    PieceType squareType[64];
+    TeamColor turn;
+    int castlingRights;     // RED_KINGSIDE | RED_QUEENSIDE | BLACK_KINGSIDE | BLACK_QUEENSIDE
+    int enPassantIndex;     // -1 if the record has '-'
+    int halfmoveClock;
+    int fullmoveNumber;
+};
+
+const int FEN_MAX_LENGTH = 128;  // writeFen never writes more than this, including the terminating '\0'
+
 class StateFactory
 {
     public:
-        static void loadState(Gamestate*, vector<string>);
         static void loadBoard(Board*, string, int);
         static Piece* build(string, int);
+        // Forsyth-Edwards Notation
+        static void parseFen(string_view, FenRecord&);
+        static int writeFen(const FenRecord&, char*);
+        static string toFen(const FenRecord&);
+        static Piece* buildFen(const FenRecord&, int);
+        static void readBoard(Board*, TeamColor, int, FenRecord&);
 };
 
 #endif
\ No newline at end of file
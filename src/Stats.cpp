@@ -0,0 +1,187 @@
+#include "Stats.hpp"
+#include "Util.hpp"
+#include "Debug.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+    Counts of one thread. Only the thread writes them, other threads read them in collect().
+*/
+struct StatBlock {
+    atomic<uint64_t> calls[STAT_COUNT];
+    atomic<uint64_t> nanos[STAT_COUNT];
+
+    StatBlock(){
+        for(int i=0; i < STAT_COUNT; i++){
+            this->calls[i].store(0, memory_order_relaxed);
+            this->nanos[i].store(0, memory_order_relaxed);
+        }
+    }
+};
+
+static mutex blockMutex;            // guards blocks, finished and baseline
+static vector<StatBlock*> blocks;   // of running threads
+static StatTotals finished;         // counts of threads that have ended
+static StatTotals baseline;         // totals at the last reset()
+
+/*
+    Registers the block of a thread on its first count, and moves its counts to 'finished' when the
+     thread ends
+*/
+struct StatThread {
+    StatBlock* block;
+
+    StatThread(){
+        this->block = new StatBlock();
+        lock_guard<mutex> lock(blockMutex);
+        blocks.push_back(this->block);
+    }
+
+    ~StatThread(){
+        lock_guard<mutex> lock(blockMutex);
+        for(int i=0; i < STAT_COUNT; i++){
+            finished.calls[i] += this->block->calls[i].load(memory_order_relaxed);
+            finished.nanos[i] += this->block->nanos[i].load(memory_order_relaxed);
+        }
+        blocks.erase(find(blocks.begin(), blocks.end(), this->block));
+        delete this->block;
+    }
+};
+
+static StatBlock& threadBlock(){
+    static thread_local StatThread local;
+    return *local.block;
+}
+
+// Add to a counter of this thread. Nothing else writes it, so this needs no atomic read-modify-write.
+static void add(atomic<uint64_t>& counter, uint64_t amount){
+    counter.store(counter.load(memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+// Sum of every thread's counts since the program started. blockMutex must be held.
+static StatTotals sumAll(){
+    StatTotals total = finished;
+    for(StatBlock* block : blocks){
+        for(int i=0; i < STAT_COUNT; i++){
+            total.calls[i] += block->calls[i].load(memory_order_relaxed);
+            total.nanos[i] += block->nanos[i].load(memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+
+// Counting ===================================
+
+/**
+    Static method
+    Count one call or allocation on this thread
+*/
+void Stats::count(StatCounter counter){
+    if( !STATS_MODE){
+        return;
+    }
+    add(threadBlock().calls[counter], 1);
+}
+
+/**
+    Static method
+    Count one call that took 'nanos' on this thread
+*/
+void Stats::addTime(StatCounter counter, uint64_t nanos){
+    if( !STATS_MODE){
+        return;
+    }
+    StatBlock& block = threadBlock();
+    add(block.calls[counter], 1);
+    add(block.nanos[counter], nanos);
+}
+
+StatTimer::StatTimer(StatCounter c){
+    this->counter = c;
+    if(STATS_MODE){
+        this->start = chrono::steady_clock::now();
+    }
+}
+
+StatTimer::~StatTimer(){
+    if(STATS_MODE){
+        auto nanos = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - this->start).count();
+        Stats::addTime(this->counter, (uint64_t) nanos);
+    }
+}
+
+
+// Reporting ===================================
+
+/**
+    Static method
+    @returns The counts of every thread since the program started or since the last reset()
+*/
+StatTotals Stats::collect(){
+    lock_guard<mutex> lock(blockMutex);
+    StatTotals total = sumAll();
+    for(int i=0; i < STAT_COUNT; i++){
+        total.calls[i] -= baseline.calls[i];
+        total.nanos[i] -= baseline.nanos[i];
+    }
+    return total;
+}
+
+/**
+    Static method
+    Start counting from 0. Threads keep their own blocks, so this only moves the baseline collect()
+     subtracts.
+*/
+void Stats::reset(){
+    lock_guard<mutex> lock(blockMutex);
+    baseline = sumAll();
+}
+
+/**
+    Static method
+    @returns A table of the counts, one line per counter, ending with a newline
+*/
+string Stats::report(){
+    if( !STATS_MODE){
+        return "Stats are off. Set STATS_MODE in Debug.hpp to count them.\n";
+    }
+    StatTotals total = Stats::collect();
+    string text = string_format("%-24s %10s %12s %10s\n", "Hot path", "calls", "total ms", "ns/call");
+    for(int i=0; i < STAT_TIMED_COUNT; i++){
+        uint64_t average = (total.calls[i] == 0) ? 0 : total.nanos[i] / total.calls[i];
+        text += string_format("%-24s %10llu %12.3f %10llu\n", Stats::getName((StatCounter) i),
+            (unsigned long long) total.calls[i], total.nanos[i] / 1e6, (unsigned long long) average);
+    }
+    text += string_format("%-24s %10s\n", "Allocations", "count");
+    for(int i=STAT_TIMED_COUNT; i < STAT_COUNT; i++){
+        text += string_format("%-24s %10llu\n", Stats::getName((StatCounter) i), (unsigned long long) total.calls[i]);
+    }
+    return text;
+}
+
+/**
+    Static method
+    @returns The name a counter is reported under
+*/
+const char* Stats::getName(StatCounter counter){
+    switch(counter){
+        case(MoveGenStat):      return "Move::calcAllMoves";
+        case(MovesetStat):      return "Move::calcMovesetMoves";
+        case(CheckStat):        return "Board::isCheck";
+        case(CheckmateStat):    return "Board::isCheckmate";
+        case(CloneStat):        return "Board::clone";
+        case(RenderStat):       return "Board::render";
+        case(DrawStat):         return "Renderer::draw";
+        case(BoardAllocStat):   return "Board arrays";
+        case(MoveAllocStat):    return "Move";
+        case(PieceAllocStat):   return "StateFactory pieces";
+    }
+    return "";
+}
@@ -0,0 +1,63 @@
+#ifndef Stats_H
+#define Stats_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+/*
+    Counters of the hot paths of the console game: how often each was called and how long the calls
+     took altogether, and how many objects were allocated.
+
+    Every thread counts into its own block, which only that thread writes, so counting never waits
+     for another thread. Stats::collect() adds the blocks up when asked, along with the counts of
+     threads that have ended. Times include the time of nested calls, e.g. calcAllMoves includes the
+     isCheck calls it makes. Nothing is counted when STATS_MODE in Debug.hpp is false.
+*/
+enum StatCounter {
+    // Counted and timed
+    MoveGenStat,        // Move::calcAllMoves
+    MovesetStat,        // Move::calcMovesetMoves
+    CheckStat,          // Board::isCheck
+    CheckmateStat,      // Board::isCheckmate
+    CloneStat,          // Board::clone
+    RenderStat,         // Board::render
+    DrawStat,           // Renderer::draw, a whole frame written to the terminal
+    // Counted only
+    BoardAllocStat,     // square and display arrays of a Board
+    MoveAllocStat,      // Move objects
+    PieceAllocStat      // Piece arrays built by StateFactory
+};
+const int STAT_COUNT = PieceAllocStat + 1;
+const int STAT_TIMED_COUNT = DrawStat + 1;  // counters before this one are timed
+
+struct StatTotals {
+    uint64_t calls[STAT_COUNT] = {};
+    uint64_t nanos[STAT_COUNT] = {};
+};
+
+class Stats {
+    public:
+        static void count(StatCounter);
+        static void addTime(StatCounter, uint64_t);
+        static StatTotals collect();
+        static void reset();
+        static string report();
+        static const char* getName(StatCounter);
+};
+
+/*
+    Counts a call of a timed counter, and the time until the timer goes out of scope
+*/
+class StatTimer {
+    StatCounter counter;
+    chrono::steady_clock::time_point start;
+
+    public:
+        StatTimer(StatCounter);
+        ~StatTimer();
+};
+
+#endif
@@ -0,0 +1,518 @@
+#include "Tablebase.hpp"
+#include "Position.hpp"
+#include "Bitboard.hpp"
+#include "ChessException.hpp"
+#include "Debug.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <map>
+#include <algorithm>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Letter used for each PieceType in signatures
+const char tbPieceLetter[7] = { ' ', 'K', 'Q', 'R', 'B', 'N', 'P' };
+
+// Tables available to probe(), by signature
+static map<string, Tablebase*> tables;
+
+/*
+    Squares the stronger king can be moved to by symmetry. Without pawns that is the A1-D1-D4
+     triangle, with pawns it is files A-D.
+*/
+struct KingSlots {
+    int triangleSlot[64];   // -1 outside the triangle
+    int triangleSquare[10];
+};
+
+static KingSlots buildKingSlots(){
+    KingSlots k;
+    int slot = 0;
+    for(int i=0; i < 64; i++){
+        int rank = 7 - i / 8;
+        int col = i % 8;
+        k.triangleSlot[i] = -1;
+        if(col < 4 && rank <= col){
+            k.triangleSlot[i] = slot;
+            k.triangleSquare[slot++] = i;
+        }
+    }
+    return k;
+}
+
+static const KingSlots kingSlots = buildKingSlots();
+
+static PieceType letterType(char c){
+    for(int pt = King; pt <= Pawn; pt++){
+        if(tbPieceLetter[pt] == c){
+            return (PieceType) pt;
+        }
+    }
+    return NoPiece;
+}
+
+static int sideValue(string side){
+    int value = 0;
+    for(char c : side){
+        value += (c == 'K') ? 0 : seeValue[letterType(c)];
+    }
+    return value;
+}
+
+/**
+    @param signature Material signature, e.g. "KRKP". Throws ChessException if it isn't valid.
+*/
+Tablebase::Tablebase(string signature){
+    if(!validSignature(signature)){
+        throw ChessException("Tablebase.cpp: Invalid material signature");
+    }
+    this->signature = signature;
+    this->pieceCount = signature.size();
+    this->pawns = signature.find('P') != string::npos;
+    TeamColor team = Black;
+    for(int i=0; i < this->pieceCount; i++){
+        PieceType pt = letterType(signature[i]);
+        if(pt == King){
+            team = (team == Red) ? Black : Red;
+        }
+        this->types[i] = pt;
+        this->teams[i] = team;
+    }
+    this->entryCount = (this->pawns ? 32 : 10) * 2;
+    for(int i=1; i < this->pieceCount; i++){
+        this->entryCount *= 64;
+    }
+    this->codes = NULL;
+    this->mapped = NULL;
+    this->mappedSize = 0;
+}
+
+Tablebase::~Tablebase(){
+    if(this->mapped != NULL){
+        munmap((void*) this->mapped, this->mappedSize);
+    }
+}
+
+// Loading ===================================
+
+/**
+    Map a table file into memory
+    @param path Location of the .cctb file
+    @returns nothing. Throws ChessException if the file can't be used.
+*/
+void Tablebase::map(string path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw ChessException("Tablebase.cpp: Could not open tablebase file");
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        close(fd);
+        throw ChessException("Tablebase.cpp: Could not read tablebase file size");
+    }
+    size_t expected = TB_HEADER_SIZE + this->entryCount;
+    if((size_t) st.st_size != expected){
+        close(fd);
+        throw ChessException("Tablebase.cpp: Tablebase file has the wrong size");
+    }
+    void* mem = mmap(NULL, expected, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mem == MAP_FAILED){
+        throw ChessException("Tablebase.cpp: Could not map tablebase file");
+    }
+    const uint8_t* data = (const uint8_t*) mem;
+    uint32_t version;
+    char signature[9] = { 0 };
+    memcpy(&version, data + 4, sizeof(version));
+    memcpy(signature, data + 8, 8);
+    if(memcmp(data, "CCTB", 4) != 0 || version != TB_VERSION || this->signature != signature){
+        munmap(mem, expected);
+        throw ChessException("Tablebase.cpp: Tablebase file header doesn't match its signature");
+    }
+    if(this->mapped != NULL){
+        munmap((void*) this->mapped, this->mappedSize);
+    }
+    this->mapped = data;
+    this->mappedSize = expected;
+    this->codes = data + TB_HEADER_SIZE;
+}
+
+/**
+    Use codes held in memory instead of a file. The caller keeps ownership of the codes.
+    @param data entryCount codes
+*/
+void Tablebase::setCodes(const uint8_t* data){
+    this->codes = data;
+}
+
+/**
+    Write the table to a file
+    @param path Location of the .cctb file to create
+    @returns nothing. Throws ChessException if the file can't be written.
+*/
+void Tablebase::write(string path){
+    ofstream out(path, ios::binary);
+    if(!out || this->codes == NULL){
+        throw ChessException("Tablebase.cpp: Could not write tablebase file");
+    }
+    char header[TB_HEADER_SIZE] = { 0 };
+    uint32_t version = TB_VERSION;
+    uint64_t entries = this->entryCount;
+    memcpy(header, "CCTB", 4);
+    memcpy(header + 4, &version, sizeof(version));
+    memcpy(header + 8, this->signature.c_str(), this->signature.size());
+    memcpy(header + 16, &entries, sizeof(entries));
+    out.write(header, TB_HEADER_SIZE);
+    out.write((const char*) this->codes, this->entryCount);
+    if(!out){
+        throw ChessException("Tablebase.cpp: Could not write tablebase file");
+    }
+}
+
+// Indexing ===================================
+
+/*
+    Private method
+    Apply a symmetry to an index. Bit 0 mirrors files, bit 1 mirrors rows, bit 2 mirrors along the
+     A1-H8 diagonal.
+*/
+int Tablebase::transform(int index, int t){
+    if(t & 1) index ^= 7;
+    if(t & 2) index ^= 56;
+    if(t & 4) index = (7 - index % 8) * 8 + (7 - index / 8);
+    return index;
+}
+
+/**
+    Index of a position in this table. The position's material must match the table's signature.
+    @param pos The Position to index
+    @returns Entry index
+*/
+size_t Tablebase::index(Position& pos){
+    // Tables store the stronger team as Red
+    bool flip = sideString(pos, Red) + sideString(pos, Black) != this->signature;
+    int squares[TB_MAX_PIECES] = {};
+    int i = 0;
+    while(i < this->pieceCount){
+        int groupStart = i;
+        TeamColor tc = this->teams[i];
+        if(flip){
+            tc = (tc == Red) ? Black : Red;
+        }
+        Bitboard bb = pos.getPieces(tc, this->types[i]);
+        while(bb && i < this->pieceCount){
+            int sq = Bitboards::popLsb(bb);
+            squares[i++] = flip ? sq ^ 56 : sq;
+        }
+        if(i == groupStart){
+            throw ChessException("Tablebase.cpp: Position doesn't match the table's signature");
+        }
+    }
+    TeamColor toMove = pos.getSideToMove();
+    if(flip){
+        toMove = (toMove == Red) ? Black : Red;
+    }
+
+    // Move the stronger king into its symmetry region
+    int king = squares[0];
+    int t = 0;
+    if(king % 8 >= 4){
+        t |= 1;
+    }
+    if(!this->pawns){
+        if(king / 8 < 4){
+            t |= 2;
+        }
+        int k = transform(king, t);
+        if(7 - k / 8 > k % 8){
+            t |= 4;
+        }
+        // A king on the diagonal fits both ways. Use whichever gives the smaller index.
+        else if(7 - k / 8 == k % 8){
+            size_t idx = min(this->squaresIndex(squares, t), this->squaresIndex(squares, t | 4));
+            return idx * 2 + (toMove == Black);
+        }
+    }
+    size_t idx = this->squaresIndex(squares, t);
+    return idx * 2 + (toMove == Black);
+}
+
+/*
+    Private method
+    Index of the piece squares after applying a symmetry, without the team to move
+*/
+size_t Tablebase::squaresIndex(const int* original, int t){
+    int squares[TB_MAX_PIECES] = {};
+    for(int j=0; j < this->pieceCount; j++){
+        squares[j] = transform(original[j], t);
+    }
+    // Equal pieces are stored in ascending order so each position has one index
+    for(int j=1; j < this->pieceCount; j++){
+        int k = j;
+        while(k > 1 && this->types[k - 1] == this->types[k] && this->teams[k - 1] == this->teams[k] && squares[k - 1] > squares[k]){
+            swap(squares[k - 1], squares[k]);
+            k--;
+        }
+    }
+    size_t idx = this->pawns ? (squares[0] / 8) * 4 + squares[0] % 8 : kingSlots.triangleSlot[squares[0]];
+    for(int j=1; j < this->pieceCount; j++){
+        idx = idx * 64 + squares[j];
+    }
+    return idx;
+}
+
+/**
+    Set up the position stored at an index
+    @param idx Entry index
+    @param pos The Position to set up. Cleared first.
+    @returns true if the index is a legal position
+*/
+bool Tablebase::decode(size_t idx, Position& pos){
+    TeamColor toMove = (idx & 1) ? Black : Red;
+    idx >>= 1;
+    int squares[TB_MAX_PIECES];
+    for(int j = this->pieceCount - 1; j > 0; j--){
+        squares[j] = idx % 64;
+        idx /= 64;
+    }
+    squares[0] = this->pawns ? (idx / 4) * 8 + idx % 4 : kingSlots.triangleSquare[idx];
+
+    Bitboard occupied = EMPTY_BB;
+    for(int j=0; j < this->pieceCount; j++){
+        Bitboard bb = Bitboards::squareBB(squares[j]);
+        if((occupied & bb) || (this->types[j] == Pawn && (bb & (ROW_0_BB | ROW_7_BB)))){
+            return false;
+        }
+        occupied |= bb;
+    }
+    pos.clear();
+    for(int j=0; j < this->pieceCount; j++){
+        pos.putPiece(squares[j], this->teams[j], this->types[j]);
+    }
+    pos.setSideToMove(toMove);
+    // The team that just moved can't be in check. This also rejects kings next to each other.
+    TeamColor waiting = (toMove == Red) ? Black : Red;
+    return !pos.isAttacked(pos.getKingIndex(waiting), toMove);
+}
+
+uint8_t Tablebase::getCode(size_t idx){
+    return this->codes[idx];
+}
+
+// getters
+
+string Tablebase::getSignature(){
+    return this->signature;
+}
+
+size_t Tablebase::getEntryCount(){
+    return this->entryCount;
+}
+
+int Tablebase::getPieceCount(){
+    return this->pieceCount;
+}
+
+bool Tablebase::hasPawns(){
+    return this->pawns;
+}
+
+// Signatures ===================================
+
+/**
+    Join two teams' pieces into a signature with the stronger team first
+    @param a Pieces of one team, starting with "K"
+    @param b Pieces of the other team, starting with "K"
+    @returns Signature such as "KRKP". Pieces of each team are sorted Queen to Pawn.
+*/
+string Tablebase::canonicalSignature(string a, string b){
+    auto order = [](char x, char y){ return letterType(x) < letterType(y); };
+    sort(a.begin(), a.end(), order);
+    sort(b.begin(), b.end(), order);
+    int valueA = sideValue(a);
+    int valueB = sideValue(b);
+    if(valueA > valueB || (valueA == valueB && a >= b)){
+        return a + b;
+    }
+    return b + a;
+}
+
+/*
+    Private method
+    Pieces of one team, e.g. "KRP"
+*/
+string Tablebase::sideString(Position& pos, TeamColor tc){
+    string side;
+    for(int pt = King; pt <= Pawn; pt++){
+        side.append(Bitboards::popCount(pos.getPieces(tc, (PieceType) pt)), tbPieceLetter[pt]);
+    }
+    return side;
+}
+
+/**
+    Signature of the table a position belongs to
+    @param pos The Position
+    @param flip Set to true if the position has to be flipped because Black is the stronger team
+    @returns Signature
+*/
+string Tablebase::signatureOf(Position& pos, bool& flip){
+    string red = sideString(pos, Red);
+    string black = sideString(pos, Black);
+    string signature = canonicalSignature(red, black);
+    flip = signature != red + black;
+    return signature;
+}
+
+/**
+    Signatures a table's positions can turn into with a capture or promotion
+    @param signature Signature of the table
+    @returns Signatures of the tables needed to generate it, without duplicates or bare kings
+*/
+vector<string> Tablebase::childSignatures(string signature){
+    size_t split = signature.find('K', 1);
+    string sides[2] = { signature.substr(0, split), signature.substr(split) };
+    const char promotions[4] = { 'Q', 'R', 'B', 'N' };
+    vector<string> children;
+    auto addChild = [&](string a, string b){
+        if(a.size() + b.size() > 2){
+            string child = canonicalSignature(a, b);
+            if(std::find(children.begin(), children.end(), child) == children.end()){
+                children.push_back(child);
+            }
+        }
+    };
+    for(int s=0; s < 2; s++){
+        string& us = sides[s];
+        string& them = sides[1 - s];
+        for(size_t i=1; i < them.size(); i++){
+            // Capture one of their pieces
+            string captured = them;
+            captured.erase(i, 1);
+            addChild(us, captured);
+        }
+        for(size_t i=1; i < us.size(); i++){
+            if(us[i] != 'P'){
+                continue;
+            }
+            for(char promo : promotions){
+                string promoted = us;
+                promoted[i] = promo;
+                addChild(promoted, them);
+                // Promote by capturing
+                for(size_t j=1; j < them.size(); j++){
+                    string captured = them;
+                    captured.erase(j, 1);
+                    addChild(promoted, captured);
+                }
+            }
+        }
+    }
+    return children;
+}
+
+/**
+    @param signature Signature to check
+    @returns true if the signature is in canonical form with 3 or 4 pieces
+*/
+bool Tablebase::validSignature(string signature){
+    if(signature.size() < 3 || signature.size() > (size_t) TB_MAX_PIECES || signature[0] != 'K'){
+        return false;
+    }
+    size_t split = signature.find('K', 1);
+    if(split == string::npos || signature.find('K', split + 1) != string::npos){
+        return false;
+    }
+    for(char c : signature){
+        if(letterType(c) == NoPiece){
+            return false;
+        }
+    }
+    return canonicalSignature(signature.substr(0, split), signature.substr(split)) == signature;
+}
+
+// Probing ===================================
+
+/**
+    Map every .cctb file in a directory so it can be probed
+    @param dir Directory containing tablebase files
+    @returns nothing. Throws ChessException if the directory or a file can't be read.
+*/
+void Tablebase::init(string dir){
+    DIR* d = opendir(dir.c_str());
+    if(d == NULL){
+        throw ChessException("Tablebase.cpp: Could not open tablebase directory");
+    }
+    struct dirent* entry;
+    while((entry = readdir(d)) != NULL){
+        string name = entry->d_name;
+        if(name.size() <= 5 || name.substr(name.size() - 5) != ".cctb"){
+            continue;
+        }
+        string signature = name.substr(0, name.size() - 5);
+        if(!validSignature(signature) || find(signature) != NULL){
+            continue;
+        }
+        Tablebase* tb = new Tablebase(signature);
+        try{
+            tb->map(dir + "/" + name);
+        }
+        catch(const ChessException &cex){
+            delete tb;
+            closedir(d);
+            throw;
+        }
+        add(tb);
+    }
+    closedir(d);
+    if(DEBUG_MODE) cout << "Tablebase.cpp: Loaded " << tables.size() << " tables from " << dir << endl;
+}
+
+/**
+    Make a table available to probe(). Tables are never removed.
+    @param tb The table. Its codes must be set.
+*/
+void Tablebase::add(Tablebase* tb){
+    tables[tb->getSignature()] = tb;
+}
+
+/**
+    @param signature Signature of the table
+    @returns The table, or NULL if it isn't available
+*/
+Tablebase* Tablebase::find(string signature){
+    auto it = tables.find(signature);
+    return (it == tables.end()) ? NULL : it->second;
+}
+
+int Tablebase::getTableCount(){
+    return tables.size();
+}
+
+/**
+    Look up a position in the tablebases
+    @param pos The Position to look up
+    @param result Receives the result for the team to move
+    @returns true if the position was found
+*/
+bool Tablebase::probe(Position& pos, TbResult& result){
+    int pieces = Bitboards::popCount(pos.getOccupied());
+    if(pieces < 3 || pieces > TB_MAX_PIECES || pos.getCastlingRights() != 0 || tables.empty()){
+        return false;
+    }
+    bool flip;
+    Tablebase* tb = find(signatureOf(pos, flip));
+    if(tb == NULL){
+        return false;
+    }
+    uint8_t code = tb->getCode(tb->index(pos));
+    result.wdl = tbIsWin(code) ? 1 : tbIsLoss(code) ? -1 : 0;
+    result.plies = (code == 0) ? 0 : tbPlies(code);
+    return true;
+}
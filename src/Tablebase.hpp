@@ -0,0 +1,101 @@
+#ifndef Tablebase_H
+#define Tablebase_H
+
+#include "Piece.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class Position;
+
+/*
+    Distance to mate endgame tablebases for positions with up to 4 pieces.
+
+    A table covers one material signature, written as the stronger team's pieces followed by the
+     weaker team's, e.g. "KRKP". Tables are stored with the stronger team as Red. Positions where
+     Black has the stronger pieces are flipped vertically and the teams swapped before probing.
+    Castling and En Passant are ignored.
+
+    Positions are indexed by symmetry so each table only stores one copy of equivalent positions:
+        stronger king   10 squares (A1-D1-D4 triangle) without pawns, 32 squares (files A-D) with pawns
+        other pieces    64 squares each, in signature order
+        team to move    2
+    Every entry is one byte:
+        0           draw, or an index that isn't a valid position
+        1 - 127     team to move mates in that many moves
+        128 - 255   team to move is mated in (code - 128) moves
+    File layout (little endian):
+        char     magic[4]       "CCTB"
+        uint32   version        TB_VERSION
+        char     signature[8]   zero padded
+        uint64   entries
+        uint8    codes[entries]
+    Files are generated by tools/TbGenerator.cpp and mapped read-only.
+*/
+const int TB_VERSION = 1;
+const int TB_HEADER_SIZE = 24;
+const int TB_MAX_PIECES = 4;
+const int TB_MAX_PLIES = 254;
+
+inline uint8_t tbWinCode(int plies){ return (uint8_t) ((plies + 1) / 2); }
+inline uint8_t tbLossCode(int plies){ return (uint8_t) (128 + plies / 2); }
+inline bool tbIsWin(uint8_t code){ return code > 0 && code < 128; }
+inline bool tbIsLoss(uint8_t code){ return code >= 128; }
+// Plies to mate. Wins take an odd number of plies, losses an even number.
+inline int tbPlies(uint8_t code){ return tbIsWin(code) ? 2 * code - 1 : 2 * (code - 128); }
+
+/*
+    Result of a probe, from the point of view of the team to move
+*/
+struct TbResult {
+    int wdl;        // 1 win, 0 draw, -1 loss
+    int plies;      // plies to mate. 0 for draws.
+};
+
+class Tablebase {
+    string signature;
+    PieceType types[TB_MAX_PIECES];     // in index order: stronger king, stronger pieces, weaker king, weaker pieces
+    TeamColor teams[TB_MAX_PIECES];
+    int pieceCount;
+    bool pawns;
+    size_t entryCount;
+    const uint8_t* codes;
+    const uint8_t* mapped;              // start of the file mapping, NULL if codes are owned by someone else
+    size_t mappedSize;
+
+    public:
+        Tablebase(string);
+        ~Tablebase();
+        void map(string);
+        void setCodes(const uint8_t*);
+        void write(string);
+        size_t index(Position&);
+        bool decode(size_t, Position&);
+        uint8_t getCode(size_t);
+        // getters
+        string getSignature();
+        size_t getEntryCount();
+        int getPieceCount();
+        bool hasPawns();
+        // Signatures
+        static string canonicalSignature(string, string);
+        static string signatureOf(Position&, bool&);
+        static vector<string> childSignatures(string);
+        static bool validSignature(string);
+        // Tables available for probing
+        static void init(string);
+        static void add(Tablebase*);
+        static Tablebase* find(string);
+        static bool probe(Position&, TbResult&);
+        static int getTableCount();
+
+    private:
+        size_t squaresIndex(const int*, int);
+        static int transform(int, int);
+        static string sideString(Position&, TeamColor);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "TimeManager.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+
+TimeManager::TimeManager(){
+    this->start(TimeControl());
+}
+
+TimeManager::~TimeManager() = default;
+
+/**
+    Start the clock for a new search and set its deadlines
+    @param tc Clock settings
+    @returns nothing
+*/
+void TimeManager::start(TimeControl tc){
+    this->startTime = chrono::steady_clock::now();
+    this->nextCheck = TIME_CHECK_INTERVAL;
+    this->control = tc;
+    this->limited = !tc.infinite && !tc.ponder && (tc.moveTime > 0 || tc.time > 0);
+    if(!this->limited){
+        this->softLimit = this->hardLimit = this->optimumLimit = INT64_MAX;
+        return;
+    }
+    if(tc.moveTime > 0){
+        int64_t limit = max((int64_t) 1, tc.moveTime - MOVE_OVERHEAD);
+        this->softLimit = this->hardLimit = this->optimumLimit = limit;
+        return;
+    }
+    // Never plan on more than 50 moves so an early mistake doesn't leave too little time later
+    int movesLeft = (tc.movesToGo > 0) ? min(tc.movesToGo, 50) : 30;
+    int64_t available = max((int64_t) 1, tc.time - MOVE_OVERHEAD);
+    this->optimumLimit = min(available, available / movesLeft + tc.increment * 3 / 4);
+    // Allow a move to take a lot longer when needed, but never more than a fraction of the clock
+    int64_t maximum = (movesLeft == 1) ? available : available / 4;
+    this->hardLimit = max((int64_t) 1, min(this->optimumLimit * 5, maximum));
+    this->optimumLimit = min(this->optimumLimit, this->hardLimit);
+    this->softLimit = this->optimumLimit;
+}
+
+/**
+    The move that was pondered on has been played. Restart the clock with the search's own time
+     control, as if the search had just started.
+*/
+void TimeManager::ponderhit(){
+    TimeControl tc = this->control;
+    tc.ponder = false;
+    int64_t checked = this->nextCheck;
+    this->start(tc);
+    this->nextCheck = checked;
+}
+
+/**
+    @returns Milliseconds since the search started
+*/
+int64_t TimeManager::elapsed(){
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - this->startTime).count();
+}
+
+/**
+    Checked between iterations
+    @returns true if another iteration shouldn't be started
+*/
+bool TimeManager::softExpired(){
+    return this->limited && this->elapsed() >= this->softLimit;
+}
+
+/**
+    Checked during the search. Only reads the clock every TIME_CHECK_INTERVAL nodes.
+    @param nodes Nodes searched so far
+    @returns true if the search has to stop now
+*/
+bool TimeManager::hardExpired(uint64_t nodes){
+    if(!this->limited || nodes < (uint64_t) this->nextCheck){
+        return false;
+    }
+    this->nextCheck = nodes + TIME_CHECK_INTERVAL;
+    return this->elapsed() >= this->hardLimit;
+}
+
+/**
+    Adjust the soft deadline after an iteration
+    @param bestMoveChanges How many of the last few iterations changed the best move
+    @returns nothing
+*/
+void TimeManager::updateStability(int bestMoveChanges){
+    if(!this->limited || this->softLimit == this->hardLimit){
+        return;
+    }
+    // Each recent change of mind earns half of the planned time again
+    int64_t extended = this->optimumLimit + this->optimumLimit * bestMoveChanges / 2;
+    this->softLimit = min(extended, this->hardLimit);
+}
+
+int64_t TimeManager::getSoftLimit(){
+    return this->softLimit;
+}
+
+int64_t TimeManager::getHardLimit(){
+    return this->hardLimit;
+}
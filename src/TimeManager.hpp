@@ -0,0 +1,55 @@
+#ifndef TimeManager_H
+#define TimeManager_H
+
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+/*
+    Clock settings for one search. Times are in milliseconds. A value of 0 means the setting isn't used.
+*/
+struct TimeControl {
+    int64_t time = 0;       // time left on the clock of the team to move
+    int64_t increment = 0;  // time added to the clock after each move
+    int movesToGo = 0;      // moves until the next time control. 0 means the rest of the game.
+    int64_t moveTime = 0;   // search for exactly this long
+    int depth = 0;          // stop after this many plies
+    uint64_t nodes = 0;     // stop after searching this many nodes
+    bool infinite = false;  // search until stopped
+    bool ponder = false;    // search until stopped or until ponderhit() starts the clock
+};
+
+const int TIME_CHECK_INTERVAL = 1024;   // nodes searched between clock checks
+const int64_t MOVE_OVERHEAD = 30;       // milliseconds kept back for printing and applying the move
+
+/*
+    Decides how long a search may run.
+    The soft deadline is checked between iterations of iterative deepening. A search that passes
+     it doesn't start another iteration. The hard deadline is checked during the search, and the
+     search stops as soon as it passes. The soft deadline is pushed back while the best move keeps
+     changing between iterations, up to the hard deadline.
+*/
+class TimeManager {
+    chrono::steady_clock::time_point startTime;
+    int64_t softLimit;      // milliseconds after startTime
+    int64_t hardLimit;
+    int64_t optimumLimit;   // soft limit before adjusting for instability
+    bool limited;
+    int64_t nextCheck;      // node count of the next clock check
+    TimeControl control;    // settings the limits were set from
+
+    public:
+        TimeManager();
+        ~TimeManager();
+        void start(TimeControl);
+        void ponderhit();
+        int64_t elapsed();
+        bool softExpired();
+        bool hardExpired(uint64_t);
+        void updateStability(int);
+        int64_t getSoftLimit();
+        int64_t getHardLimit();
+};
+
+#endif
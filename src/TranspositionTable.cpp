@@ -0,0 +1,160 @@
+#include "TranspositionTable.hpp"
+#include "Search.hpp"
+#include "ChessException.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+
+/**
+    @param mb Size in megabytes, see resize()
+    @throws ChessException if the memory can't be allocated
+*/
+TranspositionTable::TranspositionTable(size_t mb){
+    this->memory = NULL;
+    this->table = NULL;
+    this->clusterCount = 0;
+    this->sizeMB = 0;
+    this->generation = 0;
+    this->resize(mb);
+}
+
+TranspositionTable::~TranspositionTable(){
+    free(this->memory);
+}
+
+/**
+    Reallocate the table. All entries are lost. Must not be called while a search is running.
+    @param mb Size in megabytes, rounded down to a power of two number of clusters
+    @returns nothing
+    @throws ChessException if the memory can't be allocated
+*/
+void TranspositionTable::resize(size_t mb){
+    mb = min(max(mb, (size_t) 1), TT_MAX_MB);
+    size_t clusters = 1;
+    while(clusters * 2 * TT_CLUSTER_SIZE * sizeof(TTEntry) <= mb * 1024 * 1024){
+        clusters *= 2;
+    }
+    // calloc hands out zeroed pages lazily, so an unused table costs nothing
+    void* fresh = calloc(clusters * TT_CLUSTER_SIZE * sizeof(TTEntry) + 64, 1);
+    if(fresh == NULL){
+        throw ChessException("TranspositionTable.cpp: Couldn't allocate " + to_string(mb) + " MB");
+    }
+    free(this->memory);
+    this->memory = fresh;
+    this->table = (TTEntry*) (((uintptr_t) fresh + 63) & ~(uintptr_t) 63);
+    this->clusterCount = clusters;
+    this->sizeMB = mb;
+    this->generation = 0;
+}
+
+/**
+    Forget every stored position. Must not be called while a search is running.
+*/
+void TranspositionTable::clear(){
+    memset(this->table, 0, this->clusterCount * TT_CLUSTER_SIZE * sizeof(TTEntry));
+    this->generation = 0;
+}
+
+/**
+    Called at the start of every search, so entries from older searches are replaced first.
+     Helper threads read the generation while the main search moves it on, so it is read and
+     written atomically too.
+*/
+void TranspositionTable::newSearch(){
+    uint8_t gen = __atomic_load_n(&this->generation, __ATOMIC_RELAXED);
+    __atomic_store_n(&this->generation, (uint8_t) ((gen + 1) & 0x3F), __ATOMIC_RELAXED);
+}
+
+/**
+    Look up a position
+    @param key Zobrist key of the position
+    @param out Set to the stored data when found
+    @param ply Distance from the root. Mate scores are stored relative to the position.
+    @returns true if the position was found
+*/
+bool TranspositionTable::probe(uint64_t key, TTData& out, int ply){
+    TTEntry* cluster = &this->table[(key & (this->clusterCount - 1)) * TT_CLUSTER_SIZE];
+    for(int i=0; i < TT_CLUSTER_SIZE; i++){
+        uint64_t check = __atomic_load_n(&cluster[i].check, __ATOMIC_RELAXED);
+        uint64_t data = __atomic_load_n(&cluster[i].data, __ATOMIC_RELAXED);
+        if(data == 0 || (check ^ data) != key){
+            continue;
+        }
+        out.move = (PackedMove) (data & 0x3FFFF);
+        out.score = (int) ((data >> 18) & 0xFFFF) - 32768;
+        out.depth = (int) ((data >> 34) & 0xFF);
+        out.bound = (Bound) ((data >> 42) & 0x3);
+        if(out.score > MATE_BOUND) out.score -= ply;
+        else if(out.score < -MATE_BOUND) out.score += ply;
+        return true;
+    }
+    return false;
+}
+
+/**
+    Store a search result
+    @param key Zobrist key of the position
+    @param move Best move found, or NULL_MOVE to keep the one already stored for this position
+    @param score Score from the point of view of the team to move
+    @param depth Depth searched
+    @param bound What kind of score it is
+    @param ply Distance from the root
+    @returns nothing
+*/
+void TranspositionTable::store(uint64_t key, PackedMove move, int score, int depth, Bound bound, int ply){
+    TTEntry* cluster = &this->table[(key & (this->clusterCount - 1)) * TT_CLUSTER_SIZE];
+    uint8_t gen = __atomic_load_n(&this->generation, __ATOMIC_RELAXED);
+    // Pick the slot holding this position, otherwise the least useful one: shallow and old
+    TTEntry* slot = &cluster[0];
+    int worst = INT32_MAX;
+    for(int i=0; i < TT_CLUSTER_SIZE; i++){
+        uint64_t check = __atomic_load_n(&cluster[i].check, __ATOMIC_RELAXED);
+        uint64_t data = __atomic_load_n(&cluster[i].data, __ATOMIC_RELAXED);
+        if(data == 0 || (check ^ data) == key){
+            slot = &cluster[i];
+            if(data != 0 && move == NULL_MOVE){
+                move = (PackedMove) (data & 0x3FFFF);
+            }
+            break;
+        }
+        int age = (gen - (int) ((data >> 44) & 0x3F)) & 0x3F;
+        int value = (int) ((data >> 34) & 0xFF) - 8 * age;
+        if(value < worst){
+            worst = value;
+            slot = &cluster[i];
+        }
+    }
+
+    if(score > MATE_BOUND) score += ply;
+    else if(score < -MATE_BOUND) score -= ply;
+    uint64_t data = (uint64_t) (move & 0x3FFFF)
+        | ((uint64_t) (score + 32768) << 18)
+        | ((uint64_t) min(max(depth, 0), 255) << 34)
+        | ((uint64_t) bound << 42)
+        | ((uint64_t) gen << 44);
+    __atomic_store_n(&slot->check, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->data, data, __ATOMIC_RELAXED);
+}
+
+/**
+    @returns Permille of the table written during the current search, sampled from the first 1000 entries
+*/
+int TranspositionTable::hashfull(){
+    size_t sample = min((size_t) 1000 / TT_CLUSTER_SIZE, this->clusterCount);
+    uint8_t gen = __atomic_load_n(&this->generation, __ATOMIC_RELAXED);
+    int used = 0;
+    for(size_t i=0; i < sample * TT_CLUSTER_SIZE; i++){
+        uint64_t data = __atomic_load_n(&this->table[i].data, __ATOMIC_RELAXED);
+        if(data != 0 && ((data >> 44) & 0x3F) == gen){
+            used++;
+        }
+    }
+    return (int) (used * 1000 / (sample * TT_CLUSTER_SIZE));
+}
+
+size_t TranspositionTable::getSizeMB(){
+    return this->sizeMB;
+}
@@ -0,0 +1,75 @@
+#ifndef TranspositionTable_H
+#define TranspositionTable_H
+
+#include "Position.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+enum Bound {
+    NoBound,
+    UpperBound,     // every move failed low, the score is at most this
+    LowerBound,     // a move failed high, the score is at least this
+    ExactBound
+};
+
+/*
+    What the table knows about a position, unpacked
+*/
+struct TTData {
+    PackedMove move;
+    int score;
+    int depth;
+    Bound bound;
+};
+
+/*
+    One slot of the table. 'check' is the position's key XOR 'data', so an entry written by two
+     threads at the same time fails the key comparison instead of returning mixed up data.
+    data layout:
+        bits 0-17   PackedMove
+        bits 18-33  score + 32768
+        bits 34-41  depth
+        bits 42-43  Bound
+        bits 44-49  generation
+*/
+struct TTEntry {
+    uint64_t check;
+    uint64_t data;
+};
+
+const int TT_CLUSTER_SIZE = 4;          // entries per 64 byte cache line
+const size_t TT_DEFAULT_MB = 16;
+const size_t TT_MAX_MB = 4096;
+
+/*
+    Hash table of search results, indexed by Zobrist key.
+    Searches given the same table share their work: the threads of one engine search the same
+     position, so they all use the engine's table. Separate engines and games have their own tables,
+     so nothing one learns leaks into another.
+    Entries are read and written with relaxed atomic loads and stores and no locks.
+*/
+class TranspositionTable {
+    void* memory;                       // allocation 'table' is aligned within
+    TTEntry* table;
+    size_t clusterCount;
+    size_t sizeMB;
+    uint8_t generation;
+
+    public:
+        TranspositionTable(size_t = TT_DEFAULT_MB);
+        ~TranspositionTable();
+        TranspositionTable(const TranspositionTable&) = delete;
+        TranspositionTable& operator=(const TranspositionTable&) = delete;
+        void resize(size_t);
+        void clear();
+        void newSearch();
+        bool probe(uint64_t, TTData&, int);
+        void store(uint64_t, PackedMove, int, int, Bound, int);
+        int hashfull();
+        size_t getSizeMB();
+};
+
+#endif
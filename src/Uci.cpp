@@ -0,0 +1,265 @@
+#include "Uci.hpp"
+#include "TranspositionTable.hpp"
+#include "ChessException.hpp"
+#include "Util.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+
+Uci::Uci(istream& input, ostream& output) : in(input), out(output){
+    this->holdBestMove = false;
+    this->hasPending = false;
+    this->pos.loadFen(START_FEN);
+    this->engine.setInfoCallback([this](SearchResult& r) { this->reportInfo(r); });
+    this->engine.setResultCallback([this](SearchResult& r) {
+        lock_guard<mutex> guard(this->outputLock);
+        if(this->holdBestMove){
+            this->pending = r;
+            this->hasPending = true;
+            return;
+        }
+        this->reportBestMove(r);
+    });
+}
+
+Uci::~Uci(){
+    this->engine.stop();
+}
+
+/**
+    Handle commands until 'quit' or the end of the input
+*/
+void Uci::loop(){
+    string line;
+    while(getline(this->in, line)){
+        istringstream tokens(line);
+        string cmd;
+        if(!(tokens >> cmd)){
+            continue;
+        }
+        if(cmd == "uci"){
+            this->send("id name console_chess");
+            this->send("id author console_chess developers");
+            this->send(string_format("option name Hash type spin default %i min 1 max %i", (int) TT_DEFAULT_MB, (int) TT_MAX_MB));
+            this->send(string_format("option name Threads type spin default 1 min 1 max %i", MAX_THREADS));
+            this->send("option name Ponder type check default false");
+            this->send("uciok");
+        }
+        else if(cmd == "isready"){
+            this->send("readyok");
+        }
+        else if(cmd == "ucinewgame"){
+            this->release();
+            this->engine.stop();
+            this->engine.getTable().clear();
+        }
+        else if(cmd == "setoption"){
+            this->setOption(tokens);
+        }
+        else if(cmd == "position"){
+            this->setPosition(tokens);
+        }
+        else if(cmd == "go"){
+            this->go(tokens);
+        }
+        else if(cmd == "stop"){
+            this->release();
+            this->engine.stop();
+        }
+        else if(cmd == "ponderhit"){
+            this->engine.ponderhit();
+            this->release();
+        }
+        else if(cmd == "quit"){
+            break;
+        }
+        else{
+            this->send("info string Unknown command: " + line);
+        }
+    }
+    this->release();
+    this->engine.stop();
+}
+
+/*
+    Private method
+    Write one line and flush it, since the other end waits for whole lines
+*/
+void Uci::send(string line){
+    lock_guard<mutex> guard(this->outputLock);
+    this->out << line << endl;
+}
+
+/*
+    Private method
+    setoption name <id> value <x>
+*/
+void Uci::setOption(istringstream& tokens){
+    string word, name, value;
+    tokens >> word;
+    if(word != "name"){
+        return;
+    }
+    // Option names may contain spaces
+    while(tokens >> word && word != "value"){
+        name += (name.empty() ? "" : " ") + word;
+    }
+    tokens >> value;
+    transform(name.begin(), name.end(), name.begin(), ::tolower);
+    try{
+        if(name == "hash"){
+            this->engine.stop();
+            this->engine.getTable().resize((size_t) stoul(value));
+        }
+        else if(name == "threads"){
+            this->engine.setThreads(stoi(value));
+        }
+        else if(name == "ponder"){
+            // The GUI decides when to ponder. Nothing to set up.
+        }
+        else{
+            this->send("info string Unknown option: " + name);
+        }
+    }
+    catch(const exception &ex){
+        this->send("info string Invalid value for " + name + ": " + value);
+    }
+}
+
+/*
+    Private method
+    position [startpos | fen <fen>] [moves <move>...]
+*/
+void Uci::setPosition(istringstream& tokens){
+    string word, fen;
+    tokens >> word;
+    if(word == "startpos"){
+        fen = START_FEN;
+        tokens >> word;
+    }
+    else if(word == "fen"){
+        while(tokens >> word && word != "moves"){
+            fen += word + " ";
+        }
+    }
+    else{
+        return;
+    }
+    try{
+        this->pos.loadFen(fen);
+    }
+    catch(const ChessException &ex){
+        this->send(string("info string ") + ex.what());
+        this->pos.loadFen(START_FEN);
+        return;
+    }
+    if(word != "moves"){
+        return;
+    }
+    while(tokens >> word){
+        PackedMove m = this->pos.parseMove(word);
+        if(m == NULL_MOVE){
+            this->send("info string Illegal move: " + word);
+            return;
+        }
+        this->pos.makeMove(m);
+    }
+}
+
+/*
+    Private method
+    go [depth n] [nodes n] [movetime ms] [wtime ms] [btime ms] [winc ms] [binc ms] [movestogo n]
+       [infinite] [ponder]
+*/
+void Uci::go(istringstream& tokens){
+    TimeControl tc;
+    bool redToMove = (this->pos.getSideToMove() == Red);
+    string word;
+    try{
+        while(tokens >> word){
+            if(word == "infinite") tc.infinite = true;
+            else if(word == "ponder") tc.ponder = true;
+            else if(word == "searchmoves") break;
+            else{
+                string value;
+                if(!(tokens >> value)){
+                    break;
+                }
+                if(word == "depth") tc.depth = stoi(value);
+                else if(word == "nodes") tc.nodes = stoull(value);
+                else if(word == "movetime") tc.moveTime = stoll(value);
+                else if(word == "movestogo") tc.movesToGo = stoi(value);
+                else if(word == (redToMove ? "wtime" : "btime")) tc.time = max(1LL, stoll(value));
+                else if(word == (redToMove ? "winc" : "binc")) tc.increment = stoll(value);
+            }
+        }
+    }
+    catch(const exception &ex){
+        this->send("info string Invalid go command");
+        return;
+    }
+    this->engine.stop();
+    {
+        lock_guard<mutex> guard(this->outputLock);
+        this->holdBestMove = tc.infinite || tc.ponder;
+        this->hasPending = false;
+    }
+    this->engine.think(this->pos, tc);
+}
+
+/*
+    Private method
+    An infinite or ponder search may now report its move. If it already finished, report it now.
+*/
+void Uci::release(){
+    lock_guard<mutex> guard(this->outputLock);
+    this->holdBestMove = false;
+    if(this->hasPending){
+        this->hasPending = false;
+        this->reportBestMove(this->pending);
+    }
+}
+
+/*
+    Private method
+    Called on the engine thread after each iteration
+*/
+void Uci::reportInfo(SearchResult& r){
+    uint64_t nodes = this->engine.getNodes();
+    int64_t time = max((int64_t) 1, r.time);
+    string line = string_format("info depth %i score %s nodes %llu nps %llu hashfull %i time %lli pv",
+        r.depth, scoreString(r.score).c_str(), (unsigned long long) nodes,
+        (unsigned long long) (nodes * 1000 / time), this->engine.getTable().hashfull(), (long long) r.time);
+    for(PackedMove m : r.pv){
+        line += " " + Position::moveToString(m);
+    }
+    this->send(line);
+}
+
+/*
+    Private method
+    Caller holds outputLock
+*/
+void Uci::reportBestMove(SearchResult& r){
+    string line = "bestmove " + Position::moveToString(r.bestMove);
+    if(r.ponderMove != NULL_MOVE){
+        line += " ponder " + Position::moveToString(r.ponderMove);
+    }
+    this->out << line << endl;
+}
+
+/*
+    Private method
+    Centipawns, or moves to mate when a mate was found. Negative when the team to move gets mated.
+*/
+string Uci::scoreString(int score){
+    if(score > MATE_BOUND){
+        return "mate " + to_string((MATE_SCORE - score + 1) / 2);
+    }
+    if(score < -MATE_BOUND){
+        return "mate " + to_string(-(MATE_SCORE + score) / 2);
+    }
+    return "cp " + to_string(score);
+}
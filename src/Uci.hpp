@@ -0,0 +1,53 @@
+#ifndef Uci_H
+#define Uci_H
+
+#include "Engine.hpp"
+#include "Position.hpp"
+#include "Search.hpp"
+
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+/*
+    Universal Chess Interface front-end. Reads commands from an input stream and writes replies to an
+     output stream, so GUIs and match runners can drive the engine without the console board.
+    Searches run on the Engine thread, so 'stop' and 'ponderhit' are handled while searching.
+    Supported commands:
+        uci, isready, ucinewgame, quit
+        setoption name <Hash|Threads|Ponder> value <x>
+        position [startpos | fen <fen>] [moves <move>...]
+        go [depth n] [nodes n] [movetime ms] [wtime ms] [btime ms] [winc ms] [binc ms]
+           [movestogo n] [infinite] [ponder]
+        stop, ponderhit
+*/
+class Uci {
+    Engine engine;
+    Position pos;
+    istream& in;
+    ostream& out;
+    mutex outputLock;       // guards the output stream and everything below
+    bool holdBestMove;      // an infinite or ponder search may only report its move after stop or ponderhit
+    bool hasPending;
+    SearchResult pending;   // result of a search that finished while holdBestMove was set
+
+    public:
+        Uci(istream&, ostream&);
+        ~Uci();
+        void loop();
+
+    private:
+        void send(string);
+        void setOption(istringstream&);
+        void setPosition(istringstream&);
+        void go(istringstream&);
+        void release();
+        void reportInfo(SearchResult&);
+        void reportBestMove(SearchResult&);
+        static string scoreString(int);
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef Zobrist_H
+#define Zobrist_H
+
+#include "Piece.hpp"
+
+#include <cstdint>
+
+using namespace std;
+
+/*
+    Random numbers used to hash positions. A position's key is the XOR of the numbers for every
+     piece on the board, the castling rights, the En Passant file and the team to move, so it can be
+     updated with a few XORs whenever a piece moves.
+    The numbers are generated at compile time with splitmix64 and a fixed seed, so keys are the same
+     across builds and can be stored in files.
+*/
+struct ZobristKeys {
+    uint64_t pieces[3][7][64];  // [TeamColor][PieceType][index]
+    uint64_t castling[16];      // one for each combination of castling rights
+    uint64_t enPassant[8];      // [column of the En Passant index]
+    uint64_t blackToMove;
+};
+
+constexpr uint64_t splitmix64(uint64_t& state){
+    state += 0x9E3779B97F4A7C15ULL;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys buildZobristKeys(){
+    ZobristKeys z = {};
+    uint64_t state = 0x636F6E736F6C6521ULL;
+    for(int tc = Red; tc <= Black; tc++){
+        for(int pt = King; pt <= Pawn; pt++){
+            for(int i=0; i < 64; i++){
+                z.pieces[tc][pt][i] = splitmix64(state);
+            }
+        }
+    }
+    // castling[0] (no rights) stays 0 so an empty position hashes to 0
+    for(int i=1; i < 16; i++){
+        z.castling[i] = splitmix64(state);
+    }
+    for(int i=0; i < 8; i++){
+        z.enPassant[i] = splitmix64(state);
+    }
+    z.blackToMove = splitmix64(state);
+    return z;
+}
+
+inline constexpr ZobristKeys ZOBRIST_KEYS = buildZobristKeys();
+
+#endif
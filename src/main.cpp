@@ -1,16 +1,203 @@
 #include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <csignal>
 
 #include "Warnings.hpp"
 #include "Gamestate.hpp"
+#include "StateFactory.hpp"
+#include "Nnue.hpp"
+#include "Book.hpp"
+#include "Tablebase.hpp"
+#include "ChessException.hpp"
+#include "TimeManager.hpp"
+#include "Uci.hpp"
+#include "GameServer.hpp"
+#include "Stats.hpp"
 
 using namespace std;
 
+static GameServer* server = NULL;  // stopped by SIGINT and SIGTERM
+
+static void stopServer(int){
+    server->stop();
+}
+
+static void printStats(){
+    cerr << Stats::report();
+}
+
+int main(int argc, char* argv[]){
+    TeamColor computerTeam = NoColor;
+    TimeControl tc;
+    bool ponder = true;
+    bool uci = false;
+    bool batch = false;
+    ifstream batchFile;
+    const char* fen = NULL;
+    const char* pgnOut = NULL;
+    const char* serverAddress = NULL;
+    bool stats = false;
+    // Usage: console_chess [--nnue <network file>] [--book <polyglot book>] [--tb <tablebase directory>]
+    //  [--computer <red|black>] [--time <seconds>] [--inc <seconds>] [--movetime <seconds>] [--noponder] [--uci]
+    //  [--batch [command file]] [--fen <position>] [--pgn-out <file>] [--server <socket path or port>] [--stats]
+    // Exits with 0 when the game ends normally, 1 if it can't be set up, and with --batch, 2 if any
+    //  command was rejected or not understood
+    for(int i=1; i < argc; i++){
+        if(strcmp(argv[i], "--nnue") == 0 && i + 1 < argc){
+            try{
+                Nnue::load(argv[++i]);
+            }
+            catch(const ChessException &cex){
+                cerr << cex.what() << endl;
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--book") == 0 && i + 1 < argc){
+            try{
+                Book::load(argv[++i]);
+            }
+            catch(const ChessException &cex){
+                cerr << cex.what() << endl;
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--tb") == 0 && i + 1 < argc){
+            try{
+                Tablebase::init(argv[++i]);
+            }
+            catch(const ChessException &cex){
+                cerr << cex.what() << endl;
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--computer") == 0 && i + 1 < argc){
+            i++;
+            if(strcmp(argv[i], "red") == 0) computerTeam = Red;
+            else if(strcmp(argv[i], "black") == 0) computerTeam = Black;
+            else{
+                cerr << "--computer expects red or black" << endl;
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--time") == 0 && i + 1 < argc){
+            tc.time = (int64_t) (atof(argv[++i]) * 1000);
+        }
+        else if(strcmp(argv[i], "--inc") == 0 && i + 1 < argc){
+            tc.increment = (int64_t) (atof(argv[++i]) * 1000);
+        }
+        else if(strcmp(argv[i], "--movetime") == 0 && i + 1 < argc){
+            tc.moveTime = (int64_t) (atof(argv[++i]) * 1000);
+        }
+        else if(strcmp(argv[i], "--noponder") == 0){
+            ponder = false;
+        }
+        else if(strcmp(argv[i], "--uci") == 0){
+            uci = true;
+        }
+        else if(strcmp(argv[i], "--batch") == 0){
+            batch = true;
+            // Commands come from stdin unless a file is given
+            if(i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0){
+                batchFile.open(argv[++i]);
+                if(!batchFile){
+                    cerr << "Couldn't open " << argv[i] << endl;
+                    return 1;
+                }
+            }
+        }
+        else if(strcmp(argv[i], "--fen") == 0 && i + 1 < argc){
+            fen = argv[++i];
+        }
+        else if(strcmp(argv[i], "--pgn-out") == 0 && i + 1 < argc){
+            pgnOut = argv[++i];
+        }
+        else if(strcmp(argv[i], "--server") == 0 && i + 1 < argc){
+            serverAddress = argv[++i];
+        }
+        else if(strcmp(argv[i], "--stats") == 0){
+            stats = true;
+        }
+        else{
+            cerr << "Usage: " << argv[0] << " [--nnue <network file>] [--book <polyglot book>] [--tb <tablebase directory>]"
+                 << " [--computer <red|black>] [--time <seconds>] [--inc <seconds>] [--movetime <seconds>] [--noponder] [--uci] [--batch [command file]] [--fen <position>] [--pgn-out <file>] [--server <socket path or port>] [--stats]" << endl;
+            return 1;
+        }
+    }
+
+    // Print the hot path counters to stderr when the program exits
+    if(stats){
+        atexit(printStats);
+    }
+
+    // Speak UCI on stdin/stdout instead of showing the board
+    if(uci){
+        Uci* u = new Uci(cin, cout);
+        u->loop();
+        delete u;
+        return 0;
+    }
+
+    // Host games for clients on a socket instead of playing one here. A number is a loopback TCP
+    //  port, anything else the path of a Unix domain socket. See GameServer.hpp.
+    if(serverAddress != NULL){
+        TimeControl limits;
+        limits.moveTime = tc.moveTime;
+        limits.depth = (tc.moveTime > 0) ? 0 : SERVER_DEFAULT_DEPTH;
+        try{
+            server = new GameServer(max((int) thread::hardware_concurrency() - 1, 1), limits);
+            if(strspn(serverAddress, "0123456789") == strlen(serverAddress)){
+                server->listenTcp(atoi(serverAddress));
+            }
+            else{
+                server->listenUnix(serverAddress);
+            }
+            signal(SIGINT, stopServer);
+            signal(SIGTERM, stopServer);
+            cout << "Serving games on " << serverAddress << endl;
+            server->run();
+        }
+        catch(const ChessException &cex){
+            cerr << cex.what() << endl;
+            delete server;
+            return 1;
+        }
+        delete server;
+        return 0;
+    }
+
+    // One second per move unless a clock was given
+    if(tc.time <= 0 && tc.moveTime <= 0){
+        tc.moveTime = 1000;
+    }
 
-int main(){
     Gamestate* g = new Gamestate();
+    g->setComputerTeam(computerTeam);
+    g->setTimeControl(tc);
+    g->setPondering(ponder);
+    if(batch){
+        g->setHeadless(true, batchFile.is_open() ? &batchFile : NULL);
+    }
+    if(pgnOut != NULL){
+        g->setPgnOutput(pgnOut);
+    }
+    if(fen != NULL){
+        try{
+            g->loadFen(fen);
+        }
+        catch(const ChessException &cex){
+            cerr << cex.what() << endl;
+            delete g;
+            return 1;
+        }
+    }
     g->start();
 
+    int status = (batch && g->getRejectedCount() > 0) ? 2 : 0;
     delete g;
 
-    return 1;
-}
\ No newline at end of file
+    return status;
+}
@@ -0,0 +1,75 @@
+/*
+    Offline tool that builds a Polyglot opening book from game archives. See BookBuilder.hpp.
+    Usage: book_builder [-j threads] [-d depth] [-g min games] [-s stats file] BOOK ARCHIVE...
+    e.g.   book_builder -d 16 -g 5 book.bin games.ccga
+
+    -d sets the plies of each game that are counted (default 20), and -g leaves out moves played in
+     fewer games (default 1). The stats file is written next to the book as BOOK.stats unless -s
+     says otherwise.
+*/
+#include "BookBuilder.hpp"
+#include "GameArchive.hpp"
+#include "ChessException.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+int main(int argc, char* argv[]){
+    // hardware_concurrency() is 0 when it can't tell
+    int threadCount = max((int) thread::hardware_concurrency(), 1);
+    int depth = BOOK_DEFAULT_DEPTH;
+    long long minGames = 1;
+    string statsPath;
+    vector<string> args;
+    for(int i=1; i < argc; i++){
+        if(strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+            threadCount = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-d") == 0 && i + 1 < argc){
+            depth = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-g") == 0 && i + 1 < argc){
+            minGames = atoll(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc){
+            statsPath = argv[++i];
+        }
+        else{
+            args.push_back(argv[i]);
+        }
+    }
+    if(args.size() < 2 || threadCount < 1 || depth < 1 || minGames < 1 || minGames > UINT32_MAX){
+        cerr << "Usage: " << argv[0] << " [-j threads] [-d depth] [-g min games] [-s stats file] BOOK ARCHIVE..." << endl;
+        return 1;
+    }
+    if(statsPath.empty()){
+        statsPath = args[0] + ".stats";
+    }
+
+    try{
+        auto start = chrono::steady_clock::now();
+        BookBuilder builder(depth, threadCount);
+        for(size_t i=1; i < args.size(); i++){
+            GameArchive archive;
+            archive.map(args[i]);
+            builder.build(archive);
+        }
+        uint64_t entries = builder.writeBook(args[0], (uint32_t) minGames);
+        builder.writeStats(statsPath, (uint32_t) minGames);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << builder.getGamesUsed() << " games, " << builder.getMoveCount() << " moves counted, " << entries << " book entries, ";
+        cout << fixed << setprecision(2) << seconds << "s" << endl;
+    }
+    catch(const ChessException &cex){
+        cerr << cex.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,329 @@
+/*
+    Microbenchmarks of the hot paths of the console game.
+    Usage: chess_bench [-s samples] [-w warmup] [-t ms] [-f filter] [-o results.json]
+    e.g.   chess_bench -f isCheck -o bench.json
+
+    Every benchmark runs on the same positions from StateFactory.hpp, so runs can be compared.
+     The number of calls per sample is picked once so a sample takes about -t milliseconds (default
+     5). Then -w samples (default 3) are run and thrown away, and -s samples (default 21) are timed.
+    Prints the fastest, median, 90th and 99th percentile and slowest time per call of each
+     benchmark, and with -o writes them to a JSON file as well. -f runs only the benchmarks whose
+     name contains the filter.
+    A call of the move benchmarks covers every piece of the side to move, a call of
+     Prompt::promptInput reads a fixed mix of 8 commands, and a call of Util::parseIndex parses all
+     64 squares.
+*/
+#include "Board.hpp"
+#include "Move.hpp"
+#include "Piece.hpp"
+#include "StateFactory.hpp"
+#include "Util.hpp"
+#include "Prompt.hpp"
+#include "ChessException.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+/*
+    A position the benchmarks run on
+*/
+struct BenchPosition {
+    string name;
+    const vector<string>* state;
+};
+
+const BenchPosition BENCH_POSITIONS[] = {
+    {"STATE_1", &STATE_1},      // standard setup
+    {"STATE_2", &STATE_2},      // both kings in check
+    {"STATE_3_1", &STATE_3_1},  // checkmate
+    {"STATE_4_3", &STATE_4_3},  // en passant
+    {"STATE_5_1", &STATE_5_1},  // castling
+    {"STATE_6", &STATE_6}       // promotion
+};
+
+/*
+    What one benchmark measured, in nanoseconds per call
+*/
+struct BenchResult {
+    string name;
+    string position;
+    long iterations;            // calls per sample
+    vector<double> samples;     // sorted
+};
+
+struct BenchOptions {
+    int samples = 21;
+    int warmup = 3;
+    double sampleMs = 5;
+    string filter;
+};
+
+static volatile long sink;      // results are added here so the calls can't be optimized away
+
+// Time 'iterations' calls of 'op'
+static double timeCalls(const function<void()>& op, long iterations){
+    auto start = Clock::now();
+    for(long i=0; i < iterations; i++){
+        op();
+    }
+    return chrono::duration<double, nano>(Clock::now() - start).count();
+}
+
+// Nearest rank percentile of sorted samples
+static double percentile(const vector<double>& sorted, double p){
+    size_t k = (size_t) (p * (sorted.size() - 1) + 0.5);
+    return sorted[min(k, sorted.size() - 1)];
+}
+
+static BenchResult runBench(const string& name, const string& position, const function<void()>& op, const BenchOptions& options){
+    BenchResult result;
+    result.name = name;
+    result.position = position;
+    // Double the calls per sample until a sample is long enough
+    double target = options.sampleMs * 1e6;
+    long iterations = 1;
+    while(timeCalls(op, iterations) < target && iterations < (1L << 30)){
+        iterations *= 2;
+    }
+    result.iterations = iterations;
+    for(int i=0; i < options.warmup; i++){
+        timeCalls(op, iterations);
+    }
+    for(int i=0; i < options.samples; i++){
+        result.samples.push_back(timeCalls(op, iterations) / iterations);
+    }
+    sort(result.samples.begin(), result.samples.end());
+    return result;
+}
+
+static TeamColor stateTurn(const vector<string>& state){
+    return (state.at(0) == "b") ? Black : Red;
+}
+
+static void loadState(Board* board, const vector<string>& state){
+    StateFactory::loadBoard(board, state.at(3), stoi(state.at(1)));
+}
+
+static void deleteMoves(vector<Move*>& moves){
+    sink = sink + moves.size();
+    for(Move* m : moves){
+        delete m;
+    }
+}
+
+// Benchmarks ===================================
+
+/*
+    Run every benchmark the filter lets through, on every position it applies to
+*/
+static vector<BenchResult> runAll(const BenchOptions& options){
+    vector<BenchResult> results;
+    auto wanted = [&options](const string& name) -> bool {
+        return options.filter.empty() || name.find(options.filter) != string::npos;
+    };
+    auto report = [&results](BenchResult r) -> void {
+        cout << left << setw(26) << r.name << setw(11) << r.position << right << fixed << setprecision(1);
+        cout << setw(12) << r.samples.front() << setw(12) << percentile(r.samples, 0.5) << setw(12) << percentile(r.samples, 0.9);
+        cout << setw(12) << percentile(r.samples, 0.99) << setw(12) << r.samples.back() << endl;
+        results.push_back(r);
+    };
+    cout << left << setw(26) << "benchmark" << setw(11) << "position" << right;
+    cout << setw(12) << "min ns" << setw(12) << "median ns" << setw(12) << "p90 ns" << setw(12) << "p99 ns" << setw(12) << "max ns" << endl;
+
+    for(const BenchPosition& bp : BENCH_POSITIONS){
+        const vector<string>& state = *bp.state;
+        TeamColor turn = stateTurn(state);
+        Board board(true);
+        loadState(&board, state);
+        vector<int> pieces = board.getTeamPieceIndices(turn);
+
+        // Moves of every piece of the side to move, rejecting those that leave its king in check
+        if(wanted("Move::calcAllMoves")){
+            report(runBench("Move::calcAllMoves", bp.name, [&]() -> void {
+                for(int i : pieces){
+                    Move m(turn);
+                    m.setSourceIndex(i);
+                    vector<Move*> moves = m.calcAllMoves(&board, true);
+                    deleteMoves(moves);
+                }
+            }, options));
+        }
+        // The standard movesets of every piece of the side to move, without the check test
+        if(wanted("Move::calcMovesetMoves")){
+            vector<vector<string>> movesets;
+            for(int i : pieces){
+                movesets.push_back(board.getPiece(i).getStdMoveset());
+            }
+            report(runBench("Move::calcMovesetMoves", bp.name, [&]() -> void {
+                for(size_t p=0; p < pieces.size(); p++){
+                    Move m(turn);
+                    m.setSourceIndex(pieces[p]);
+                    for(const string& moveset : movesets[p]){
+                        vector<Move*> moves = m.calcMovesetMoves(moveset, &board);
+                        deleteMoves(moves);
+                    }
+                }
+            }, options));
+        }
+        if(wanted("Board::isCheck")){
+            report(runBench("Board::isCheck", bp.name, [&]() -> void {
+                sink = sink + board.isCheck(turn);
+            }, options));
+        }
+        if(wanted("Board::isCheckmate")){
+            report(runBench("Board::isCheckmate", bp.name, [&]() -> void {
+                sink = sink + board.isCheckmate(turn);
+            }, options));
+        }
+        if(wanted("Board::clone")){
+            Board copy(false);
+            report(runBench("Board::clone", bp.name, [&]() -> void {
+                copy.clone(&board);
+            }, options));
+        }
+        // Rendered to /dev/null, so the terminal isn't measured
+        if(wanted("Board::display")){
+            cout.flush();
+            int saved = dup(STDOUT_FILENO);
+            int devNull = open("/dev/null", O_WRONLY);
+            dup2(devNull, STDOUT_FILENO);
+            BenchResult r = runBench("Board::display", bp.name, [&]() -> void {
+                board.display();
+            }, options);
+            dup2(saved, STDOUT_FILENO);
+            close(devNull);
+            close(saved);
+            report(r);
+        }
+        if(wanted("StateFactory::build")){
+            const string& boardState = state.at(3);
+            int turnCount = stoi(state.at(1));
+            report(runBench("StateFactory::build", bp.name, [&]() -> void {
+                Piece* built = StateFactory::build(boardState, turnCount);
+                sink = sink + built[0].getType();
+                delete[] built;
+            }, options));
+        }
+    }
+
+    // A fixed mix of commands, valid and not, read one line per call
+    if(wanted("Prompt::promptInput")){
+        const string lines =
+            "mv e2 e4\n"
+            "sel b8\n"
+            "e7 e5\n"
+            "add r q d4\n"
+            "rm d4\n"
+            "go\n"
+            "help\n"
+            "mv z9 a1\n";
+        const int lineCount = 8;
+        istringstream input;
+        Prompt prompt;
+        prompt.setShowPrompt(false);
+        prompt.setInput(&input);
+        report(runBench("Prompt::promptInput", "-", [&]() -> void {
+            input.clear();
+            input.str(lines);
+            for(int i=0; i < lineCount; i++){
+                prompt.promptInput("");
+                sink = sink + prompt.getCmdArgs()[0];
+            }
+        }, options));
+    }
+    // Every square of the board
+    if(wanted("Util::parseIndex")){
+        vector<string> squares;
+        for(char file='a'; file <= 'h'; file++){
+            for(char rank='1'; rank <= '8'; rank++){
+                squares.push_back(string(1, file) + rank);
+            }
+        }
+        report(runBench("Util::parseIndex", "-", [&]() -> void {
+            for(const string& square : squares){
+                sink = sink + Util::parseIndex(square);
+            }
+        }, options));
+    }
+    return results;
+}
+
+static void writeJson(const string& path, const vector<BenchResult>& results, const BenchOptions& options){
+    ofstream out(path);
+    if( !out){
+        throw ChessException("ChessBench.cpp: Could not write " + path);
+    }
+    out << fixed << setprecision(1);
+    out << "{\n  \"samples\": " << options.samples << ",\n  \"warmup\": " << options.warmup;
+    out << ",\n  \"sample_ms\": " << options.sampleMs << ",\n  \"benchmarks\": [";
+    for(size_t i=0; i < results.size(); i++){
+        const BenchResult& r = results[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"name\": \"" << r.name << "\", \"position\": \"" << r.position << "\", \"iterations\": " << r.iterations;
+        out << ", \"ns_per_call\": {\"min\": " << r.samples.front() << ", \"median\": " << percentile(r.samples, 0.5);
+        out << ", \"p90\": " << percentile(r.samples, 0.9) << ", \"p99\": " << percentile(r.samples, 0.99);
+        out << ", \"max\": " << r.samples.back() << "}, \"samples\": [";
+        for(size_t s=0; s < r.samples.size(); s++){
+            out << (s == 0 ? "" : ", ") << r.samples[s];
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[]){
+    BenchOptions options;
+    string jsonPath;
+    for(int i=1; i < argc; i++){
+        if(strcmp(argv[i], "-s") == 0 && i + 1 < argc){
+            options.samples = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc){
+            options.warmup = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc){
+            options.sampleMs = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-f") == 0 && i + 1 < argc){
+            options.filter = argv[++i];
+        }
+        else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc){
+            jsonPath = argv[++i];
+        }
+        else{
+            cerr << "Usage: " << argv[0] << " [-s samples] [-w warmup] [-t ms] [-f filter] [-o results.json]" << endl;
+            return 1;
+        }
+    }
+    if(options.samples < 1 || options.warmup < 0 || options.sampleMs <= 0){
+        cerr << "Usage: " << argv[0] << " [-s samples] [-w warmup] [-t ms] [-f filter] [-o results.json]" << endl;
+        return 1;
+    }
+
+    try{
+        vector<BenchResult> results = runAll(options);
+        if( !jsonPath.empty()){
+            writeJson(jsonPath, results, options);
+        }
+    }
+    catch(const ChessException &cex){
+        cerr << cex.what() << endl;
+        return 1;
+    }
+    return 0;
+}
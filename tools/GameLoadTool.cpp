@@ -0,0 +1,344 @@
+/*
+    Load generator for the game server (console_chess --server, see GameServer.hpp).
+    Usage: game_load [-j threads] [-c connections] [-t seconds] [-p plies] ADDRESS
+    e.g.   console_chess --server /tmp/chess.sock &
+           game_load -j 2 -c 1000 -t 10 /tmp/chess.sock
+
+    ADDRESS is a loopback TCP port if it is a number, otherwise the path of a Unix domain socket.
+    Every connection plays games of random legal moves, one request at a time: "new", then "move"
+     until the game ends or reaches -p plies (default 200), then "close". The connections are
+     spread over -j threads (default 2), each with its own epoll loop. After -t seconds (default
+     10), prints requests and moves per second, and the 50th and 99th percentile and worst time
+     from sending a request to reading its reply. No requests are sent after -t seconds, and the
+     replies to those already sent are waited for up to DRAIN_SECONDS longer. Requests still
+     unanswered then count as timeouts, with the time they waited as their latency. Connections
+     that didn't finish a game are reported too.
+    Exits with 0 if every request got the reply expected, 2 if some didn't or timed out, and 1 if
+     the server can't be reached.
+*/
+#include "Position.hpp"
+#include "ChessException.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cerrno>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+const double DRAIN_SECONDS = 2;     // how long replies are waited for after the deadline
+
+/*
+    One connection and the game it is playing
+*/
+struct Client {
+    enum ClientState {
+        Creating,   // sent "new"
+        Moving,     // sent "move"
+        Closing     // sent "close"
+    };
+
+    int fd;
+    ClientState state;
+    Position pos;
+    uint32_t game;
+    int plies;
+    PackedMove sentMove;
+    string input;
+    Clock::time_point sentAt;
+    bool waiting = false;   // a request was sent and its reply hasn't been read
+    bool hungUp = false;    // the server closed the connection
+    uint64_t games = 0;     // games played to the end
+};
+
+/*
+    What one thread measured
+*/
+struct LoadStats {
+    uint64_t requests = 0;
+    uint64_t moves = 0;
+    uint64_t games = 0;
+    uint64_t errors = 0;
+    uint64_t timeouts = 0;          // requests unanswered at the end
+    uint64_t idle = 0;              // connections that didn't finish a game
+    vector<uint32_t> latencies;     // microseconds
+};
+
+static int connectTo(const string& address){
+    int fd;
+    if(strspn(address.c_str(), "0123456789") == address.size()){
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t) atoi(address.c_str()));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(fd >= 0 && connect(fd, (sockaddr*) &addr, sizeof(addr)) != 0){
+            close(fd);
+            fd = -1;
+        }
+        int on = 1;
+        if(fd >= 0){
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+    }
+    else{
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(fd >= 0 && connect(fd, (sockaddr*) &addr, sizeof(addr)) != 0){
+            close(fd);
+            fd = -1;
+        }
+    }
+    if(fd < 0){
+        throw ChessException("Could not connect to " + address + ": " + strerror(errno));
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+static bool sendLine(Client& c, const string& line){
+    string text = line + "\n";
+    c.sentAt = Clock::now();
+    c.waiting = true;
+    return send(c.fd, text.data(), text.size(), MSG_NOSIGNAL) == (ssize_t) text.size();
+}
+
+// Play a random legal move in the client's game
+static bool sendMove(Client& c, mt19937_64& rng){
+    MoveList legal;
+    c.pos.generateLegalMoves(legal);
+    c.sentMove = legal.moves[rng() % legal.size];
+    c.state = Client::Moving;
+    return sendLine(c, "move " + to_string(c.game) + " " + Position::moveToString(c.sentMove));
+}
+
+// Handle one reply, and send the next request. Returns false if the reply wasn't as expected.
+static bool handleReply(Client& c, const string& line, LoadStats& stats, int maxPlies, mt19937_64& rng){
+    vector<string> words;
+    size_t start = 0;
+    while(start < line.size()){
+        size_t end = line.find(' ', start);
+        end = (end == string::npos) ? line.size() : end;
+        words.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+    bool ok = !words.empty() && words[0] == "ok";
+    if(c.state == Client::Creating){
+        if( !ok || words.size() != 2){
+            return false;
+        }
+        c.game = (uint32_t) stoul(words[1]);
+        c.pos.loadFen(START_FEN);
+        c.plies = 0;
+        return sendMove(c, rng);
+    }
+    if(c.state == Client::Moving){
+        if( !ok || words.size() != 4 || words[2] != Position::moveToString(c.sentMove)){
+            return false;
+        }
+        stats.moves++;
+        c.pos.makeMove(c.sentMove);
+        c.plies++;
+        if((words[3] == "playing" || words[3] == "check") && c.plies < maxPlies){
+            return sendMove(c, rng);
+        }
+        c.state = Client::Closing;
+        return sendLine(c, "close " + to_string(c.game));
+    }
+    if( !ok){
+        return false;
+    }
+    stats.games++;
+    c.games++;
+    c.state = Client::Creating;
+    return sendLine(c, "new");
+}
+
+static void runClients(vector<Client>& clients, Clock::time_point deadline, int maxPlies, uint64_t seed, LoadStats& stats){
+    mt19937_64 rng(seed);
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    for(size_t i=0; i < clients.size(); i++){
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, clients[i].fd, &ev);
+        clients[i].state = Client::Creating;
+        if( !sendLine(clients[i], "new")){
+            stats.errors++;
+        }
+    }
+    epoll_event events[256];
+    char buffer[16 * 1024];
+    auto drainEnd = deadline + chrono::duration_cast<Clock::duration>(chrono::duration<double>(DRAIN_SECONDS));
+    size_t waiting = clients.size();    // checked once the deadline passes
+    while(Clock::now() < deadline || (waiting > 0 && Clock::now() < drainEnd)){
+        int count = epoll_wait(epollFd, events, 256, 100);
+        for(int e=0; e < count; e++){
+            Client& c = clients[events[e].data.u64];
+            ssize_t n;
+            while((n = read(c.fd, buffer, sizeof(buffer))) > 0){
+                c.input.append(buffer, n);
+            }
+            if(n == 0){
+                // The server hung up. Stop listening to this connection.
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, c.fd, NULL);
+                stats.errors++;
+                c.waiting = false;
+                c.hungUp = true;
+                continue;
+            }
+            size_t end;
+            while((end = c.input.find('\n')) != string::npos){
+                string line = c.input.substr(0, end);
+                c.input.erase(0, end + 1);
+                if( !c.waiting){
+                    continue;
+                }
+                auto now = Clock::now();
+                c.waiting = false;
+                stats.latencies.push_back((uint32_t) chrono::duration_cast<chrono::microseconds>(now - c.sentAt).count());
+                // Past the deadline, replies are only read for their latency
+                if(now >= deadline){
+                    continue;
+                }
+                stats.requests++;
+                if( !handleReply(c, line, stats, maxPlies, rng)){
+                    stats.errors++;
+                    c.state = Client::Creating;
+                    sendLine(c, "new");
+                }
+            }
+        }
+        if(Clock::now() >= deadline){
+            waiting = count_if(clients.begin(), clients.end(), [](const Client& c){ return c.waiting && !c.hungUp; });
+        }
+    }
+    close(epollFd);
+
+    // A request the server never answered waited at least this long
+    auto now = Clock::now();
+    for(Client& c : clients){
+        if(c.waiting && !c.hungUp){
+            stats.timeouts++;
+            stats.latencies.push_back((uint32_t) chrono::duration_cast<chrono::microseconds>(now - c.sentAt).count());
+        }
+        if(c.games == 0){
+            stats.idle++;
+        }
+    }
+}
+
+int main(int argc, char* argv[]){
+    int threadCount = 2;
+    int connectionCount = 100;
+    double seconds = 10;
+    int maxPlies = 200;
+    vector<string> args;
+    for(int i=1; i < argc; i++){
+        if(strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+            threadCount = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-c") == 0 && i + 1 < argc){
+            connectionCount = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc){
+            seconds = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-p") == 0 && i + 1 < argc){
+            maxPlies = atoi(argv[++i]);
+        }
+        else{
+            args.push_back(argv[i]);
+        }
+    }
+    if(args.size() != 1 || threadCount < 1 || connectionCount < 1 || seconds <= 0 || maxPlies < 1){
+        cerr << "Usage: " << argv[0] << " [-j threads] [-c connections] [-t seconds] [-p plies] ADDRESS" << endl;
+        return 1;
+    }
+    threadCount = min(threadCount, connectionCount);
+    // Every connection takes a descriptor. Raise the soft limit as far as allowed.
+    rlimit files;
+    if(getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max){
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    vector<vector<Client>> groups(threadCount);
+    try{
+        for(int i=0; i < connectionCount; i++){
+            Client c;
+            c.fd = connectTo(args[0]);
+            groups[i % threadCount].push_back(move(c));
+        }
+    }
+    catch(const ChessException &cex){
+        cerr << cex.what() << endl;
+        return 1;
+    }
+
+    vector<LoadStats> stats(threadCount);
+    auto start = Clock::now();
+    auto deadline = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(seconds));
+    vector<thread> threads;
+    for(int t=0; t < threadCount; t++){
+        threads.emplace_back(runClients, ref(groups[t]), deadline, maxPlies, (uint64_t) t + 1, ref(stats[t]));
+    }
+    for(thread& t : threads){
+        t.join();
+    }
+    // Rates are over the time requests were sent, not the time spent waiting for the last replies
+    double elapsed = chrono::duration<double>(deadline - start).count();
+    for(vector<Client>& group : groups){
+        for(Client& c : group){
+            close(c.fd);
+        }
+    }
+
+    LoadStats total;
+    for(LoadStats& s : stats){
+        total.requests += s.requests;
+        total.moves += s.moves;
+        total.games += s.games;
+        total.errors += s.errors;
+        total.timeouts += s.timeouts;
+        total.idle += s.idle;
+        total.latencies.insert(total.latencies.end(), s.latencies.begin(), s.latencies.end());
+    }
+    auto percentile = [&total](double p) -> uint32_t {
+        if(total.latencies.empty()){
+            return 0;
+        }
+        size_t k = min((size_t) (p * total.latencies.size()), total.latencies.size() - 1);
+        nth_element(total.latencies.begin(), total.latencies.begin() + k, total.latencies.end());
+        return total.latencies[k];
+    };
+    cout << connectionCount << " connections, " << total.games << " games, " << total.moves << " moves, " << total.errors << " errors, ";
+    cout << total.timeouts << " timeouts, " << fixed << setprecision(2) << elapsed << "s" << endl;
+    if(total.idle > 0){
+        cout << total.idle << " connections finished no game" << endl;
+    }
+    cout << setprecision(0) << (total.requests / elapsed) << " requests/sec, " << (total.moves / elapsed) << " moves/sec" << endl;
+    cout << "latency p50 " << percentile(0.50) << "us, p99 " << percentile(0.99) << "us, max " << percentile(1.0) << "us" << endl;
+    return (total.errors == 0 && total.timeouts == 0) ? 0 : 2;
+}
@@ -0,0 +1,141 @@
+/*
+    Build step that generates the king and pawn vs king bitbase used by Kpk.cpp.
+    Usage: kpk_generator <output file>
+    Writes the bitbase as a list of comma separated 32 bit words to be #included into an array.
+
+    Every position starts out unknown, except ones that are impossible, where Black just lost the
+     pawn or is stalemated, or where Red promotes safely. Unknown positions are then classified
+     from the positions their moves lead to until nothing changes:
+        - Red to move wins if any move wins, and draws if every move draws
+        - Black to move draws if any move draws, and loses if every move loses
+    Positions still unknown at the end are draws.
+*/
+#include "Kpk.hpp"
+#include "Bitboard.hpp"
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+enum KpkResult {
+    Invalid = 0,
+    Unknown = 1,
+    Draw = 2,
+    Win = 4
+};
+
+struct KpkPosition {
+    TeamColor toMove;
+    int redKing;
+    int blackKing;
+    int pawn;
+    uint8_t result;
+};
+
+static int distance(int a, int b){
+    int rows = a / 8 - b / 8;
+    int cols = a % 8 - b % 8;
+    rows = rows < 0 ? -rows : rows;
+    cols = cols < 0 ? -cols : cols;
+    return rows > cols ? rows : cols;
+}
+
+static KpkPosition initPosition(int index){
+    KpkPosition p;
+    p.toMove = (index & 1) ? Black : Red;
+    p.blackKing = (index >> 1) & 63;
+    p.redKing = (index >> 7) & 63;
+    int pawnSquare = index >> 13;
+    p.pawn = (6 - pawnSquare / 4) * 8 + pawnSquare % 4;
+
+    Bitboard pawnAttacks = Bitboards::pawnAttacks(Red, p.pawn);
+    int push = p.pawn - 8;
+
+    if(distance(p.redKing, p.blackKing) <= 1 || p.redKing == p.pawn || p.blackKing == p.pawn
+        || (p.toMove == Red && (pawnAttacks & Bitboards::squareBB(p.blackKing)))){
+        p.result = Invalid;
+    }
+    // Pawn on rank 7 can promote without the new queen being captured
+    else if(p.toMove == Red && p.pawn / 8 == 1 && p.redKing != push && p.blackKing != push
+        && (distance(p.blackKing, push) > 1 || distance(p.redKing, push) == 1)){
+        p.result = Win;
+    }
+    // Black is stalemated, or can capture an undefended pawn
+    else if(p.toMove == Black
+        && (!(Bitboards::kingAttacks(p.blackKing) & ~(Bitboards::kingAttacks(p.redKing) | pawnAttacks))
+            || (Bitboards::kingAttacks(p.blackKing) & Bitboards::squareBB(p.pawn) & ~Bitboards::kingAttacks(p.redKing)))){
+        p.result = Draw;
+    }
+    else{
+        p.result = Unknown;
+    }
+    return p;
+}
+
+static uint8_t classify(KpkPosition& p, vector<KpkPosition>& db){
+    int r = Invalid;
+    Bitboard moves = (p.toMove == Red) ? Bitboards::kingAttacks(p.redKing) : Bitboards::kingAttacks(p.blackKing);
+    while(moves){
+        int to = Bitboards::popLsb(moves);
+        if(p.toMove == Red){
+            r |= db[kpkIndex(Black, to, p.blackKing, p.pawn)].result;
+        }
+        else{
+            r |= db[kpkIndex(Red, p.redKing, to, p.pawn)].result;
+        }
+    }
+    if(p.toMove == Red){
+        int push = p.pawn - 8;
+        // Promotions were classified when the table was initialised
+        if(push / 8 >= 1 && push != p.redKing && push != p.blackKing){
+            r |= db[kpkIndex(Black, p.redKing, p.blackKing, push)].result;
+            int doublePush = push - 8;
+            if(p.pawn / 8 == 6 && doublePush != p.redKing && doublePush != p.blackKing){
+                r |= db[kpkIndex(Black, p.redKing, p.blackKing, doublePush)].result;
+            }
+        }
+        return (r & Win) ? Win : (r & Unknown) ? Unknown : Draw;
+    }
+    return (r & Draw) ? Draw : (r & Unknown) ? Unknown : Win;
+}
+
+int main(int argc, char* argv[]){
+    if(argc != 2){
+        fprintf(stderr, "Usage: %s <output file>\n", argv[0]);
+        return 1;
+    }
+    vector<KpkPosition> db(KPK_SIZE);
+    for(int i=0; i < KPK_SIZE; i++){
+        db[i] = initPosition(i);
+    }
+    bool changed = true;
+    while(changed){
+        changed = false;
+        for(int i=0; i < KPK_SIZE; i++){
+            if(db[i].result == Unknown){
+                db[i].result = classify(db[i], db);
+                changed |= db[i].result != Unknown;
+            }
+        }
+    }
+
+    FILE* out = fopen(argv[1], "w");
+    if(out == NULL){
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+    fprintf(out, "// Generated by tools/KpkGenerator.cpp. Do not edit.\n");
+    for(int word=0; word < KPK_SIZE / 32; word++){
+        uint32_t bits = 0;
+        for(int b=0; b < 32; b++){
+            if(db[word * 32 + b].result == Win){
+                bits |= 1u << b;
+            }
+        }
+        fprintf(out, "0x%08X,%s", bits, (word % 8 == 7) ? "\n" : " ");
+    }
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,272 @@
+/*
+    Offline tool that plays this engine against itself under two sets of limits. See Match.hpp.
+    Usage: match [-j threads] [-games N] [-openings EPD] [-pgnout FILE] [-hash MB] [-nnue FILE] [-tb DIR]
+                 [-draw movenumber=N movecount=N score=N] [-resign movecount=N score=N] [-maxmoves N]
+                 [-sprt elo0=N elo1=N alpha=N beta=N] [-each OPTION...] -engine OPTION... -engine OPTION...
+    e.g.   match -j 8 -games 400 -openings book.epd -pgnout games.pgn -each tc=10+0.1
+                 -engine name=long tc=20+0.2 -engine name=short -sprt elo0=0 elo1=50
+           match -nnue net.bin -each depth=6 -engine name=nnue -engine name=classical eval=classical
+
+    Engine options are name=NAME, tc=SECONDS[+INCREMENT], st=SECONDS per move, depth=N, nodes=N,
+     hash=MB, eval=nnue|classical and contempt=CENTIPAWNS. -hash sets the table size of both engines,
+     -each sets options for both engines, and each -engine can override them. eval=classical plays
+     without the -nnue network. The first engine is the one scores, Elo and the SPRT are counted for.
+    Games are played -j at a time (default one per core). Every opening is played twice, with the
+     engines swapping colors. With -sprt, no more games are started once the test decides.
+    Exits with 0 when the games are played and the SPRT, if any, passes, 2 when the SPRT fails or
+     doesn't decide, and 1 on an error.
+*/
+#include "Match.hpp"
+#include "Nnue.hpp"
+#include "Tablebase.hpp"
+#include "ChessException.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+// Splits "key=value". Returns false if there is no '='.
+static bool splitOption(const string& option, string& key, string& value){
+    size_t equals = option.find('=');
+    if(equals == string::npos){
+        return false;
+    }
+    key = option.substr(0, equals);
+    value = option.substr(equals + 1);
+    return true;
+}
+
+static bool setEngineOption(MatchEngine& engine, const string& option){
+    string key, value;
+    if( !splitOption(option, key, value)){
+        return false;
+    }
+    if(key == "name"){
+        engine.name = value;
+    }
+    else if(key == "tc"){
+        size_t plus = value.find('+');
+        engine.time = (int64_t) (atof(value.substr(0, plus).c_str()) * 1000);
+        engine.increment = (plus == string::npos) ? 0 : (int64_t) (atof(value.substr(plus + 1).c_str()) * 1000);
+    }
+    else if(key == "st"){
+        engine.moveTime = (int64_t) (atof(value.c_str()) * 1000);
+    }
+    else if(key == "depth"){
+        engine.depth = atoi(value.c_str());
+    }
+    else if(key == "nodes"){
+        engine.nodes = strtoull(value.c_str(), NULL, 10);
+    }
+    else if(key == "hash" && atol(value.c_str()) > 0){
+        engine.hashMB = (size_t) atol(value.c_str());
+    }
+    else if(key == "eval" && (value == "nnue" || value == "classical")){
+        engine.options.nnue = value == "nnue";
+    }
+    else if(key == "contempt"){
+        engine.options.contempt = atoi(value.c_str());
+    }
+    else{
+        return false;
+    }
+    return true;
+}
+
+static bool setRuleOption(MatchRules& rules, bool draw, const string& option){
+    string key, value;
+    if( !splitOption(option, key, value)){
+        return false;
+    }
+    int n = atoi(value.c_str());
+    if(key == "movenumber" && draw){
+        rules.drawMoveNumber = n;
+    }
+    else if(key == "movecount"){
+        (draw ? rules.drawMoveCount : rules.resignMoveCount) = n;
+    }
+    else if(key == "score"){
+        (draw ? rules.drawScore : rules.resignScore) = n;
+    }
+    else{
+        return false;
+    }
+    return true;
+}
+
+static bool setSprtOption(MatchSprt& sprt, const string& option){
+    string key, value;
+    if( !splitOption(option, key, value)){
+        return false;
+    }
+    double x = atof(value.c_str());
+    if(key == "elo0") sprt.elo0 = x;
+    else if(key == "elo1") sprt.elo1 = x;
+    else if(key == "alpha") sprt.alpha = x;
+    else if(key == "beta") sprt.beta = x;
+    else return false;
+    return true;
+}
+
+static void printScore(const string& first, const string& second, const MatchScore& score){
+    cout << "Score of " << first << " vs " << second << ": " << score.wins << " - " << score.losses << " - " << score.draws;
+    cout << "  [" << fixed << setprecision(3) << score.getScore() << "] " << score.getGames() << endl;
+}
+
+static void usage(const char* name){
+    cerr << "Usage: " << name << " [-j threads] [-games N] [-openings EPD] [-pgnout FILE] [-hash MB] [-nnue FILE] [-tb DIR]" << endl;
+    cerr << "       [-draw movenumber=N movecount=N score=N] [-resign movecount=N score=N] [-maxmoves N]" << endl;
+    cerr << "       [-sprt elo0=N elo1=N alpha=N beta=N] [-each OPTION...] -engine OPTION... -engine OPTION..." << endl;
+    cerr << "Engine options: name=NAME tc=SECONDS[+INCREMENT] st=SECONDS depth=N nodes=N" << endl;
+    cerr << "                hash=MB eval=nnue|classical contempt=CENTIPAWNS" << endl;
+}
+
+int main(int argc, char* argv[]){
+    int threadCount = thread::hardware_concurrency();
+    int gameCount = MATCH_DEFAULT_GAMES;
+    string openingsPath, pgnPath, nnuePath, tbPath;
+    long hashMB = 0;
+    MatchRules rules;
+    MatchSprt sprt;
+    vector<string> eachOptions;
+    vector<vector<string>> engineOptions;
+    bool valid = true;
+    for(int i=1; i < argc && valid; i++){
+        // Options given as key=value follow their flag
+        vector<string> options;
+        auto takeOptions = [argc, argv, &i, &options](){
+            while(i + 1 < argc && argv[i + 1][0] != '-' && strchr(argv[i + 1], '=') != NULL){
+                options.push_back(argv[++i]);
+            }
+        };
+        if(strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+            threadCount = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-games") == 0 && i + 1 < argc){
+            gameCount = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-openings") == 0 && i + 1 < argc){
+            openingsPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "-pgnout") == 0 && i + 1 < argc){
+            pgnPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "-hash") == 0 && i + 1 < argc){
+            hashMB = atol(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-nnue") == 0 && i + 1 < argc){
+            nnuePath = argv[++i];
+        }
+        else if(strcmp(argv[i], "-tb") == 0 && i + 1 < argc){
+            tbPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "-maxmoves") == 0 && i + 1 < argc){
+            rules.maxMoves = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-draw") == 0 || strcmp(argv[i], "-resign") == 0){
+            bool draw = strcmp(argv[i], "-draw") == 0;
+            takeOptions();
+            for(string& o : options){
+                valid = valid && setRuleOption(rules, draw, o);
+            }
+            if(draw && rules.drawMoveNumber == 0){
+                rules.drawMoveNumber = 1;
+            }
+            if( !draw && rules.resignMoveCount == 0){
+                rules.resignMoveCount = 3;
+            }
+        }
+        else if(strcmp(argv[i], "-sprt") == 0){
+            sprt.enabled = true;
+            takeOptions();
+            for(string& o : options){
+                valid = valid && setSprtOption(sprt, o);
+            }
+        }
+        else if(strcmp(argv[i], "-each") == 0){
+            takeOptions();
+            eachOptions.insert(eachOptions.end(), options.begin(), options.end());
+        }
+        else if(strcmp(argv[i], "-engine") == 0){
+            takeOptions();
+            engineOptions.push_back(options);
+        }
+        else{
+            valid = false;
+        }
+    }
+
+    MatchEngine engines[2];
+    for(int e=0; e < 2 && valid && engineOptions.size() == 2; e++){
+        engines[e].name = "engine" + to_string(e + 1);
+        if(hashMB > 0){
+            engines[e].hashMB = (size_t) hashMB;
+        }
+        for(string& o : eachOptions){
+            valid = valid && setEngineOption(engines[e], o);
+        }
+        for(string& o : engineOptions[e]){
+            valid = valid && setEngineOption(engines[e], o);
+        }
+    }
+    if( !valid || engineOptions.size() != 2 || threadCount < 1 || gameCount < 1 || hashMB < 0
+        || sprt.alpha <= 0 || sprt.alpha >= 1 || sprt.beta <= 0 || sprt.beta >= 1 || sprt.elo0 >= sprt.elo1){
+        usage(argv[0]);
+        return 1;
+    }
+
+    bool passed = !sprt.enabled;
+    try{
+        if( !nnuePath.empty()){
+            Nnue::load(nnuePath);
+        }
+        if( !tbPath.empty()){
+            Tablebase::init(tbPath);
+        }
+        Match match(engines[0], engines[1], rules, threadCount);
+        if( !openingsPath.empty()){
+            cout << match.loadOpenings(openingsPath) << " openings" << endl;
+        }
+        if( !pgnPath.empty()){
+            match.setPgnOutput(pgnPath);
+        }
+        match.setSprt(sprt);
+        uint64_t nodes = 0;
+        match.setGameCallback([&engines, &nodes](const MatchGame& game, const MatchScore& score){
+            nodes += game.nodes;
+            cout << "Finished game " << (game.round + 1) << " (" << engines[game.redEngine].name << " vs " << engines[1 - game.redEngine].name << "): ";
+            cout << game.result << " {" << game.termination << "}" << endl;
+            printScore(engines[0].name, engines[1].name, score);
+        });
+
+        auto start = chrono::steady_clock::now();
+        MatchScore score = match.run(gameCount);
+        double seconds = max(chrono::duration<double>(chrono::steady_clock::now() - start).count(), 1e-6);
+
+        cout << endl;
+        printScore(engines[0].name, engines[1].name, score);
+        cout << "Elo difference: " << setprecision(1) << score.getElo() << " +/- " << score.getEloError() << endl;
+        if(sprt.enabled){
+            SprtResult result = match.getSprtResult();
+            cout << "SPRT: llr " << setprecision(2) << score.getLlr(sprt.elo0, sprt.elo1);
+            cout << " (" << match.getLowerBound() << ", " << match.getUpperBound() << ")";
+            cout << " [" << setprecision(1) << sprt.elo0 << ", " << sprt.elo1 << "]: ";
+            cout << ((result == SprtAcceptH1) ? "H1 accepted, PASS" : (result == SprtAcceptH0) ? "H0 accepted, FAIL" : "no decision") << endl;
+            passed = result == SprtAcceptH1;
+        }
+        cout << setprecision(2) << seconds << "s, " << setprecision(0) << (score.getGames() / seconds * 60) << " games/min, ";
+        cout << (nodes / seconds) << " nodes/sec" << endl;
+    }
+    catch(const ChessException &cex){
+        cerr << cex.what() << endl;
+        return 1;
+    }
+    return passed ? 0 : 2;
+}
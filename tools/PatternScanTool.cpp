@@ -0,0 +1,100 @@
+/*
+    Offline tool that searches every position of a game archive for material and patterns. See
+     PatternScan.hpp for the column format and the query syntax.
+    Usage: pattern_scan build COLUMNS ARCHIVE                   store every position in columns
+           pattern_scan query [-j threads] [-n max] COLUMNS QUERY  list the positions that match
+    e.g.   pattern_scan build games.ccps games.ccga
+           pattern_scan query games.ccps "wB>=2 wN=0 bN>=2 bB=0"
+           pattern_scan query games.ccps "w:rook-behind-7th-pawn"
+
+    -n sets how many matching positions are listed (default 20). All of them are counted.
+*/
+#include "PatternScan.hpp"
+#include "GameArchive.hpp"
+#include "Position.hpp"
+#include "ChessException.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+static double secondsSince(chrono::steady_clock::time_point start){
+    return max(chrono::duration<double>(chrono::steady_clock::now() - start).count(), 1e-6);
+}
+
+static void build(string columnsPath, string archivePath){
+    GameArchive archive;
+    archive.map(archivePath);
+    PatternColumnsWriter writer;
+    writer.open(columnsPath);
+    auto start = chrono::steady_clock::now();
+    Position pos;
+    for(uint64_t id = 0; id < archive.getGameCount(); id++){
+        uint16_t ply = 0;
+        int plies = archive.replay(id, pos, [&writer, id, &ply](Position& before, PackedMove){
+            writer.add(before, (uint32_t) id, ply++);
+        });
+        writer.add(pos, (uint32_t) id, (uint16_t) plies);
+    }
+    uint64_t rows = writer.close();
+    cout << archive.getGameCount() << " games, " << rows << " positions, " << fixed << setprecision(2) << secondsSince(start) << "s" << endl;
+}
+
+static void query(string columnsPath, string text, int threadCount, size_t maxMatches){
+    PatternQuery query;
+    query.parse(text);
+    PatternColumns columns;
+    columns.map(columnsPath);
+    vector<PsMatch> matches;
+    auto start = chrono::steady_clock::now();
+    uint64_t total = columns.scan(query, threadCount, matches, maxMatches);
+    double seconds = secondsSince(start);
+    for(PsMatch& m : matches){
+        cout << "game " << m.game << " ply " << m.ply << endl;
+    }
+    cout << total << " of " << columns.getRowCount() << " positions match, " << fixed << setprecision(3) << seconds << "s, ";
+    cout << setprecision(0) << columns.getRowCount() / seconds << " positions/sec (" << PatternColumns::getKernelName() << ", " << threadCount << " threads)" << endl;
+}
+
+int main(int argc, char* argv[]){
+    string command = (argc > 1) ? argv[1] : "";
+    int threadCount = thread::hardware_concurrency();
+    long long maxMatches = 20;
+    vector<string> args;
+    for(int i=2; i < argc; i++){
+        if(strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+            threadCount = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc){
+            maxMatches = atoll(argv[++i]);
+        }
+        else{
+            args.push_back(argv[i]);
+        }
+    }
+    if((command != "build" && command != "query") || args.size() != 2 || threadCount < 1 || maxMatches < 0){
+        cerr << "Usage: " << argv[0] << " build COLUMNS ARCHIVE" << endl;
+        cerr << "       " << argv[0] << " query [-j threads] [-n max] COLUMNS QUERY" << endl;
+        return 1;
+    }
+
+    try{
+        if(command == "build"){
+            build(args[0], args[1]);
+        }
+        else{
+            query(args[0], args[1], threadCount, (size_t) maxMatches);
+        }
+    }
+    catch(const ChessException &cex){
+        cerr << cex.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+    Offline tool that converts PGN files to binary game archives and back. See GameArchive.hpp for
+     the format.
+    Usage: pgn_archive create ARCHIVE FILE...       convert PGN files, skipping games with illegal moves
+           pgn_archive export ARCHIVE [first [count]]   write games as PGN to stdout
+           pgn_archive replay ARCHIVE               replay every game, to check it and time decoding
+    e.g.   pgn_archive create games.ccga games.pgn
+*/
+#include "GameArchive.hpp"
+#include "Pgn.hpp"
+#include "Position.hpp"
+#include "ChessException.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+static double secondsSince(chrono::steady_clock::time_point start){
+    return max(chrono::duration<double>(chrono::steady_clock::now() - start).count(), 1e-6);
+}
+
+static void create(string archivePath, vector<string> files){
+    GameArchiveWriter writer;
+    writer.open(archivePath);
+    PgnReader reader;
+    vector<PackedMove> moves;
+    uint64_t skipped = 0;
+    string file;
+    reader.setMoveCallback([&moves](PgnGame&, Position&, PackedMove m){ moves.push_back(m); });
+    reader.setGameCallback([&](PgnGame& game, Position&){
+        if(game.error.empty()){
+            writer.add(game, moves);
+        }
+        else{
+            cerr << file << ":" << game.offset << ": " << game.error << endl;
+            skipped++;
+        }
+        moves.clear();
+    });
+
+    auto start = chrono::steady_clock::now();
+    for(string f : files){
+        ifstream in(f, ios::binary);
+        if(!in){
+            throw ChessException("PgnArchive.cpp: Could not open " + f);
+        }
+        file = f;
+        reader.reset();
+        reader.read(in);
+    }
+    writer.close();
+
+    ifstream written(archivePath, ios::binary | ios::ate);
+    uint64_t outputBytes = (uint64_t) written.tellg();
+    cout << writer.getGameCount() << " games written, " << skipped << " skipped, ";
+    cout << outputBytes << " bytes, " << fixed << setprecision(2) << secondsSince(start) << "s" << endl;
+}
+
+static void exportGames(string archivePath, uint64_t first, uint64_t count){
+    GameArchive archive;
+    archive.map(archivePath);
+    PgnGame game;
+    vector<PackedMove> moves;
+    for(uint64_t id = first; id < archive.getGameCount() && id - first < count; id++){
+        archive.readGame(id, game, moves);
+        PgnWriter::writeGame(cout, game, moves);
+    }
+}
+
+static void replay(string archivePath){
+    GameArchive archive;
+    archive.map(archivePath);
+    Position pos;
+    uint64_t moves = 0;
+    auto start = chrono::steady_clock::now();
+    for(uint64_t id = 0; id < archive.getGameCount(); id++){
+        moves += archive.replay(id, pos, nullptr);
+    }
+    double seconds = secondsSince(start);
+    cout << archive.getGameCount() << " games, " << moves << " moves, " << fixed << setprecision(2) << seconds << "s, ";
+    cout << setprecision(0) << archive.getGameCount() / seconds << " games/sec, " << moves / seconds << " moves/sec" << endl;
+}
+
+int main(int argc, char* argv[]){
+    string command = (argc > 2) ? argv[1] : "";
+    if((command != "create" || argc < 4) && command != "export" && command != "replay"){
+        cerr << "Usage: " << argv[0] << " create ARCHIVE FILE..." << endl;
+        cerr << "       " << argv[0] << " export ARCHIVE [first [count]]" << endl;
+        cerr << "       " << argv[0] << " replay ARCHIVE" << endl;
+        return 1;
+    }
+
+    try{
+        if(command == "create"){
+            create(argv[2], vector<string>(argv + 3, argv + argc));
+        }
+        else if(command == "export"){
+            uint64_t first = (argc > 3) ? strtoull(argv[3], NULL, 10) : 0;
+            uint64_t count = (argc > 4) ? strtoull(argv[4], NULL, 10) : UINT64_MAX;
+            exportGames(argv[2], first, count);
+        }
+        else{
+            replay(argv[2]);
+        }
+    }
+    catch(const ChessException &cex){
+        cerr << cex.what() << endl;
+        return 1;
+    }
+    return 0;
+}
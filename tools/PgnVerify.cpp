@@ -0,0 +1,258 @@
+/*
+    Offline tool that checks PGN archives before they are imported.
+    Usage: pgn_verify [-j threads] FILE...
+    e.g.   pgn_verify -j 8 games.pgn
+
+    The reading thread cuts each file into blocks that end on a game boundary and queues them. Worker
+     threads each replay the games of a block with their own PgnReader, which checks every move
+     against the legal move generator. A game is reported when:
+        - a move is illegal or ambiguous
+        - its Result tag doesn't match the termination marker after its moves
+        - its last position is checkmate or stalemate and the result says otherwise
+    Problems are printed by file and byte offset, followed by games/sec and moves/sec.
+    Exits with 0 if every game is valid, 2 if some aren't, and 1 if a file can't be read.
+*/
+#include "Pgn.hpp"
+#include "Position.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+const size_t BLOCK_SIZE = 1024 * 1024;  // bytes read before looking for a game boundary
+
+/*
+    Games to replay: whole games cut from one file
+*/
+struct Block {
+    int file;
+    uint64_t offset;    // byte offset of the first character in the file
+    string text;
+};
+
+struct Problem {
+    int file;
+    uint64_t offset;
+    string message;
+};
+
+class Verifier {
+    vector<string> files;
+    int threadCount;
+    deque<Block> queue;
+    bool finished;              // no more blocks will be queued
+    mutex lock;                 // guards everything above and 'problems'
+    condition_variable queued;  // a block was queued, or reading finished
+    condition_variable taken;   // a block was taken off the queue
+    vector<Problem> problems;
+    atomic<uint64_t> games;
+    atomic<uint64_t> moves;
+
+    public:
+        Verifier(vector<string> files, int threadCount)
+            : files(files), threadCount(threadCount), finished(false), games(0), moves(0) {}
+
+        bool run(){
+            vector<thread> workers;
+            for(int t=0; t < this->threadCount; t++){
+                workers.emplace_back(&Verifier::work, this);
+            }
+            auto start = chrono::steady_clock::now();
+            bool readAll = true;
+            for(int f=0; f < (int) this->files.size(); f++){
+                readAll = this->readFile(f) && readAll;
+            }
+            {
+                lock_guard<mutex> guard(this->lock);
+                this->finished = true;
+            }
+            this->queued.notify_all();
+            for(thread& t : workers){
+                t.join();
+            }
+            double seconds = max(chrono::duration<double>(chrono::steady_clock::now() - start).count(), 1e-6);
+
+            sort(this->problems.begin(), this->problems.end(), [](const Problem& a, const Problem& b){
+                return (a.file != b.file) ? a.file < b.file : a.offset < b.offset;
+            });
+            for(Problem& p : this->problems){
+                cout << this->files[p.file] << ":" << p.offset << ": " << p.message << endl;
+            }
+            cout << this->games << " games, " << this->moves << " moves, " << this->problems.size() << " invalid, ";
+            cout << fixed << setprecision(2) << seconds << "s, " << setprecision(0) << this->games / seconds << " games/sec, ";
+            cout << this->moves / seconds << " moves/sec" << endl;
+            return readAll;
+        }
+
+        bool allValid(){
+            return this->problems.empty();
+        }
+
+    private:
+        /*
+            Queue a file in blocks. A block ends at the last "blank line, '['" in it, which in export
+             format PGN only comes between the move text of one game and the tags of the next.
+        */
+        bool readFile(int f){
+            ifstream in(this->files[f], ios::binary);
+            if(!in){
+                cerr << "Couldn't open " << this->files[f] << endl;
+                return false;
+            }
+            string carry;
+            uint64_t offset = 0;
+            vector<char> chunk(BLOCK_SIZE);
+            while(in.read(chunk.data(), chunk.size()) || in.gcount() > 0){
+                carry.append(chunk.data(), (size_t) in.gcount());
+                size_t cut = lastBoundary(carry);
+                if(cut == string::npos){
+                    continue;   // a game longer than a block, keep reading
+                }
+                Block block{f, offset, carry.substr(0, cut)};
+                carry.erase(0, cut);
+                offset += cut;
+                this->push(std::move(block));
+            }
+            if(!carry.empty()){
+                this->push(Block{f, offset, std::move(carry)});
+            }
+            return true;
+        }
+
+        // Index of the '[' starting the last game in 'text' that isn't its first, or npos. Games are
+        //  normally separated by a blank line. Without one, an Event tag after a line of move text
+        //  starts a game.
+        static size_t lastBoundary(const string& text){
+            for(size_t i = text.size(); i-- > 2; ){
+                if(text[i] != '[' || text[i - 1] != '\n'){
+                    continue;
+                }
+                size_t j = i - 2;
+                if(text[j] == '\r' && j > 0){
+                    j--;
+                }
+                if(text[j] == '\n'){
+                    return i;
+                }
+            }
+            for(size_t i = text.rfind("\n[Event "); i != string::npos && i > 0; i = text.rfind("\n[Event ", i - 1)){
+                size_t lineStart = text.rfind('\n', i - 1);
+                lineStart = (lineStart == string::npos) ? 0 : lineStart + 1;
+                if(text[lineStart] != '['){
+                    return i + 1;
+                }
+            }
+            return string::npos;
+        }
+
+        // Wait for room so the reading thread stays a few blocks ahead of the workers at most
+        void push(Block&& block){
+            unique_lock<mutex> guard(this->lock);
+            this->taken.wait(guard, [this] { return this->queue.size() < (size_t) this->threadCount * 2; });
+            this->queue.push_back(std::move(block));
+            guard.unlock();
+            this->queued.notify_one();
+        }
+
+        // Body of a worker thread
+        void work(){
+            PgnReader reader;
+            Block block;
+            vector<Problem> found;
+            uint64_t blockGames = 0, blockMoves = 0;
+            reader.setGameCallback([this, &block, &found, &blockGames, &blockMoves](PgnGame& game, Position& pos){
+                blockGames++;
+                blockMoves += game.plies;
+                string message = checkGame(game, pos);
+                if(!message.empty()){
+                    found.push_back(Problem{block.file, block.offset + game.offset, message});
+                }
+            });
+            while(true){
+                {
+                    unique_lock<mutex> guard(this->lock);
+                    this->queued.wait(guard, [this] { return !this->queue.empty() || this->finished; });
+                    if(this->queue.empty()){
+                        return;
+                    }
+                    block = std::move(this->queue.front());
+                    this->queue.pop_front();
+                }
+                this->taken.notify_one();
+
+                reader.reset();
+                reader.feed(block.text.data(), block.text.size());
+                reader.finish();
+                this->games += blockGames;
+                this->moves += blockMoves;
+                blockGames = blockMoves = 0;
+                if(!found.empty()){
+                    lock_guard<mutex> guard(this->lock);
+                    this->problems.insert(this->problems.end(), found.begin(), found.end());
+                    found.clear();
+                }
+            }
+        }
+
+        // Why a replayed game is invalid, or an empty string if it's valid
+        static string checkGame(PgnGame& game, Position& pos){
+            if(!game.error.empty()){
+                return game.error;
+            }
+            string tag = game.getTag("Result");
+            if(!tag.empty() && tag != game.result){
+                return "Result tag " + tag + " doesn't match the result " + game.result + " after the moves";
+            }
+            MoveList legal;
+            pos.generateLegalMoves(legal);
+            if(legal.size > 0 || game.result == "*"){
+                return "";
+            }
+            if(pos.inCheck()){
+                string expected = (pos.getSideToMove() == Red) ? "0-1" : "1-0";
+                if(game.result != expected){
+                    return "Game ends in checkmate but the result is " + game.result;
+                }
+            }
+            else if(game.result != "1/2-1/2"){
+                return "Game ends in stalemate but the result is " + game.result;
+            }
+            return "";
+        }
+};
+
+int main(int argc, char* argv[]){
+    // hardware_concurrency() is 0 when it can't tell
+    int threadCount = max((int) thread::hardware_concurrency(), 1);
+    vector<string> files;
+    for(int i=1; i < argc; i++){
+        if(strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+            threadCount = atoi(argv[++i]);
+        }
+        else{
+            files.push_back(argv[i]);
+        }
+    }
+    if(files.empty() || threadCount < 1){
+        cerr << "Usage: " << argv[0] << " [-j threads] FILE..." << endl;
+        return 1;
+    }
+
+    Verifier verifier(files, threadCount);
+    if(!verifier.run()){
+        return 1;
+    }
+    return verifier.allValid() ? 0 : 2;
+}
@@ -0,0 +1,118 @@
+/*
+    Offline tool that indexes the positions of a game archive and finds the games that reached a
+     position. See PositionIndex.hpp for the format.
+    Usage: position_index build [-m MB] INDEX ARCHIVE       index every position of every game
+           position_index query [-a ARCHIVE] INDEX FEN...   list the games that reached each position
+    e.g.   position_index build games.ccpi games.ccga
+           position_index query -a games.ccga games.ccpi "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2"
+
+    -m sets the memory used to sort entries before they are spilled to temporary files.
+    With -a, the players and result of each game are printed from the archive.
+*/
+#include "PositionIndex.hpp"
+#include "GameArchive.hpp"
+#include "Position.hpp"
+#include "ChessException.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+static double secondsSince(chrono::steady_clock::time_point start){
+    return max(chrono::duration<double>(chrono::steady_clock::now() - start).count(), 1e-6);
+}
+
+static void build(string indexPath, string archivePath, size_t runEntries){
+    GameArchive archive;
+    archive.map(archivePath);
+    PositionIndexWriter writer(runEntries);
+    writer.open(indexPath);
+    auto start = chrono::steady_clock::now();
+    Position pos;
+    for(uint64_t id = 0; id < archive.getGameCount(); id++){
+        uint16_t ply = 0;
+        int plies = archive.replay(id, pos, [&writer, id, &ply](Position& before, PackedMove){
+            writer.add(before.getKey(), (uint32_t) id, ply++);
+        });
+        writer.add(pos.getKey(), (uint32_t) id, (uint16_t) plies);
+    }
+    uint64_t entries = writer.close();
+    cout << archive.getGameCount() << " games, " << entries << " entries, " << fixed << setprecision(2) << secondsSince(start) << "s" << endl;
+}
+
+static void query(string indexPath, string archivePath, vector<string> fens){
+    PositionIndex index;
+    index.map(indexPath);
+    GameArchive archive;
+    if(!archivePath.empty()){
+        archive.map(archivePath);
+    }
+    Position pos;
+    vector<PiEntry> found;
+    PgnGame game;
+    for(string fen : fens){
+        try{
+            pos.loadFen(fen);
+        }
+        catch(const ChessException &cex){
+            cerr << cex.what() << endl;
+            continue;
+        }
+        auto start = chrono::steady_clock::now();
+        bool filtered = !index.mayContain(pos.getKey());
+        index.find(pos, found);
+        double micros = secondsSince(start) * 1e6;
+        cout << fen << ": " << found.size() << " games";
+        cout << (filtered ? ", rejected by the Bloom filter" : "") << " (" << fixed << setprecision(1) << micros << "us)" << endl;
+        for(PiEntry& e : found){
+            cout << "    game " << e.game << " ply " << e.ply;
+            if(!archivePath.empty()){
+                archive.readHeader(e.game, game);
+                cout << "  " << game.getTag("White") << " - " << game.getTag("Black") << " " << game.result;
+            }
+            cout << endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]){
+    string command = (argc > 1) ? argv[1] : "";
+    size_t memoryMb = PI_DEFAULT_RUN_ENTRIES * sizeof(PiEntry) >> 20;
+    string archivePath;
+    vector<string> args;
+    for(int i=2; i < argc; i++){
+        if(strcmp(argv[i], "-m") == 0 && i + 1 < argc){
+            memoryMb = (size_t) atoll(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-a") == 0 && i + 1 < argc){
+            archivePath = argv[++i];
+        }
+        else{
+            args.push_back(argv[i]);
+        }
+    }
+    if(!((command == "build" && args.size() == 2) || (command == "query" && args.size() >= 2)) || memoryMb < 1){
+        cerr << "Usage: " << argv[0] << " build [-m MB] INDEX ARCHIVE" << endl;
+        cerr << "       " << argv[0] << " query [-a ARCHIVE] INDEX FEN..." << endl;
+        return 1;
+    }
+
+    try{
+        if(command == "build"){
+            build(args[0], args[1], (memoryMb << 20) / sizeof(PiEntry));
+        }
+        else{
+            query(args[0], archivePath, vector<string>(args.begin() + 1, args.end()));
+        }
+    }
+    catch(const ChessException &cex){
+        cerr << cex.what() << endl;
+        return 1;
+    }
+    return 0;
+}
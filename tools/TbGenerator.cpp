@@ -0,0 +1,395 @@
+/*
+    Offline tool that generates distance to mate tablebases. See Tablebase.hpp for the format.
+    Usage: tb_generator [-j threads] [-o directory] SIGNATURE...
+    e.g.   tb_generator -j 4 -o tb KQK KRK KBNK KRKP
+
+    Tables needed for captures and promotions are generated first, or loaded if the output
+     directory already has them.
+
+    Generation works backwards from checkmate:
+        1. Every position is set up once. Checkmates are lost in 0 plies. Captures and promotions
+           lead to smaller tables that are already solved, so their results are recorded too.
+        2. Positions are then solved one ply at a time. When a position is lost in n plies, every
+           position that can move into it is won in n + 1. When a position is won in n plies, every
+           position that can move into it is checked, and is lost in n + 1 if all of its moves lead
+           to positions won for the opponent.
+        3. Positions still unsolved when no more are found are draws.
+    Both passes are split across threads. Each position's code is only written once, with a
+     compare and swap, so threads never need to lock.
+*/
+#include "Tablebase.hpp"
+#include "Position.hpp"
+#include "Bitboard.hpp"
+#include "ChessException.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Generated codes, kept alive for as long as their Tablebase is probed
+static map<string, vector<uint8_t>*> generatedCodes;
+
+/*
+    A position waiting in a bucket
+*/
+enum CandidateKind {
+    Solved,         // already solved at the bucket's ply
+    ConversionWin,  // a capture or promotion wins at the bucket's ply, unless a quiet move wins sooner
+    ConversionLoss  // every move has been solved as lost. Mated at the bucket's ply.
+};
+
+struct Candidate {
+    size_t index;
+    CandidateKind kind;
+};
+
+class Generator {
+    Tablebase* tb;
+    vector<uint8_t>& codes;
+    int threadCount;
+    vector<vector<Candidate>> buckets;  // [ply] positions to solve at that ply
+    mutex bucketLock;
+
+    public:
+        Generator(Tablebase* tb, vector<uint8_t>& codes, int threadCount)
+            : tb(tb), codes(codes), threadCount(threadCount), buckets(TB_MAX_PLIES + 2) {}
+
+        void run(){
+            this->parallel(this->tb->getEntryCount(), [this](size_t begin, size_t end, vector<vector<Candidate>>& found){
+                this->initRange(begin, end, found);
+            });
+            vector<size_t> frontier;
+            for(int ply = 0; ply <= TB_MAX_PLIES; ply++){
+                frontier.clear();
+                for(Candidate c : this->buckets[ply]){
+                    if(this->resolveCandidate(c, ply)){
+                        frontier.push_back(c.index);
+                    }
+                }
+                this->buckets[ply].clear();
+                if(frontier.empty()){
+                    if(this->bucketsEmpty(ply + 1)){
+                        break;
+                    }
+                    continue;
+                }
+                this->parallel(frontier.size(), [this, &frontier, ply](size_t begin, size_t end, vector<vector<Candidate>>& found){
+                    Position pos;
+                    for(size_t i = begin; i < end; i++){
+                        this->retract(pos, frontier[i], ply, found);
+                    }
+                });
+            }
+        }
+
+    private:
+        uint8_t load(size_t idx){
+            return __atomic_load_n(&this->codes[idx], __ATOMIC_RELAXED);
+        }
+
+        // Set a code if the position is still unsolved
+        bool store(size_t idx, uint8_t code){
+            uint8_t expected = 0;
+            return __atomic_compare_exchange_n(&this->codes[idx], &expected, code, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        }
+
+        bool bucketsEmpty(int from){
+            for(size_t ply = from; ply < this->buckets.size(); ply++){
+                if(!this->buckets[ply].empty()){
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /*
+            Split 'count' items across the threads. Each thread collects candidates for later plies
+             in its own buckets, which are merged afterwards.
+        */
+        template <typename F>
+        void parallel(size_t count, F work){
+            vector<thread> threads;
+            size_t chunk = (count + this->threadCount - 1) / this->threadCount;
+            for(int t=0; t < this->threadCount; t++){
+                size_t begin = t * chunk;
+                size_t end = min(count, begin + chunk);
+                if(begin >= end){
+                    break;
+                }
+                threads.emplace_back([this, begin, end, &work](){
+                    vector<vector<Candidate>> found(TB_MAX_PLIES + 2);
+                    work(begin, end, found);
+                    lock_guard<mutex> guard(this->bucketLock);
+                    for(size_t ply=0; ply < found.size(); ply++){
+                        this->buckets[ply].insert(this->buckets[ply].end(), found[ply].begin(), found[ply].end());
+                    }
+                });
+            }
+            for(thread& t : threads){
+                t.join();
+            }
+        }
+
+        /*
+            Result of a move that leaves this table, from the point of view of the team to move after it
+        */
+        uint8_t probeChild(Position& pos){
+            TbResult r;
+            if(!Tablebase::probe(pos, r) || r.wdl == 0){
+                return 0;   // bare kings, or a draw
+            }
+            return (r.wdl > 0) ? tbWinCode(r.plies) : tbLossCode(r.plies);
+        }
+
+        // First pass: find checkmates and the results of captures and promotions
+        void initRange(size_t begin, size_t end, vector<vector<Candidate>>& found){
+            Position pos;
+            MoveList moves;
+            for(size_t idx = begin; idx < end; idx++){
+                if(!this->tb->decode(idx, pos) || this->tb->index(pos) != idx){
+                    continue;   // illegal, or a symmetric copy of another index
+                }
+                moves.size = 0;
+                pos.generateLegalMoves(moves);
+                if(moves.size == 0){
+                    if(pos.inCheck()){
+                        this->store(idx, tbLossCode(0));
+                        found[0].push_back({ idx, Solved });
+                    }
+                    continue;
+                }
+                int bestWin = -1;       // fewest plies to win through a capture or promotion
+                int longestLoss = -1;   // most plies to be mated if every move loses
+                bool allLose = true;
+                bool quietMoves = false;
+                for(int i=0; i < moves.size; i++){
+                    PackedMove m = moves.moves[i];
+                    if(pos.getType(moveDest(m)) == NoPiece && moveSpecial(m) != PawnPromo && moveSpecial(m) != EnPassant){
+                        quietMoves = true;
+                        continue;
+                    }
+                    pos.makeMove(m);
+                    uint8_t child = this->probeChild(pos);
+                    pos.unmakeMove();
+                    if(tbIsLoss(child)){
+                        int plies = tbPlies(child) + 1;
+                        if(bestWin == -1 || plies < bestWin){
+                            bestWin = plies;
+                        }
+                    }
+                    else if(tbIsWin(child)){
+                        longestLoss = max(longestLoss, tbPlies(child) + 1);
+                    }
+                    else{
+                        allLose = false;
+                    }
+                }
+                if(bestWin != -1){
+                    found[bestWin].push_back({ idx, ConversionWin });
+                }
+                // A position with quiet moves is checked again when its last quiet move is solved
+                else if(allLose && !quietMoves){
+                    found[longestLoss].push_back({ idx, ConversionLoss });
+                }
+            }
+        }
+
+        /*
+            Solve a position from a bucket. Returns true if it was solved at this ply.
+        */
+        bool resolveCandidate(Candidate c, int ply){
+            if(c.kind == Solved){
+                return true;
+            }
+            if(c.kind == ConversionWin){
+                return this->store(c.index, tbWinCode(ply));
+            }
+            if(this->load(c.index) != 0){
+                return false;
+            }
+            Position pos;
+            this->tb->decode(c.index, pos);
+            return this->lostAt(pos) == ply && this->store(c.index, tbLossCode(ply));
+        }
+
+        /*
+            If every move of the team to move leads to a solved win for the opponent, returns the
+             number of plies until mate. Otherwise -1.
+        */
+        int lostAt(Position& pos){
+            MoveList moves;
+            pos.generateLegalMoves(moves);
+            int longest = 0;
+            for(int i=0; i < moves.size; i++){
+                PackedMove m = moves.moves[i];
+                bool conversion = pos.getType(moveDest(m)) != NoPiece || moveSpecial(m) == PawnPromo || moveSpecial(m) == EnPassant;
+                pos.makeMove(m);
+                uint8_t child = conversion ? this->probeChild(pos) : this->load(this->tb->index(pos));
+                pos.unmakeMove();
+                if(!tbIsWin(child)){
+                    return -1;
+                }
+                longest = max(longest, tbPlies(child) + 1);
+            }
+            return longest;
+        }
+
+        /*
+            Visit every position that can reach 'idx' with a quiet move by the team that is not to
+             move in it
+        */
+        void retract(Position& pos, size_t idx, int ply, vector<vector<Candidate>>& found){
+            this->tb->decode(idx, pos);
+            bool lost = tbIsLoss(this->load(idx));
+            TeamColor mover = (pos.getSideToMove() == Red) ? Black : Red;
+            TeamColor waiting = pos.getSideToMove();
+            Bitboard occupied = pos.getOccupied();
+            Bitboard pieces = pos.getPieces(mover);
+
+            while(pieces){
+                int to = Bitboards::popLsb(pieces);
+                PieceType pt = pos.getType(to);
+                Bitboard froms;
+                if(pt == Pawn){
+                    int back = (mover == Red) ? 8 : -8;
+                    froms = EMPTY_BB;
+                    int from = to + back;
+                    if(!(occupied & Bitboards::squareBB(from)) && from / 8 >= 1 && from / 8 <= 6){
+                        froms |= Bitboards::squareBB(from);
+                        int start = from + back;
+                        int startRow = (mover == Red) ? 6 : 1;
+                        if(start / 8 == startRow && !(occupied & Bitboards::squareBB(start))){
+                            froms |= Bitboards::squareBB(start);
+                        }
+                    }
+                }
+                else{
+                    froms = Bitboards::attacks(pt, mover, to, occupied) & ~occupied;
+                }
+
+                while(froms){
+                    int from = Bitboards::popLsb(froms);
+                    pos.removePiece(to);
+                    pos.putPiece(from, mover, pt);
+                    pos.setSideToMove(mover);
+                    // The team that is waiting can't have been left in check
+                    if(!pos.isAttacked(pos.getKingIndex(waiting), mover)){
+                        size_t parent = this->tb->index(pos);
+                        if(this->load(parent) == 0){
+                            if(lost){
+                                if(this->store(parent, tbWinCode(ply + 1))){
+                                    found[ply + 1].push_back({ parent, Solved });
+                                }
+                            }
+                            else{
+                                int loss = this->lostAt(pos);
+                                if(loss == ply + 1){
+                                    if(this->store(parent, tbLossCode(ply + 1))){
+                                        found[ply + 1].push_back({ parent, Solved });
+                                    }
+                                }
+                                // A capture or promotion takes longer to lose than this move
+                                else if(loss > ply + 1){
+                                    found[loss].push_back({ parent, ConversionLoss });
+                                }
+                            }
+                        }
+                    }
+                    pos.removePiece(from);
+                    pos.putPiece(to, mover, pt);
+                    pos.setSideToMove(waiting);
+                }
+            }
+        }
+};
+
+static bool fileExists(string path){
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+/*
+    Generate a table and everything it depends on, or load it if it already exists
+*/
+static void generate(string signature, string dir, int threadCount){
+    if(Tablebase::find(signature) != NULL){
+        return;
+    }
+    for(string child : Tablebase::childSignatures(signature)){
+        generate(child, dir, threadCount);
+    }
+    string path = dir + "/" + signature + ".cctb";
+    Tablebase* tb = new Tablebase(signature);
+    if(fileExists(path)){
+        tb->map(path);
+        Tablebase::add(tb);
+        cout << signature << ": loaded " << path << endl;
+        return;
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<uint8_t>* codes = new vector<uint8_t>(tb->getEntryCount(), 0);
+    Generator(tb, *codes, threadCount).run();
+    tb->setCodes(codes->data());
+    tb->write(path);
+    generatedCodes[signature] = codes;
+    Tablebase::add(tb);
+
+    size_t wins = 0;
+    size_t losses = 0;
+    int longest = 0;
+    for(uint8_t code : *codes){
+        if(tbIsWin(code)) wins++;
+        if(tbIsLoss(code)) losses++;
+        if(tbIsWin(code)) longest = max(longest, tbPlies(code));
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << signature << ": " << tb->getEntryCount() << " entries, " << wins << " wins, " << losses << " losses, ";
+    cout << "longest mate " << (longest + 1) / 2 << " moves, " << fixed << setprecision(1) << seconds << "s" << endl;
+}
+
+int main(int argc, char* argv[]){
+    int threadCount = thread::hardware_concurrency();
+    string dir = ".";
+    vector<string> signatures;
+    for(int i=1; i < argc; i++){
+        if(strcmp(argv[i], "-j") == 0 && i + 1 < argc){
+            threadCount = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc){
+            dir = argv[++i];
+        }
+        else{
+            signatures.push_back(argv[i]);
+        }
+    }
+    if(signatures.empty() || threadCount < 1){
+        cerr << "Usage: " << argv[0] << " [-j threads] [-o directory] SIGNATURE..." << endl;
+        return 1;
+    }
+    mkdir(dir.c_str(), 0755);
+
+    try{
+        for(string s : signatures){
+            size_t split = s.find('K', 1);
+            if(s.empty() || s[0] != 'K' || split == string::npos){
+                throw ChessException("TbGenerator.cpp: Signatures look like KRKP");
+            }
+            generate(Tablebase::canonicalSignature(s.substr(0, split), s.substr(split)), dir, threadCount);
+        }
+    }
+    catch(const ChessException &cex){
+        cerr << cex.what() << endl;
+        return 1;
+    }
+    return 0;
+}